@@ -0,0 +1,412 @@
+//
+//  corpus.cpp
+//  JsonLib
+//
+
+#include "corpus.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+// splitmix64: unlike the standard distributions, it gives the same numbers
+// with every standard library
+class Random
+{
+public:
+    explicit Random(std::uint64_t seed) : state_(seed) {}
+    
+    std::uint64_t next()
+    {
+        std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    // In [0, n)
+    std::uint64_t below(std::uint64_t n) { return next() % n; }
+    // In [low, high]
+    std::int64_t between(std::int64_t low, std::int64_t high) { return low + static_cast<std::int64_t>(below(high - low + 1)); }
+    // In [0, 1)
+    double unit() { return static_cast<double>(next() >> 11) / 9007199254740992.0; }
+    bool chance(int percent) { return below(100) < static_cast<std::uint64_t>(percent); }
+    
+    template <class T, size_t N>
+    const T& pick(const T (&items)[N]) { return items[below(N)]; }
+
+private:
+    std::uint64_t state_;
+};
+
+static size_t scaled(double scale, size_t n)
+{
+    return std::max<size_t>(1, static_cast<size_t>(std::llround(n * scale)));
+}
+
+static void appendInt(std::string& s, std::int64_t v)
+{
+    char buf[24];
+    s.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+
+static void appendDouble(std::string& s, double v)
+{
+    char buf[32];
+    s.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+
+// Appends "key": with the key quoted
+static void appendKey(std::string& s, const char* key)
+{
+    s += '"';
+    s += key;
+    s += "\":";
+}
+
+static const char* const EnglishWords[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "morning", "coffee",
+    "release", "today", "great", "team", "launch", "weekend", "music", "city", "rain", "love"
+};
+static const char* const JapaneseWords[] = {
+    "今日", "は", "いい", "天気", "です", "ね", "東京", "ラーメン", "最高", "新しい", "友達", "映画"
+};
+// Already escaped, as they would be in the JSON text
+static const char* const EscapedWords[] = {
+    "\\u2764", "\\ud83d\\ude00", "\\n", "\\\"quoted\\\"", "\\/", "caf\\u00e9"
+};
+
+static std::string sentence(Random& random, size_t words)
+{
+    std::string s;
+    bool japanese = random.chance(40);
+    for (size_t i = 0; i < words; ++i) {
+        if (i > 0 && !japanese) {
+            s += ' ';
+        }
+        if (random.chance(8)) {
+            s += random.pick(EscapedWords);
+        }
+        else {
+            s += japanese ? random.pick(JapaneseWords) : random.pick(EnglishWords);
+        }
+    }
+    return s;
+}
+
+static std::string handle(Random& random)
+{
+    std::string s;
+    size_t n = random.between(5, 14);
+    for (size_t i = 0; i < n; ++i) {
+        s += static_cast<char>(random.chance(15) ? '0' + random.below(10) : 'a' + random.below(26));
+    }
+    return s;
+}
+
+static void appendUser(std::string& s, Random& random)
+{
+    std::int64_t id = random.between(10000, 3000000000LL);
+    std::string name = handle(random);
+    s += '{';
+    appendKey(s, "id");
+    appendInt(s, id);
+    s += ',';
+    appendKey(s, "id_str");
+    s += '"';
+    appendInt(s, id);
+    s += "\",\"name\":\"" + sentence(random, 2) + "\",\"screen_name\":\"" + name + "\",\"location\":\"";
+    s += random.chance(50) ? sentence(random, 1) : std::string();
+    s += "\",\"description\":\"" + sentence(random, random.between(0, 20)) + "\",\"url\":null,";
+    s += "\"entities\":{\"description\":{\"urls\":[]}},\"protected\":false,";
+    const char* counts[] = { "followers_count", "friends_count", "listed_count", "favourites_count", "statuses_count" };
+    for (const char* key : counts) {
+        appendKey(s, key);
+        appendInt(s, random.between(0, 200000));
+        s += ',';
+    }
+    s += "\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"utc_offset\":null,\"time_zone\":null,\"geo_enabled\":";
+    s += random.chance(30) ? "true" : "false";
+    s += ",\"verified\":false,\"lang\":\"ja\",\"profile_background_color\":\"C0DEED\",";
+    s += "\"profile_image_url\":\"http:\\/\\/pbs.twimg.com\\/profile_images\\/" + std::to_string(random.next() % 1000000000) + "\\/" + name + "_normal.png\",";
+    s += "\"profile_use_background_image\":true,\"default_profile\":";
+    s += random.chance(50) ? "true" : "false";
+    s += ",\"following\":false,\"notifications\":false}";
+}
+
+static void appendStatus(std::string& s, Random& random)
+{
+    std::int64_t id = 505874924095815681LL + random.between(0, 1000000000LL);
+    s += "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},";
+    s += "\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",";
+    appendKey(s, "id");
+    appendInt(s, id);
+    s += ",\"id_str\":\"";
+    appendInt(s, id);
+    s += "\",\"text\":\"" + sentence(random, random.between(4, 30)) + "\",";
+    s += "\"source\":\"<a href=\\\"http:\\/\\/twitter.com\\/download\\/iphone\\\" rel=\\\"nofollow\\\">Twitter for iPhone<\\/a>\",";
+    s += "\"truncated\":false,\"in_reply_to_status_id\":null,\"in_reply_to_user_id\":null,\"user\":";
+    appendUser(s, random);
+    s += ",\"geo\":null,\"coordinates\":null,\"place\":null,\"contributors\":null,";
+    s += "\"retweet_count\":";
+    appendInt(s, random.between(0, 5000));
+    s += ",\"favorite_count\":";
+    appendInt(s, random.between(0, 5000));
+    s += ",\"entities\":{\"hashtags\":[";
+    size_t tags = random.below(3);
+    for (size_t i = 0; i < tags; ++i) {
+        s += (i > 0) ? "," : "";
+        s += "{\"text\":\"" + std::string(random.pick(EnglishWords)) + "\",\"indices\":[";
+        appendInt(s, random.between(0, 60));
+        s += ',';
+        appendInt(s, random.between(61, 140));
+        s += "]}";
+    }
+    s += "],\"symbols\":[],\"urls\":[],\"user_mentions\":[";
+    size_t mentions = random.below(3);
+    for (size_t i = 0; i < mentions; ++i) {
+        std::int64_t userId = random.between(10000, 3000000000LL);
+        s += (i > 0) ? "," : "";
+        s += "{\"screen_name\":\"" + handle(random) + "\",\"name\":\"" + sentence(random, 2) + "\",\"id\":";
+        appendInt(s, userId);
+        s += ",\"id_str\":\"";
+        appendInt(s, userId);
+        s += "\",\"indices\":[0,12]}";
+    }
+    s += "]},\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}";
+}
+
+std::string makeTwitter(double scale)
+{
+    Random random(1);
+    std::string s = "{\"statuses\":[";
+    size_t count = scaled(scale, 300);
+    for (size_t i = 0; i < count; ++i) {
+        s += (i > 0) ? "," : "";
+        appendStatus(s, random);
+    }
+    s += "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,";
+    s += "\"query\":\"%E4%B8%80\",\"count\":";
+    appendInt(s, count);
+    s += ",\"since_id\":0}}";
+    return s;
+}
+
+std::string makeCanada(double scale)
+{
+    Random random(2);
+    std::string s = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",";
+    s += "\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+    size_t rings = scaled(scale, 480);
+    for (size_t r = 0; r < rings; ++r) {
+        s += (r > 0) ? ",[" : "[";
+        // A random walk, as a coastline is
+        double lon = -141.0 + 89.0 * random.unit();
+        double lat = 42.0 + 41.0 * random.unit();
+        size_t points = random.between(20, 440);
+        for (size_t p = 0; p < points; ++p) {
+            lon += (random.unit() - 0.5) * 0.01;
+            lat += (random.unit() - 0.5) * 0.01;
+            s += (p > 0) ? ",[" : "[";
+            appendDouble(s, lon);
+            s += ',';
+            appendDouble(s, lat);
+            s += ']';
+        }
+        s += ']';
+    }
+    s += "]}}]}";
+    return s;
+}
+
+static const char* const PerformanceNames[] = {
+    "Orchestre Philharmonique de Radio France", "Quatuor Ébène", "Récital de piano",
+    "Les Arts Florissants", "Concert de l'Avent", "Jazz à la Villette"
+};
+static const char* const AreaNames[] = {
+    "Arrière-scène central", "1er balcon central", "2ème balcon bergerie cour",
+    "Parterre", "Loges", "Arrière-scène jardin", "Baignoire"
+};
+
+std::string makeCitm(double scale)
+{
+    Random random(3);
+    std::string s = "{\"areaNames\":{";
+    size_t areas = 17;
+    for (size_t i = 0; i < areas; ++i) {
+        s += (i > 0) ? ",\"" : "\"";
+        appendInt(s, 205705993 + i);
+        s += "\":\"" + std::string(random.pick(AreaNames)) + "\"";
+    }
+    s += "},\"audienceSubCategoryNames\":{\"337100890\":\"Abonné\"},\"blockNames\":{},\"events\":{";
+    
+    size_t events = scaled(scale, 184);
+    for (size_t i = 0; i < events; ++i) {
+        std::int64_t id = 138586341 + 10 * i;
+        s += (i > 0) ? ",\"" : "\"";
+        appendInt(s, id);
+        s += "\":{\"description\":null,\"id\":";
+        appendInt(s, id);
+        s += ",\"logo\":";
+        s += random.chance(50) ? "\"/images/UE0AAAAACEKo6QAAAAZDSVRN\"" : "null";
+        s += ",\"name\":\"" + std::string(random.pick(PerformanceNames)) + "\",\"subTopicIds\":[";
+        size_t topics = random.between(1, 5);
+        for (size_t t = 0; t < topics; ++t) {
+            s += (t > 0) ? "," : "";
+            appendInt(s, 337184262 + random.below(30));
+        }
+        s += "],\"subjectCode\":null,\"subtitle\":null,\"topicIds\":[";
+        appendInt(s, 324846099 + random.below(10));
+        s += ",107888604]}";
+    }
+    
+    s += "},\"performances\":[";
+    size_t performances = scaled(scale, 243);
+    for (size_t i = 0; i < performances; ++i) {
+        s += (i > 0) ? ",{" : "{";
+        s += "\"eventId\":";
+        appendInt(s, 138586341 + 10 * random.below(events));
+        s += ",\"id\":";
+        appendInt(s, 339887544 + i);
+        s += ",\"logo\":null,\"name\":null,\"prices\":[";
+        size_t prices = random.between(1, 5);
+        for (size_t p = 0; p < prices; ++p) {
+            s += (p > 0) ? ",{" : "{";
+            s += "\"amount\":";
+            appendInt(s, 500 * random.between(10, 400));
+            s += ",\"audienceSubCategoryId\":337100890,\"seatCategoryId\":";
+            appendInt(s, 338937295 + p);
+            s += '}';
+        }
+        s += "],\"seatCategories\":[";
+        size_t categories = random.between(1, 5);
+        for (size_t c = 0; c < categories; ++c) {
+            s += (c > 0) ? ",{" : "{";
+            s += "\"areas\":[";
+            size_t seats = random.between(3, 25);
+            for (size_t a = 0; a < seats; ++a) {
+                s += (a > 0) ? ",{" : "{";
+                s += "\"areaId\":";
+                appendInt(s, 205705993 + random.below(areas));
+                s += ",\"blockIds\":[]}";
+            }
+            s += "],\"seatCategoryId\":";
+            appendInt(s, 338937295 + c);
+            s += '}';
+        }
+        s += "],\"seatMapImage\":null,\"start\":";
+        appendInt(s, 1372701600000LL + 3600000LL * random.below(5000));
+        s += ",\"venueCode\":\"PLEYEL_PLEYEL\"}";
+    }
+    s += "],\"seatCategoryNames\":{\"338937295\":\"1ère catégorie\",\"338937296\":\"2ème catégorie\"},";
+    s += "\"subTopicNames\":{\"337184262\":\"Musique amplifiée\",\"337184263\":\"Musique baroque\"},";
+    s += "\"topicNames\":{\"107888604\":\"Activité\",\"324846099\":\"Type de public\"},";
+    s += "\"venueNames\":{\"PLEYEL_PLEYEL\":\"Salle Pleyel\"}}";
+    return s;
+}
+
+std::string makeDeep(double scale)
+{
+    Random random(4);
+    const size_t depth = 500;
+    std::string s = "[";
+    size_t count = scaled(scale, 200);
+    for (size_t i = 0; i < count; ++i) {
+        s += (i > 0) ? "," : "";
+        // Arrays and objects in turn, with a scalar at the bottom
+        for (size_t d = 0; d < depth; ++d) {
+            s += (d % 2 == 0) ? "[" : "{\"k\":";
+        }
+        appendInt(s, random.between(-1000, 1000));
+        for (size_t d = depth; d-- > 0;) {
+            s += (d % 2 == 0) ? ']' : '}';
+        }
+    }
+    s += ']';
+    return s;
+}
+
+std::string makeStrings(double scale)
+{
+    Random random(5);
+    std::string s = "[";
+    size_t count = scaled(scale, 128);
+    for (size_t i = 0; i < count; ++i) {
+        s += (i > 0) ? ",\"" : "\"";
+        size_t length = random.between(4096, 32768);
+        size_t start = s.size();
+        while (s.size() - start < length) {
+            if (random.chance(2)) {
+                s += random.pick(EscapedWords);
+            }
+            else {
+                s += random.chance(10) ? random.pick(JapaneseWords) : random.pick(EnglishWords);
+                s += ' ';
+            }
+        }
+        s += '"';
+    }
+    s += ']';
+    return s;
+}
+
+static const char* const LogWords[] = {
+    "request", "completed", "user", "session", "timeout", "GET", "/api/v1/items", "status",
+    "retrying", "connection", "upstream", "cache", "miss"
+};
+static const char* const LogLevels[] = { "debug", "info", "info", "info", "warn", "error" };
+
+static std::string record(Random& random)
+{
+    std::string s = "{\"ts\":\"2026-10-18T12:";
+    appendInt(s, random.between(10, 59));
+    s += ":00.123Z\",\"level\":\"" + std::string(random.pick(LogLevels)) + "\",\"host\":\"web-";
+    appendInt(s, random.below(100));
+    s += ".example.internal\",\"msg\":\"";
+    size_t words = random.between(10, 34);
+    for (size_t w = 0; w < words; ++w) {
+        s += (w > 0) ? " " : "";
+        s += random.pick(LogWords);
+    }
+    s += "\",\"latency_ms\":";
+    appendDouble(s, random.between(0, 500000) / 100.0);
+    s += ",\"status\":";
+    appendInt(s, random.chance(95) ? 200 : 503);
+    s += ",\"tags\":[\"web\",\"prod\"]}";
+    return s;
+}
+
+std::string makeRecords(double scale)
+{
+    Random random(6);
+    std::string s = "[";
+    size_t count = scaled(scale, 20000);
+    for (size_t i = 0; i < count; ++i) {
+        s += (i > 0) ? "," : "";
+        s += record(random);
+    }
+    s += ']';
+    return s;
+}
+
+std::string makeRecordLines(double scale)
+{
+    Random random(6);
+    std::string s;
+    size_t count = scaled(scale, 20000);
+    for (size_t i = 0; i < count; ++i) {
+        s += record(random);
+        s += '\n';
+    }
+    return s;
+}
+
+std::vector<Corpus> makeCorpora(double scale)
+{
+    return {
+        { "twitter", makeTwitter(scale) },
+        { "canada", makeCanada(scale) },
+        { "citm", makeCitm(scale) },
+        { "deep", makeDeep(scale) },
+        { "strings", makeStrings(scale) },
+        { "records", makeRecords(scale) }
+    };
+}
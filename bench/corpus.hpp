@@ -0,0 +1,43 @@
+//
+//  corpus.hpp
+//  JsonLib
+//
+
+#ifndef corpus_hpp
+#define corpus_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// JSON texts for benchmarking, generated rather than downloaded. Each is
+// shaped like a well-known benchmark file, and at scale 1 is about the same
+// size. The same scale gives the same text on every platform.
+//
+//  twitter   search results: nested objects, long ids, UTF-8 and escapes
+//  canada    GeoJSON polygons: almost nothing but doubles
+//  citm      an event catalog: integer-named keys, many small objects
+//  deep      values nested hundreds of levels deep
+//  strings   long strings with scattered escapes
+//  records   log records in a large top-level array, the shape that
+//            parses in parallel and that JSON Lines holds one per line
+struct Corpus
+{
+    std::string name;
+    std::string text;
+};
+
+std::string makeTwitter(double scale);
+std::string makeCanada(double scale);
+std::string makeCitm(double scale);
+std::string makeDeep(double scale);
+std::string makeStrings(double scale);
+std::string makeRecords(double scale);
+
+// All of the above, in that order
+std::vector<Corpus> makeCorpora(double scale);
+
+// The records of makeRecords(), one per line, as JSON Lines
+std::string makeRecordLines(double scale);
+
+#endif /* corpus_hpp */
@@ -0,0 +1,406 @@
+//
+//  jsonbench.cpp
+//  JsonLib
+//
+
+// Measures parsing, serializing, copying and comparing over the generated
+// corpora, and writes the results as JSON so that runs on different
+// versions can be diffed:
+//
+//     jsonbench [--scale N] [--min-time SECONDS] [--threads N]
+//               [--filter TEXT] [--out FILE]
+//
+// Each benchmark runs at least five times and for at least --min-time
+// seconds, and reports its best and median time. From the best come MB/s,
+// over the bytes the operation reads or writes, and ns per node, over the
+// values in the tree; ns per node is the figure to compare between text
+// and binary formats. peak_rss_kb is the high-water mark of the whole
+// process while the benchmark ran, corpora included. A summary goes to
+// stderr.
+
+#include "corpus.hpp"
+#include "jsonarray.hpp"
+#include "jsonbinary.hpp"
+#include "jsondocument.hpp"
+#include "jsonlines.hpp"
+#include "jsonobject.hpp"
+#include "jsonsnapshot.hpp"
+#include "jsonwriter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#ifdef __VERSION__
+static const char* const Compiler = __VERSION__;
+#else
+static const char* const Compiler = "unknown";
+#endif
+
+struct Options
+{
+    double scale = 1.0;
+    double minTime = 0.5;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string filter;
+    std::string out;
+};
+
+struct Result
+{
+    std::string corpus;
+    std::string op;
+    unsigned threads = 1;
+    size_t bytes = 0;
+    size_t nodes = 0;
+    size_t runs = 0;
+    double bestNs = 0;
+    double medianNs = 0;
+    long peakRssKb = 0;
+};
+
+// Resets the high-water mark of resident memory where Linux allows it, so
+// that each benchmark reports its own peak
+static void resetPeakRss()
+{
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5";
+}
+
+static long peakRssKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atol(line.c_str() + 6);
+        }
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+static size_t countNodes(const JsonValue& value)
+{
+    size_t n = 1;
+    if (value.type() == JsonValue::Array) {
+        for (const JsonValue& element : value.to_array()) {
+            n += countNodes(element);
+        }
+    }
+    else if (value.type() == JsonValue::Object) {
+        for (const auto& pr : value.to_object()) {
+            n += countNodes(pr.second);
+        }
+    }
+    return n;
+}
+
+static size_t countNodes(JsonSnapshotValue value)
+{
+    size_t n = 1;
+    size_t size = (value.type() == JsonValue::Array || value.type() == JsonValue::Object) ? value.size() : 0;
+    for (size_t i = 0; i < size; ++i) {
+        n += countNodes(value[i]);
+    }
+    return n;
+}
+
+static std::string render(const JsonValue& value, JsonWriter::Style style)
+{
+    std::string out;
+    JsonWriter writer(out, style);
+    writer.write(value);
+    writer.flush();
+    return out;
+}
+
+// Keeps results alive so that the work producing them is not optimized away
+static volatile size_t sink;
+
+class Bench
+{
+public:
+    explicit Bench(const Options& options) : options_(options) {}
+    
+    // Runs 'fn' unless the filter rules it out
+    void run(const std::string& corpus, const std::string& op, unsigned threads, size_t bytes, size_t nodes, const std::function<void()>& fn);
+    
+    const std::vector<Result>& results() const noexcept { return results_; }
+
+private:
+    const Options& options_;
+    std::vector<Result> results_;
+};
+
+void Bench::run(const std::string& corpus, const std::string& op, unsigned threads, size_t bytes, size_t nodes, const std::function<void()>& fn)
+{
+    std::string name = corpus + "/" + op;
+    if (!options_.filter.empty() && name.find(options_.filter) == std::string::npos) {
+        return;
+    }
+    
+    using Clock = std::chrono::steady_clock;
+    resetPeakRss();
+    std::vector<double> times;
+    Clock::time_point start = Clock::now();
+    do {
+        Clock::time_point t = Clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t).count());
+    } while (times.size() < 5 || (std::chrono::duration<double>(Clock::now() - start).count() < options_.minTime && times.size() < 100000));
+    std::sort(times.begin(), times.end());
+    
+    Result r;
+    r.corpus = corpus;
+    r.op = op;
+    r.threads = threads;
+    r.bytes = bytes;
+    r.nodes = nodes;
+    r.runs = times.size();
+    r.bestNs = times.front();
+    r.medianNs = times[times.size() / 2];
+    r.peakRssKb = peakRssKb();
+    results_.push_back(r);
+    
+    std::fprintf(stderr, "%-9s %-16s %3u  %10.1f MB/s %9.2f ns/node %9ld KB\n",
+                 corpus.c_str(), op.c_str(), threads,
+                 bytes / r.bestNs * 1e3, nodes ? r.bestNs / nodes : 0.0, r.peakRssKb);
+}
+
+static void benchCorpus(Bench& bench, const Corpus& corpus)
+{
+    const std::string& text = corpus.text;
+    JsonDocument doc = JsonDocument::from_json(text);
+    if (!doc.isValid()) {
+        std::fprintf(stderr, "%s: the corpus does not parse\n", corpus.name.c_str());
+        return;
+    }
+    const JsonValue& root = doc.to_value();
+    size_t nodes = countNodes(root);
+    const std::string& name = corpus.name;
+    
+    const std::pair<const char*, int> parses[] = {
+        { "parse", JsonDocument::NoFlags },
+        { "parse_arena", JsonDocument::UseArena },
+        { "parse_index", JsonDocument::UseIndex },
+        { "parse_borrow", JsonDocument::BorrowStrings }
+    };
+    for (const auto& parse : parses) {
+        int flags = parse.second;
+        bench.run(name, parse.first, 1, text.size(), nodes, [&]() {
+            sink = JsonDocument::from_json(text, flags).isValid();
+        });
+    }
+    
+    std::string compact = render(root, JsonWriter::Compact);
+    bench.run(name, "write_compact", 1, compact.size(), nodes, [&]() {
+        sink = render(root, JsonWriter::Compact).size();
+    });
+    std::string indented = render(root, JsonWriter::Indented);
+    bench.run(name, "write_indented", 1, indented.size(), nodes, [&]() {
+        sink = render(root, JsonWriter::Indented).size();
+    });
+    
+    // A copy shares the tree; one out of an arena copies all of it
+    bench.run(name, "copy", 1, text.size(), nodes, [&]() {
+        JsonValue copy(root);
+        sink = copy.type();
+    });
+    JsonDocument arenaDoc = JsonDocument::from_json(text, JsonDocument::UseArena);
+    bench.run(name, "deep_copy", 1, text.size(), nodes, [&]() {
+        JsonValue copy(arenaDoc.to_value());
+        sink = copy.type();
+    });
+    // Separately parsed, so nothing is shared and no hash is cached
+    JsonDocument other = JsonDocument::from_json(text);
+    bench.run(name, "equals", 1, text.size(), nodes, [&]() {
+        sink = root.equals(other.to_value());
+    });
+    
+    std::string cbor;
+    JsonCbor::encode(root, cbor);
+    bench.run(name, "cbor_encode", 1, cbor.size(), nodes, [&]() {
+        std::string out;
+        JsonCbor::encode(root, out);
+        sink = out.size();
+    });
+    bench.run(name, "cbor_decode", 1, cbor.size(), nodes, [&]() {
+        JsonValue value;
+        sink = JsonCbor::decode(cbor, value);
+    });
+    std::string msgPack;
+    JsonMsgPack::encode(root, msgPack);
+    bench.run(name, "msgpack_encode", 1, msgPack.size(), nodes, [&]() {
+        std::string out;
+        sink = JsonMsgPack::encode(root, out);
+    });
+    bench.run(name, "msgpack_decode", 1, msgPack.size(), nodes, [&]() {
+        JsonValue value;
+        sink = JsonMsgPack::decode(msgPack, value);
+    });
+    
+    std::string snapshotData;
+    JsonSnapshot::write(root, snapshotData);
+    bench.run(name, "snapshot_write", 1, snapshotData.size(), nodes, [&]() {
+        std::string out;
+        sink = JsonSnapshot::write(root, out);
+    });
+    JsonSnapshot snapshot;
+    snapshot.openData(snapshotData);
+    bench.run(name, "snapshot_walk", 1, snapshotData.size(), nodes, [&]() {
+        sink = countNodes(snapshot.root());
+    });
+}
+
+// The thread sweeps: parallel parsing and writing of a large array, and
+// JSON Lines
+static void benchThreads(Bench& bench, const Options& options)
+{
+    std::string text = makeRecords(options.scale);
+    std::string lines = makeRecordLines(options.scale);
+    JsonDocument doc = JsonDocument::from_json(text);
+    const JsonValue& root = doc.to_value();
+    size_t nodes = countNodes(root);
+    
+    bench.run("records", "parse_parallel", std::max(1u, std::thread::hardware_concurrency()), text.size(), nodes, [&]() {
+        sink = JsonDocument::from_json(text, JsonDocument::Parallel).isValid();
+    });
+    
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < options.threads; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(options.threads);
+    
+    for (unsigned threads : counts) {
+        bench.run("records", "write_parallel", threads, text.size(), nodes, [&]() {
+            std::string out;
+            JsonWriter writer(out);
+            writer.writeParallel(root, threads);
+            writer.flush();
+            sink = out.size();
+        });
+    }
+    for (unsigned threads : counts) {
+        bench.run("records", "json_lines", threads, lines.size(), nodes - 1, [&]() {
+            JsonLinesReader reader(threads);
+            reader.openText(lines);
+            JsonDocument line;
+            size_t n = 0;
+            while (reader.next(line)) {
+                n += line.isValid();
+            }
+            sink = n;
+        });
+    }
+}
+
+static JsonObject toJson(const Result& r)
+{
+    JsonObject o;
+    o.try_emplace("corpus", r.corpus);
+    o.try_emplace("op", r.op);
+    o.try_emplace("threads", r.threads);
+    o.try_emplace("bytes", static_cast<unsigned long long>(r.bytes));
+    o.try_emplace("nodes", static_cast<unsigned long long>(r.nodes));
+    o.try_emplace("runs", static_cast<unsigned long long>(r.runs));
+    o.try_emplace("best_ns", r.bestNs);
+    o.try_emplace("median_ns", r.medianNs);
+    o.try_emplace("mb_per_s", r.bytes / r.bestNs * 1e3);
+    o.try_emplace("ns_per_node", r.nodes ? r.bestNs / r.nodes : 0.0);
+    o.try_emplace("peak_rss_kb", static_cast<long long>(r.peakRssKb));
+    return o;
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 == argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--scale") {
+            options.scale = std::atof(value);
+        }
+        else if (arg == "--min-time") {
+            options.minTime = std::atof(value);
+        }
+        else if (arg == "--threads") {
+            options.threads = std::max(1, std::atoi(value));
+        }
+        else if (arg == "--filter") {
+            options.filter = value;
+        }
+        else if (arg == "--out") {
+            options.out = value;
+        }
+        else {
+            return false;
+        }
+    }
+    return options.scale > 0;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: jsonbench [--scale N] [--min-time SECONDS] [--threads N] [--filter TEXT] [--out FILE]\n");
+        return 2;
+    }
+    
+    Bench bench(options);
+    for (const Corpus& corpus : makeCorpora(options.scale)) {
+        benchCorpus(bench, corpus);
+    }
+    benchThreads(bench, options);
+    
+    JsonObject report;
+    report.try_emplace("library", "JsonLib");
+    report.try_emplace("compiler", Compiler);
+    report.try_emplace("scale", options.scale);
+    report.try_emplace("min_time_s", options.minTime);
+    report.try_emplace("hardware_threads", std::thread::hardware_concurrency());
+    JsonArray results;
+    for (const Result& r : bench.results()) {
+        results.push_back(JsonValue(toJson(r)));
+    }
+    report.try_emplace("results", std::move(results));
+    
+    std::ofstream file;
+    if (!options.out.empty()) {
+        file.open(options.out);
+        if (!file) {
+            std::fprintf(stderr, "cannot write %s\n", options.out.c_str());
+            return 1;
+        }
+    }
+    std::ostream& os = options.out.empty() ? std::cout : file;
+    {
+        JsonWriter writer(os, JsonWriter::Indented);
+        writer.write(report);
+    }
+    os << '\n';
+    return 0;
+}
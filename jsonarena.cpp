@@ -0,0 +1,69 @@
+//
+//  jsonarena.cpp
+//  JsonLib
+//
+
+#include "jsonarena.hpp"
+#include "jsonstats.hpp"
+
+JsonArena::JsonArena(size_t initialSize) :
+    buffer_(initialSize, &upstream_),
+    family_(this)
+{}
+
+size_t JsonArena::bytesAllocated() const noexcept
+{
+    size_t total = allocated_;
+    for (const auto& sibling : siblings_) {
+        total += sibling->allocated_;
+    }
+    return total;
+}
+
+size_t JsonArena::bytesReserved() const noexcept
+{
+    size_t total = upstream_.reserved;
+    for (const auto& sibling : siblings_) {
+        total += sibling->upstream_.reserved;
+    }
+    return total;
+}
+
+JsonArena& JsonArena::addSibling(size_t initialSize)
+{
+    if (family_ != this) {
+        // Keep the whole family in the first arena
+        return family_->addSibling(initialSize);
+    }
+    siblings_.push_back(std::make_unique<JsonArena>(initialSize));
+    siblings_.back()->family_ = this;
+    return *siblings_.back();
+}
+
+void* JsonArena::do_allocate(size_t bytes, size_t alignment)
+{
+    allocated_ += bytes;
+    if (JsonStats::Enabled) {
+        JsonStatsCollector::countAllocation(bytes);
+    }
+    return buffer_.allocate(bytes, alignment);
+}
+
+void* JsonArena::Upstream::do_allocate(size_t bytes, size_t alignment)
+{
+    void* p = resource_->allocate(bytes, alignment);
+    reserved += bytes;
+    return p;
+}
+
+void JsonArena::Upstream::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    reserved -= bytes;
+    resource_->deallocate(p, bytes, alignment);
+}
+
+bool JsonArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    const JsonArena* arena = dynamic_cast<const JsonArena*>(&other);
+    return arena != nullptr && arena->family_ == family_;
+}
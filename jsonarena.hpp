@@ -0,0 +1,69 @@
+//
+//  jsonarena.hpp
+//  JsonLib
+//
+
+#ifndef jsonarena_hpp
+#define jsonarena_hpp
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// A monotonic memory resource that a JsonDocument can build its whole tree
+// in. Allocations are carved out of a few large blocks obtained from the
+// upstream resource, deallocation is a no-op, and everything is handed
+// back at once when the arena is destroyed.
+class JsonArena : public std::pmr::memory_resource
+{
+public:
+    explicit JsonArena(size_t initialSize = 64 * 1024);
+    ~JsonArena() = default;
+
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator=(const JsonArena&) = delete;
+
+    // Bytes handed out to the tree so far, including alignment padding
+    // and what the siblings of this arena handed out
+    size_t bytesAllocated() const noexcept;
+    // Bytes taken from the upstream resource for blocks, including those
+    // of the siblings of this arena
+    size_t bytesReserved() const noexcept;
+    
+    // Another arena, owned by and released with this one, for building part
+    // of the same tree on another thread. The two compare equal, so values
+    // built in one are moved into containers of the other rather than being
+    // copied. Each arena must still only be used by one thread at a time,
+    // and siblings are added before any thread starts using them.
+    JsonArena& addSibling(size_t initialSize = 64 * 1024);
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    // Passes the blocks of buffer_ through from the default resource,
+    // keeping count of them
+    class Upstream : public std::pmr::memory_resource
+    {
+    public:
+        size_t reserved = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+        
+        std::pmr::memory_resource* resource_ = std::pmr::get_default_resource();
+    };
+
+    Upstream upstream_;
+    std::pmr::monotonic_buffer_resource buffer_;
+    size_t allocated_ = 0;
+    // The arena that all siblings were added to
+    JsonArena* family_;
+    std::vector<std::unique_ptr<JsonArena>> siblings_;
+};
+
+#endif /* jsonarena_hpp */
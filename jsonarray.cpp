@@ -8,6 +8,19 @@
 
 #include "jsonarray.hpp"
 #include "jsonobject.hpp"
+#include "jsonwriter.hpp"
+
+JsonArray::JsonArray(std::pmr::memory_resource* resource) :
+    data_(resource)
+{}
+
+JsonArray::JsonArray(const JsonArray& other, std::pmr::memory_resource* resource) :
+    data_(other.data_, resource)
+{}
+
+JsonArray::JsonArray(JsonArray&& other, std::pmr::memory_resource* resource) :
+    data_(std::move(other.data_), resource)
+{}
 
 JsonArray::JsonArray(size_t count) :
     data_(count)
@@ -37,16 +50,34 @@ bool JsonArray::equals(const JsonArray& other) const
     return (data_ == other.data_);
 }
 
-std::ostream& JsonArray::serialize(std::ostream& os) const
+JsonMemoryUsage JsonArray::memoryUsage() const
 {
-    os << "[";
-    if (!data_.empty()) {
-        os << data_.front();
+    JsonMemoryUsage usage;
+    JsonValue::Counted counted;
+    addMemoryUsage(usage, counted);
+    return usage;
+}
+
+void JsonArray::addMemoryUsage(JsonMemoryUsage& usage, JsonValue::Counted& counted) const
+{
+    usage.elements += data_.size() * sizeof(JsonValue);
+    usage.slack += (data_.capacity() - data_.size()) * sizeof(JsonValue);
+    for (const JsonValue& value : data_) {
+        value.addMemoryUsage(usage, counted);
     }
-    for (auto it = data_.cbegin() + 1; it != data_.cend(); ++it) {
-        os << "," << *it;
+}
+
+std::ostream& JsonArray::serialize(std::ostream& os) const
+{
+    if (data_.size() > JsonWriter::SmallContainer) {
+        JsonWriter writer(os);
+        writer.write(*this);
+        return os;
     }
-    return os << "]";
+    char buffer[JsonWriter::SmallBuffer];
+    JsonWriter writer(os, buffer, sizeof(buffer));
+    writer.write(*this);
+    return os;
 }
 
 
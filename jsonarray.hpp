@@ -11,18 +11,24 @@
 
 #include <iostream>
 #include <vector>
+#include <memory_resource>
 #include "jsonvalue.hpp"
 
 class JsonObject;
 
 class JsonArray
 {
-    using JsonVector = std::vector<JsonValue>;
+    using JsonVector = std::pmr::vector<JsonValue>;
 
 public:
     JsonArray() = default;
     ~JsonArray() = default;
     
+    // Elements are allocated from 'resource' instead of the default resource
+    explicit JsonArray(std::pmr::memory_resource* resource);
+    JsonArray(const JsonArray&, std::pmr::memory_resource* resource);
+    JsonArray(JsonArray&&, std::pmr::memory_resource* resource);
+    
     explicit JsonArray(size_t count);
     JsonArray(size_t count, const JsonValue& value);
     template <class InputIt>
@@ -96,12 +102,26 @@ public:
     void push_back(const JsonValue& val) { data_.push_back(val); }
     void push_back(JsonValue&& val)      { data_.push_back(std::move(val)); }
     
+    // Construct an element from 'args' directly on the array's resource
+    template <class... Args>
+    JsonValue& emplace_back(Args&&... args) { return data_.emplace_back(JsonValue::make(resource(), std::forward<Args>(args)...)); }
+    template <class... Args>
+    JsonVector::iterator emplace(JsonVector::const_iterator pos, Args&&... args) { return data_.emplace(pos, JsonValue::make(resource(), std::forward<Args>(args)...)); }
+    
     void pop_back() { data_.pop_back(); }
     
+    std::pmr::memory_resource* resource() const noexcept { return data_.get_allocator().resource(); }
+    
     bool equals(const JsonArray&) const;
+    // The heap memory held by the array and everything in it
+    JsonMemoryUsage memoryUsage() const;
     std::ostream& serialize(std::ostream&) const;
     
 private:
+    friend class JsonValue;
+    
+    void addMemoryUsage(JsonMemoryUsage&, JsonValue::Counted&) const;
+    
     JsonVector data_;
 };
 
@@ -0,0 +1,868 @@
+//
+//  jsonbinary.cpp
+//  JsonLib
+//
+
+#include "jsonbinary.hpp"
+#include "jsonarray.hpp"
+#include "jsonobject.hpp"
+#include "jsonparser.hpp"
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// Both formats are big-endian
+static void putBig(std::string& out, std::uint64_t v, int bytes)
+{
+    char buf[8];
+    for (int i = bytes - 1; i >= 0; --i) {
+        buf[i] = static_cast<char>(v & 0xff);
+        v >>= 8;
+    }
+    out.append(buf, bytes);
+}
+
+static std::uint64_t getBig(const unsigned char* p, int bytes)
+{
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+// Whether a float holds 'd' exactly, so that it can be written in 4 bytes
+static bool fitsFloat(double d)
+{
+    return std::fabs(d) <= FLT_MAX && static_cast<double>(static_cast<float>(d)) == d;
+}
+
+static std::uint32_t floatBits(double d)
+{
+    float f = static_cast<float>(d);
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static std::uint64_t doubleBits(double d)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+// One item of either format, as read by a CborReader or MsgPackReader
+struct BinaryItem
+{
+    enum Kind {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Map,
+        Break       // the end of an indefinite-length array or map
+    };
+
+    Kind kind = Null;
+    bool boolean = false;
+    JsonValue number;
+    std::string_view text;
+    // Elements of an array, or members of a map, unless indefinite
+    std::uint64_t count = 0;
+    bool indefinite = false;
+};
+
+// Reports the items from 'reader' to 'handler', keeping the open arrays
+// and maps on a stack of their own rather than recursing
+template <class Reader>
+static bool decodeItems(Reader& reader, JsonHandler& handler)
+{
+    struct Frame {
+        std::uint64_t remaining;    // items, counting keys and values apart
+        bool map;
+        bool indefinite;
+        bool key;                   // the next item of a map is a key
+    };
+    std::vector<Frame> frames;
+    BinaryItem item;
+
+    do {
+        if (!reader.next(item)) {
+            return false;
+        }
+        bool ok = true;
+        if (item.kind == BinaryItem::Break) {
+            if (frames.empty() || !frames.back().indefinite || (frames.back().map && !frames.back().key)) {
+                return false;
+            }
+            ok = frames.back().map ? handler.onEndObject() : handler.onEndArray();
+            frames.pop_back();
+        }
+        else if (!frames.empty() && frames.back().map && frames.back().key) {
+            if (item.kind != BinaryItem::String) {
+                return false;
+            }
+            ok = handler.onKey(item.text);
+            frames.back().key = false;
+            --frames.back().remaining;
+        }
+        else {
+            if (!frames.empty()) {
+                frames.back().key = frames.back().map;
+                --frames.back().remaining;
+            }
+            switch (item.kind) {
+                case BinaryItem::Null:
+                    ok = handler.onNull();
+                    break;
+                case BinaryItem::Bool:
+                    ok = handler.onBool(item.boolean);
+                    break;
+                case BinaryItem::Number:
+                    ok = handler.onNumber(item.number);
+                    break;
+                case BinaryItem::String:
+                    ok = handler.onString(item.text);
+                    break;
+                case BinaryItem::Array:
+                    ok = handler.onStartArray();
+                    frames.push_back({ item.count, false, item.indefinite, false });
+                    break;
+                case BinaryItem::Map:
+                    ok = handler.onStartObject();
+                    frames.push_back({ item.count * 2, true, item.indefinite, true });
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        // Close the definite-length containers this item completed
+        while (ok && !frames.empty() && !frames.back().indefinite && frames.back().remaining == 0) {
+            ok = frames.back().map ? handler.onEndObject() : handler.onEndArray();
+            frames.pop_back();
+        }
+        if (!ok) {
+            return false;
+        }
+    } while (!frames.empty());
+
+    return reader.atEnd();
+}
+
+template <class Reader>
+static bool decodeTree(std::string_view data, JsonValue& value, std::pmr::memory_resource* resource)
+{
+    JsonDomBuilder builder(resource);
+    Reader reader(data);
+    if (!decodeItems(reader, builder)) {
+        return false;
+    }
+    value = std::move(builder.result());
+    return true;
+}
+
+// An array or object being encoded, and the element or member to go next
+struct EncodeFrame
+{
+    const JsonArray* array;
+    const JsonObject* object;
+    size_t next;
+};
+
+// Writes a scalar with 'Encoder', or the head of an array or object, whose
+// contents are left to encodeItems()
+template <class Encoder>
+static bool encodeItem(const JsonValue& value, std::vector<EncodeFrame>& frames, std::string& out)
+{
+    switch (value.type()) {
+        case JsonValue::Array: {
+            const JsonArray& array = value.to_array();
+            frames.push_back({ &array, nullptr, 0 });
+            return Encoder::arrayHead(out, array.size());
+        }
+        case JsonValue::Object: {
+            const JsonObject& object = value.to_object();
+            frames.push_back({ nullptr, &object, 0 });
+            return Encoder::mapHead(out, object.size());
+        }
+        default:
+            return Encoder::scalar(out, value);
+    }
+}
+
+// Writes the contents of the open arrays and objects, keeping them on a
+// stack of their own rather than recursing, as decodeItems() does
+template <class Encoder>
+static bool encodeItems(std::vector<EncodeFrame>& frames, std::string& out)
+{
+    while (!frames.empty()) {
+        EncodeFrame& frame = frames.back();
+        const JsonValue* value;
+        if (frame.array) {
+            if (frame.next == frame.array->size()) {
+                frames.pop_back();
+                continue;
+            }
+            value = &(*frame.array)[frame.next++];
+        }
+        else {
+            if (frame.next == frame.object->size()) {
+                frames.pop_back();
+                continue;
+            }
+            const auto& pr = frame.object->begin()[frame.next++];
+            if (!Encoder::key(out, pr.first)) {
+                return false;
+            }
+            value = &pr.second;
+        }
+        // May push a frame, after which 'frame' is not to be used
+        if (!encodeItem<Encoder>(*value, frames, out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Encoder>
+static bool encodeTree(const JsonValue& value, std::string& out)
+{
+    std::vector<EncodeFrame> frames;
+    return encodeItem<Encoder>(value, frames, out) && encodeItems<Encoder>(frames, out);
+}
+
+template <class Encoder>
+static bool encodeTree(const JsonArray& array, std::string& out)
+{
+    std::vector<EncodeFrame> frames{ { &array, nullptr, 0 } };
+    return Encoder::arrayHead(out, array.size()) && encodeItems<Encoder>(frames, out);
+}
+
+template <class Encoder>
+static bool encodeTree(const JsonObject& object, std::string& out)
+{
+    std::vector<EncodeFrame> frames{ { nullptr, &object, 0 } };
+    return Encoder::mapHead(out, object.size()) && encodeItems<Encoder>(frames, out);
+}
+
+
+
+// -------------------------------
+// CBOR
+// -------------------------------
+
+// Writes the initial byte of an item of major type 'major' with argument
+// 'n', in as few bytes as possible
+static void cborHead(std::string& out, unsigned major, std::uint64_t n)
+{
+    char type = static_cast<char>(major << 5);
+    if (n < 24) {
+        out += static_cast<char>(type | n);
+    }
+    else if (n <= 0xff) {
+        out += static_cast<char>(type | 24);
+        putBig(out, n, 1);
+    }
+    else if (n <= 0xffff) {
+        out += static_cast<char>(type | 25);
+        putBig(out, n, 2);
+    }
+    else if (n <= 0xffffffff) {
+        out += static_cast<char>(type | 26);
+        putBig(out, n, 4);
+    }
+    else {
+        out += static_cast<char>(type | 27);
+        putBig(out, n, 8);
+    }
+}
+
+static void cborString(std::string& out, std::string_view s)
+{
+    cborHead(out, 3, s.size());
+    out.append(s);
+}
+
+// The items of JsonCbor::encode(), for encodeTree()
+struct CborEncoder
+{
+    static bool scalar(std::string& out, const JsonValue& value)
+    {
+        switch (value.type()) {
+            case JsonValue::Bool:
+                out += static_cast<char>(value.to_bool() ? 0xf5 : 0xf4);
+                break;
+            case JsonValue::Int:
+                if (value.is_uint64() || value.to_int() >= 0) {
+                    cborHead(out, 0, value.to_uint());
+                }
+                else {
+                    // -1 - n, which is ~n in two's complement
+                    cborHead(out, 1, ~static_cast<std::uint64_t>(value.to_int()));
+                }
+                break;
+            case JsonValue::Double: {
+                double d = value.to_double();
+                if (fitsFloat(d)) {
+                    out += static_cast<char>(0xfa);
+                    putBig(out, floatBits(d), 4);
+                }
+                else {
+                    out += static_cast<char>(0xfb);
+                    putBig(out, doubleBits(d), 8);
+                }
+                break;
+            }
+            case JsonValue::String:
+                cborString(out, value.to_string_view());
+                break;
+            default:
+                out += static_cast<char>(0xf6);
+                break;
+        }
+        return true;
+    }
+
+    static bool arrayHead(std::string& out, size_t n)
+    {
+        cborHead(out, 4, n);
+        return true;
+    }
+
+    static bool mapHead(std::string& out, size_t n)
+    {
+        cborHead(out, 5, n);
+        return true;
+    }
+
+    static bool key(std::string& out, std::string_view s)
+    {
+        cborString(out, s);
+        return true;
+    }
+};
+
+void JsonCbor::encode(const JsonValue& value, std::string& out)
+{
+    encodeTree<CborEncoder>(value, out);
+}
+
+void JsonCbor::encode(const JsonArray& array, std::string& out)
+{
+    encodeTree<CborEncoder>(array, out);
+}
+
+void JsonCbor::encode(const JsonObject& object, std::string& out)
+{
+    encodeTree<CborEncoder>(object, out);
+}
+
+static double halfToDouble(unsigned half)
+{
+    int exponent = (half >> 10) & 0x1f;
+    int mantissa = half & 0x3ff;
+    double d;
+    if (exponent == 0) {
+        d = std::ldexp(mantissa, -24);
+    }
+    else if (exponent != 31) {
+        d = std::ldexp(mantissa + 1024, exponent - 25);
+    }
+    else {
+        d = (mantissa == 0) ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    return (half & 0x8000) ? -d : d;
+}
+
+class CborReader
+{
+public:
+    explicit CborReader(std::string_view data) :
+        it_(reinterpret_cast<const unsigned char*>(data.data())),
+        end_(it_ + data.size())
+    {}
+
+    bool next(BinaryItem& item);
+    bool atEnd() const noexcept { return it_ == end_; }
+
+private:
+    bool argument(unsigned info, std::uint64_t& n);
+    bool text(unsigned info, std::string_view& s);
+    size_t left() const noexcept { return end_ - it_; }
+
+    const unsigned char* it_;
+    const unsigned char* end_;
+    // Joins the chunks of indefinite-length strings
+    std::string scratch_;
+};
+
+// Reads the argument that follows an initial byte with additional info 'info'
+bool CborReader::argument(unsigned info, std::uint64_t& n)
+{
+    if (info < 24) {
+        n = info;
+        return true;
+    }
+    if (info > 27) {
+        return false;
+    }
+    int bytes = 1 << (info - 24);
+    if (left() < static_cast<size_t>(bytes)) {
+        return false;
+    }
+    n = getBig(it_, bytes);
+    it_ += bytes;
+    return true;
+}
+
+// Reads the text of a definite-length text string
+bool CborReader::text(unsigned info, std::string_view& s)
+{
+    std::uint64_t n;
+    if (!argument(info, n) || n > left()) {
+        return false;
+    }
+    s = std::string_view(reinterpret_cast<const char*>(it_), n);
+    it_ += n;
+    return true;
+}
+
+bool CborReader::next(BinaryItem& item)
+{
+    unsigned major;
+    unsigned info;
+    // Tags are skipped, leaving the item they tag
+    do {
+        if (it_ == end_) {
+            return false;
+        }
+        major = *it_ >> 5;
+        info = *it_ & 0x1f;
+        ++it_;
+        std::uint64_t tag;
+        if (major == 6 && !argument(info, tag)) {
+            return false;
+        }
+    } while (major == 6);
+
+    std::uint64_t n;
+    item.indefinite = false;
+    switch (major) {
+        case 0:
+            if (!argument(info, n)) {
+                return false;
+            }
+            item.kind = BinaryItem::Number;
+            item.number = JsonValue(static_cast<unsigned long long>(n));
+            return true;
+        case 1:
+            if (!argument(info, n) || n > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+                return false;
+            }
+            item.kind = BinaryItem::Number;
+            item.number = JsonValue(static_cast<long long>(-1 - static_cast<std::int64_t>(n)));
+            return true;
+        case 3:
+            item.kind = BinaryItem::String;
+            if (info != 31) {
+                return text(info, item.text);
+            }
+            // Definite-length chunks up to a break
+            scratch_.clear();
+            for (;;) {
+                if (it_ == end_) {
+                    return false;
+                }
+                unsigned chunk = *it_++;
+                if (chunk == 0xff) {
+                    break;
+                }
+                std::string_view s;
+                if ((chunk >> 5) != 3 || !text(chunk & 0x1f, s)) {
+                    return false;
+                }
+                scratch_.append(s);
+            }
+            item.text = scratch_;
+            return true;
+        case 4:
+        case 5:
+            item.kind = (major == 4) ? BinaryItem::Array : BinaryItem::Map;
+            if (info == 31) {
+                item.indefinite = true;
+                return true;
+            }
+            // Every element takes at least a byte, which also keeps the
+            // count of a map's keys and values from overflowing
+            if (!argument(info, n) || n > left() / (major == 4 ? 1 : 2)) {
+                return false;
+            }
+            item.count = n;
+            return true;
+        case 7:
+            switch (info) {
+                case 20:
+                case 21:
+                    item.kind = BinaryItem::Bool;
+                    item.boolean = (info == 21);
+                    return true;
+                case 22:
+                case 23:
+                    item.kind = BinaryItem::Null;
+                    return true;
+                case 25:
+                case 26:
+                case 27: {
+                    if (!argument(info, n)) {
+                        return false;
+                    }
+                    double d;
+                    if (info == 25) {
+                        d = halfToDouble(static_cast<unsigned>(n));
+                    }
+                    else if (info == 26) {
+                        float f;
+                        std::uint32_t bits = static_cast<std::uint32_t>(n);
+                        std::memcpy(&f, &bits, sizeof(f));
+                        d = f;
+                    }
+                    else {
+                        std::memcpy(&d, &n, sizeof(d));
+                    }
+                    item.kind = BinaryItem::Number;
+                    item.number = JsonValue(d);
+                    return true;
+                }
+                case 31:
+                    item.kind = BinaryItem::Break;
+                    return true;
+                default:
+                    return false;
+            }
+        default:
+            // Byte strings, and tags checked above
+            return false;
+    }
+}
+
+bool JsonCbor::decode(std::string_view data, JsonHandler& handler)
+{
+    CborReader reader(data);
+    return decodeItems(reader, handler);
+}
+
+bool JsonCbor::decode(std::string_view data, JsonValue& value, std::pmr::memory_resource* resource)
+{
+    return decodeTree<CborReader>(data, value, resource);
+}
+
+
+
+// -------------------------------
+// MessagePack
+// -------------------------------
+
+// Writes the header of a string, array or map: the fixed form with the
+// length in the type byte when it fits, else type byte 'base' for a one
+// byte length (strings only), base + 1 for two bytes and base + 2 for four
+static bool msgPackHead(std::string& out, unsigned fixed, unsigned fixedLimit, unsigned base, bool hasByteLength, std::uint64_t n)
+{
+    if (n < fixedLimit) {
+        out += static_cast<char>(fixed | n);
+    }
+    else if (hasByteLength && n <= 0xff) {
+        out += static_cast<char>(base);
+        putBig(out, n, 1);
+    }
+    else if (n <= 0xffff) {
+        out += static_cast<char>(base + 1);
+        putBig(out, n, 2);
+    }
+    else if (n <= 0xffffffff) {
+        out += static_cast<char>(base + 2);
+        putBig(out, n, 4);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+static bool msgPackString(std::string& out, std::string_view s)
+{
+    if (!msgPackHead(out, 0xa0, 32, 0xd9, true, s.size())) {
+        return false;
+    }
+    out.append(s);
+    return true;
+}
+
+// The items of JsonMsgPack::encode(), for encodeTree()
+struct MsgPackEncoder
+{
+    static bool scalar(std::string& out, const JsonValue& value)
+    {
+        switch (value.type()) {
+            case JsonValue::Bool:
+                out += static_cast<char>(value.to_bool() ? 0xc3 : 0xc2);
+                return true;
+            case JsonValue::Int:
+                if (value.is_uint64() || value.to_int() >= 0) {
+                    std::uint64_t u = value.to_uint();
+                    if (u < 0x80) {
+                        out += static_cast<char>(u);
+                    }
+                    else if (u <= 0xff) {
+                        out += static_cast<char>(0xcc);
+                        putBig(out, u, 1);
+                    }
+                    else if (u <= 0xffff) {
+                        out += static_cast<char>(0xcd);
+                        putBig(out, u, 2);
+                    }
+                    else if (u <= 0xffffffff) {
+                        out += static_cast<char>(0xce);
+                        putBig(out, u, 4);
+                    }
+                    else {
+                        out += static_cast<char>(0xcf);
+                        putBig(out, u, 8);
+                    }
+                }
+                else {
+                    std::int64_t i = value.to_int();
+                    std::uint64_t bits = static_cast<std::uint64_t>(i);
+                    if (i >= -32) {
+                        out += static_cast<char>(bits);
+                    }
+                    else if (i >= std::numeric_limits<std::int8_t>::min()) {
+                        out += static_cast<char>(0xd0);
+                        putBig(out, bits, 1);
+                    }
+                    else if (i >= std::numeric_limits<std::int16_t>::min()) {
+                        out += static_cast<char>(0xd1);
+                        putBig(out, bits, 2);
+                    }
+                    else if (i >= std::numeric_limits<std::int32_t>::min()) {
+                        out += static_cast<char>(0xd2);
+                        putBig(out, bits, 4);
+                    }
+                    else {
+                        out += static_cast<char>(0xd3);
+                        putBig(out, bits, 8);
+                    }
+                }
+                return true;
+            case JsonValue::Double: {
+                double d = value.to_double();
+                if (fitsFloat(d)) {
+                    out += static_cast<char>(0xca);
+                    putBig(out, floatBits(d), 4);
+                }
+                else {
+                    out += static_cast<char>(0xcb);
+                    putBig(out, doubleBits(d), 8);
+                }
+                return true;
+            }
+            case JsonValue::String:
+                return msgPackString(out, value.to_string_view());
+            default:
+                out += static_cast<char>(0xc0);
+                return true;
+        }
+    }
+
+    static bool arrayHead(std::string& out, size_t n)
+    {
+        return msgPackHead(out, 0x90, 16, 0xdb, false, n);
+    }
+
+    static bool mapHead(std::string& out, size_t n)
+    {
+        return msgPackHead(out, 0x80, 16, 0xdd, false, n);
+    }
+
+    static bool key(std::string& out, std::string_view s)
+    {
+        return msgPackString(out, s);
+    }
+};
+
+bool JsonMsgPack::encode(const JsonValue& value, std::string& out)
+{
+    return encodeTree<MsgPackEncoder>(value, out);
+}
+
+bool JsonMsgPack::encode(const JsonArray& array, std::string& out)
+{
+    return encodeTree<MsgPackEncoder>(array, out);
+}
+
+bool JsonMsgPack::encode(const JsonObject& object, std::string& out)
+{
+    return encodeTree<MsgPackEncoder>(object, out);
+}
+
+class MsgPackReader
+{
+public:
+    explicit MsgPackReader(std::string_view data) :
+        it_(reinterpret_cast<const unsigned char*>(data.data())),
+        end_(it_ + data.size())
+    {}
+
+    bool next(BinaryItem& item);
+    bool atEnd() const noexcept { return it_ == end_; }
+
+private:
+    bool read(int bytes, std::uint64_t& n);
+    bool text(std::uint64_t n, BinaryItem& item);
+    bool container(BinaryItem::Kind kind, std::uint64_t n, BinaryItem& item);
+    size_t left() const noexcept { return end_ - it_; }
+
+    const unsigned char* it_;
+    const unsigned char* end_;
+};
+
+bool MsgPackReader::read(int bytes, std::uint64_t& n)
+{
+    if (left() < static_cast<size_t>(bytes)) {
+        return false;
+    }
+    n = getBig(it_, bytes);
+    it_ += bytes;
+    return true;
+}
+
+bool MsgPackReader::text(std::uint64_t n, BinaryItem& item)
+{
+    if (n > left()) {
+        return false;
+    }
+    item.kind = BinaryItem::String;
+    item.text = std::string_view(reinterpret_cast<const char*>(it_), n);
+    it_ += n;
+    return true;
+}
+
+bool MsgPackReader::container(BinaryItem::Kind kind, std::uint64_t n, BinaryItem& item)
+{
+    // Every element takes at least a byte
+    if (n > left() / (kind == BinaryItem::Array ? 1 : 2)) {
+        return false;
+    }
+    item.kind = kind;
+    item.count = n;
+    return true;
+}
+
+bool MsgPackReader::next(BinaryItem& item)
+{
+    if (it_ == end_) {
+        return false;
+    }
+    unsigned type = *it_++;
+    item.indefinite = false;
+
+    if (type <= 0x7f || type >= 0xe0) {
+        item.kind = BinaryItem::Number;
+        item.number = JsonValue(static_cast<int>(static_cast<std::int8_t>(type)));
+        return true;
+    }
+    if (type <= 0x8f) {
+        return container(BinaryItem::Map, type & 0x0f, item);
+    }
+    if (type <= 0x9f) {
+        return container(BinaryItem::Array, type & 0x0f, item);
+    }
+    if (type <= 0xbf) {
+        return text(type & 0x1f, item);
+    }
+
+    std::uint64_t n;
+    switch (type) {
+        case 0xc0:
+            item.kind = BinaryItem::Null;
+            return true;
+        case 0xc2:
+        case 0xc3:
+            item.kind = BinaryItem::Bool;
+            item.boolean = (type == 0xc3);
+            return true;
+        case 0xca:
+        case 0xcb: {
+            if (!read(type == 0xca ? 4 : 8, n)) {
+                return false;
+            }
+            double d;
+            if (type == 0xca) {
+                float f;
+                std::uint32_t bits = static_cast<std::uint32_t>(n);
+                std::memcpy(&f, &bits, sizeof(f));
+                d = f;
+            }
+            else {
+                std::memcpy(&d, &n, sizeof(d));
+            }
+            item.kind = BinaryItem::Number;
+            item.number = JsonValue(d);
+            return true;
+        }
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+            if (!read(1 << (type - 0xcc), n)) {
+                return false;
+            }
+            item.kind = BinaryItem::Number;
+            item.number = JsonValue(static_cast<unsigned long long>(n));
+            return true;
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3: {
+            int bytes = 1 << (type - 0xd0);
+            if (!read(bytes, n)) {
+                return false;
+            }
+            // Sign-extend from the top bit of the value read
+            int shift = 64 - 8 * bytes;
+            std::int64_t i = static_cast<std::int64_t>(n << shift) >> shift;
+            item.kind = BinaryItem::Number;
+            item.number = JsonValue(static_cast<long long>(i));
+            return true;
+        }
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            return read(1 << (type - 0xd9), n) && text(n, item);
+        case 0xdc:
+        case 0xdd:
+            return read(type == 0xdc ? 2 : 4, n) && container(BinaryItem::Array, n, item);
+        case 0xde:
+        case 0xdf:
+            return read(type == 0xde ? 2 : 4, n) && container(BinaryItem::Map, n, item);
+        default:
+            // Binary data, extension types, and the unused 0xc1
+            return false;
+    }
+}
+
+bool JsonMsgPack::decode(std::string_view data, JsonHandler& handler)
+{
+    MsgPackReader reader(data);
+    return decodeItems(reader, handler);
+}
+
+bool JsonMsgPack::decode(std::string_view data, JsonValue& value, std::pmr::memory_resource* resource)
+{
+    return decodeTree<MsgPackReader>(data, value, resource);
+}
@@ -0,0 +1,60 @@
+//
+//  jsonbinary.hpp
+//  JsonLib
+//
+
+#ifndef jsonbinary_hpp
+#define jsonbinary_hpp
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include "jsonvalue.hpp"
+
+class JsonArray;
+class JsonObject;
+class JsonHandler;
+
+// Binary encodings of the JSON data model, which are smaller than JSON text
+// and much cheaper to read: lengths come first, so strings are not scanned
+// and numbers are not converted from decimal. Ints and Doubles keep their
+// types, whichever their values, and a Double that a float holds exactly
+// is written as a float. Encodings are appended to a std::string used as a
+// byte buffer.
+//
+// Decoding reports the items to a JsonHandler, the same events JsonParser
+// gives for the equivalent JSON text, or builds a tree with JsonDomBuilder.
+// The input must hold exactly one item. Items with no JSON counterpart,
+// such as byte strings or map keys other than strings, make decoding fail.
+// Neither encoding nor decoding recurses, so a tree of any depth that fits
+// in memory goes through both.
+
+// CBOR (RFC 8949). Encodes with definite lengths; decodes definite and
+// indefinite lengths, half-precision floats, and tagged items as the item
+// without its tag. Undefined decodes as null.
+class JsonCbor
+{
+public:
+    static void encode(const JsonValue&, std::string& out);
+    static void encode(const JsonArray&, std::string& out);
+    static void encode(const JsonObject&, std::string& out);
+
+    static bool decode(std::string_view data, JsonHandler& handler);
+    static bool decode(std::string_view data, JsonValue& value, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+};
+
+// MessagePack. Strings, arrays and objects are limited to 2^32 - 1 bytes
+// or elements; encode() returns false, having written part of the value,
+// on one that is larger. Extension types do not decode.
+class JsonMsgPack
+{
+public:
+    static bool encode(const JsonValue&, std::string& out);
+    static bool encode(const JsonArray&, std::string& out);
+    static bool encode(const JsonObject&, std::string& out);
+
+    static bool decode(std::string_view data, JsonHandler& handler);
+    static bool decode(std::string_view data, JsonValue& value, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+};
+
+#endif /* jsonbinary_hpp */
@@ -7,35 +7,116 @@
 //
 
 #include "jsondocument.hpp"
+#include "jsonindex.hpp"
+#include "jsonparser.hpp"
+#include "jsonwriter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
-std::ostream& buildJson(std::ostream& os, const JsonValue& val, int tabLevel);
-std::ostream& buildJson(std::ostream& os, const JsonArray& val, int tabLevel);
-std::ostream& buildJson(std::ostream& os, const JsonObject& val, int tabLevel);
-
-JsonValue parseValue(std::istream&, bool& ok);
-JsonArray parseArray(std::istream&, bool& ok);
-JsonObject parseObject(std::istream&, bool& ok);
-JsonValue parseLiteral(std::istream&, bool& ok);
-std::string parseString(std::istream&, bool& ok);
-std::string parseEscape(std::istream&, bool& ok);
-JsonValue parseNumeric(std::istream&, bool& ok);
+// The resource to build a parsed tree on: the document's own, or one that
+// counts the allocations made on it when gathering stats
+static std::pmr::memory_resource* buildResource(std::pmr::memory_resource* resource, JsonStats* stats)
+{
+    return (JsonStats::Enabled && stats) ? JsonStatsCollector::counted(resource) : resource;
+}
 
 JsonDocument::JsonDocument(Format format) :
     format_(format)
 {}
 
 JsonDocument::JsonDocument(const JsonArray& a, Format format) :
-    array_(a),
-    type_(JsonValue::Array),
+    root_(a),
     format_(format)
 {}
 
 JsonDocument::JsonDocument(const JsonObject& o, Format format) :
-    object_(o),
-    type_(JsonValue::Object),
+    root_(o),
+    format_(format)
+{}
+
+JsonDocument::JsonDocument(JsonArray&& a, Format format) :
+    root_(std::move(a)),
     format_(format)
 {}
 
+JsonDocument::JsonDocument(JsonObject&& o, Format format) :
+    root_(std::move(o)),
+    format_(format)
+{}
+
+JsonDocument::~JsonDocument()
+{
+    dropTree();
+}
+
+JsonDocument::JsonDocument(const JsonDocument& other) :
+    arena_(other.arena_ ? std::make_unique<JsonArena>() : nullptr),
+    root_(other.root_, resource()),
+    format_(other.format_),
+    parseOk_(other.parseOk_),
+    max_indent_(other.max_indent_)
+{}
+
+JsonDocument& JsonDocument::operator=(const JsonDocument& other)
+{
+    if (this != &other) {
+        JsonDocument copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+JsonDocument& JsonDocument::operator=(JsonDocument&& other)
+{
+    if (this != &other) {
+        dropTree();
+        root_ = std::move(other.root_);
+        arena_ = std::move(other.arena_);
+        file_ = std::move(other.file_);
+        text_ = std::move(other.text_);
+        format_ = other.format_;
+        parseOk_ = other.parseOk_;
+        edited_ = other.edited_;
+        max_indent_ = other.max_indent_;
+    }
+    return *this;
+}
+
+const JsonArray& JsonDocument::to_array() const
+{
+    static const JsonArray empty;
+    return root_.type() == JsonValue::Array ? root_.to_array() : empty;
+}
+
+const JsonObject& JsonDocument::to_object() const
+{
+    static const JsonObject empty;
+    return root_.type() == JsonValue::Object ? root_.to_object() : empty;
+}
+
+JsonArray& JsonDocument::mutable_array()
+{
+    if (root_.type() != JsonValue::Array) {
+        setArray(JsonArray(resource()));
+    }
+    edited_ = true;
+    return root_.mutable_array();
+}
+
+JsonObject& JsonDocument::mutable_object()
+{
+    if (root_.type() != JsonValue::Object) {
+        setObject(JsonObject(resource()));
+    }
+    edited_ = true;
+    return root_.mutable_object();
+}
+
 void JsonDocument::setFormat(Format format)
 {
     format_ = format;
@@ -48,412 +129,411 @@ void JsonDocument::setMaxIndent(int max)
 
 void JsonDocument::setArray(const JsonArray& a)
 {
-    type_ = JsonValue::Array;
-    array_ = a;
-    object_.clear();
+    root_ = JsonValue(a, resource());
+    file_.reset();
+    text_.reset();
 }
 
 void JsonDocument::setObject(const JsonObject& o)
 {
-    type_ = JsonValue::Object;
-    object_ = o;
-    array_.clear();
+    root_ = JsonValue(o, resource());
+    file_.reset();
+    text_.reset();
 }
 
-std::ostream& JsonDocument::to_json(std::ostream &os) const
+void JsonDocument::setArray(JsonArray&& a)
 {
-    if (format_ == Compact) {
-        if (type_ == JsonValue::Array) {
-            os << array_;
-        }
-        else if (type_ == JsonValue::Object) {
-            os << object_;
-        }
-        else {
-            os << "{}";
-        }
+    root_ = JsonValue(std::move(a), resource());
+    // What is moved in may still borrow from this document's text
+    if (!root_.borrowsText()) {
+        file_.reset();
+        text_.reset();
     }
-    else {
-        if (type_ == JsonValue::Array) {
-            return buildJson(os, array_, 0);
-        }
-        else if (type_ == JsonValue::Object) {
-            return buildJson(os, object_, 0);
-        }
-        else {
-            os << "{\n}";
-        }
-    }
-    return os;
 }
 
-//std::istream& JsonDocument::from_json(std::istream& is)
-void JsonDocument::from_json(std::istream &is)
+void JsonDocument::setObject(JsonObject&& o)
 {
-    // Start with either a JsonObject or a JsonArray
-    char c = is.peek();
-    if (is.good()) {
-        switch (c) {
-            case '[':
-                type_ = JsonValue::Array;
-                array_ = parseArray(is, parseOk_);
-                break;
-            case '{':
-                type_ = JsonValue::Object;
-                object_ = parseObject(is, parseOk_);
-                break;
-            default:
-                type_ = JsonValue::Null;
-                array_.clear();
-                object_.clear();
-                parseOk_ = false;
-                break;
-        }
+    root_ = JsonValue(std::move(o), resource());
+    // What is moved in may still borrow from this document's text
+    if (!root_.borrowsText()) {
+        file_.reset();
+        text_.reset();
     }
 }
 
-
-std::ostream& operator<<(std::ostream& os, const JsonDocument& doc)
-{
-    return doc.to_json(os);
-}
-
-void operator>>(std::istream& is, JsonDocument& doc)
+std::pmr::memory_resource* JsonDocument::resource() const noexcept
 {
-    doc.from_json(is);
+    return arena_ ? arena_.get() : std::pmr::get_default_resource();
 }
 
-
-void insertTab(std::ostream& os, int n)
+JsonMemoryUsage JsonDocument::memoryUsage() const
 {
-    while (n--) {
-        os << '\t';
+    JsonMemoryUsage usage = root_.memoryUsage();
+    if (arena_) {
+        // The tree is all in the arena; what else it holds is lost to it
+        size_t tree = usage.total();
+        size_t reserved = arena_->bytesReserved();
+        usage.arena = reserved > tree ? reserved - tree : 0;
+    }
+    if (text_) {
+        usage.text = sizeof(std::string) + JsonValue::textBytes(*text_);
+    }
+    if (file_) {
+        usage.mapped = file_->data().size();
     }
+    return usage;
 }
 
-std::ostream& buildJson(std::ostream& os, const JsonValue& val, int tabLevel)
+// Where each distinct string of a tree is placed in the pool of compact()
+using StringPool = std::unordered_map<std::string_view, size_t>;
+
+static void gatherStrings(const JsonValue& value, StringPool& pool, size_t& size)
 {
-    switch (val.type()) {
+    switch (value.type()) {
+        case JsonValue::String:
+            if (pool.try_emplace(value.to_string_view(), size).second) {
+                size += value.to_string_view().size();
+            }
+            break;
         case JsonValue::Array:
-            buildJson(os, val.to_array(), tabLevel);
+            for (const JsonValue& element : value.to_array()) {
+                gatherStrings(element, pool, size);
+            }
             break;
         case JsonValue::Object:
-            buildJson(os, val.to_object(), tabLevel);
+            for (const auto& pr : value.to_object()) {
+                gatherStrings(pr.second, pool, size);
+            }
             break;
         default:
-            os << val;
+            break;
     }
-    return os;
 }
 
-std::ostream& buildJson(std::ostream& os, const JsonArray& array, int tabLevel)
+// A copy of 'value' on 'r' with no spare capacity. Strings are borrowed
+// from 'text' where 'pool' places them, when there is a pool.
+static JsonValue compactValue(const JsonValue& value, std::pmr::memory_resource* r, const StringPool* pool, const char* text)
 {
-    os << "[\n";
-    size_t i = 0;
-    size_t sz = array.size();
-    for (const JsonValue& value : array) {
-        insertTab(os, tabLevel + 1);
-        buildJson(os, value, tabLevel + 1);
-        if (i++ < sz - 1) {
-            os << ",";
+    switch (value.type()) {
+        case JsonValue::String:
+            if (pool) {
+                std::string_view s = value.to_string_view();
+                return JsonValue::borrow(std::string_view(text + pool->find(s)->second, s.size()));
+            }
+            if (value.is_borrowed()) {
+                return JsonValue::borrow(value.to_string_view());
+            }
+            return JsonValue(value.to_string_view(), r);
+        case JsonValue::Array: {
+            const JsonArray& from = value.to_array();
+            JsonArray array(r);
+            array.reserve(from.size());
+            for (const JsonValue& element : from) {
+                array.emplace_back(compactValue(element, r, pool, text));
+            }
+            return JsonValue(std::move(array), r);
         }
-        os << "\n";
+        case JsonValue::Object: {
+            const JsonObject& from = value.to_object();
+            JsonObject object(r);
+            object.reserve(from.size());
+            for (const auto& pr : from) {
+                object.try_emplace(pr.first, compactValue(pr.second, r, pool, text));
+            }
+            return JsonValue(std::move(object), r);
+        }
+        default:
+            return value;
     }
-    insertTab(os, tabLevel);
-    return os << "]";
 }
 
-std::ostream& buildJson(std::ostream& os, const JsonObject& object, int tabLevel)
+void JsonDocument::compact(bool poolStrings)
 {
-    os << "{\n";
-    size_t i = 0;
-    size_t sz = object.size();
-    for (const auto& pr : object) {
-        insertTab(os, tabLevel + 1);
-        os << "\"" << pr.first << "\": ";
-        buildJson(os, pr.second, tabLevel + 1);
-        if (i++ < sz - 1) {
-            os << ",";
+    JsonMemoryUsage usage = root_.memoryUsage();
+    if (usage.total() == 0) {
+        return;
+    }
+    
+    StringPool pool;
+    std::unique_ptr<std::string> text;
+    if (poolStrings) {
+        size_t size = 0;
+        gatherStrings(root_, pool, size);
+        text = std::make_unique<std::string>(size, '\0');
+        for (const auto& placed : pool) {
+            std::memcpy(text->data() + placed.second, placed.first.data(), placed.first.size());
         }
-        os << "\n";
     }
-    insertTab(os, tabLevel);
-    return os << "}";
+    
+    std::unique_ptr<JsonArena> arena;
+    if (arena_) {
+        // Room for the tree without its slack or pooled strings, so that it
+        // fits in the first block. Only the text of keys and strings may
+        // need padding after it, less than 8 bytes for at least 17.
+        size_t strings = poolStrings ? 0 : usage.strings;
+        size_t size = usage.total() - usage.slack - usage.strings + strings;
+        arena = std::make_unique<JsonArena>(std::max<size_t>(size + (usage.keys + strings) / 2, 4096));
+    }
+    std::pmr::memory_resource* r = arena ? arena.get() : std::pmr::get_default_resource();
+    JsonValue root = compactValue(root_, r, poolStrings ? &pool : nullptr, text ? text->data() : nullptr);
+    
+    dropTree();
+    root_ = std::move(root);
+    arena_ = std::move(arena);
+    edited_ = false;
+    if (poolStrings) {
+        // Nothing borrows from the text or file any more
+        text_ = std::move(text);
+        file_.reset();
+    }
 }
 
-
-// Consume whitespace
-void eatWs(std::istream& is)
+// Drops the current tree and prepares for a new parse
+void JsonDocument::reset(int flags, size_t sizeHint)
 {
-    for (;;) {
-        char c = is.peek();
-        if (is.good() && std::isspace(c)) {
-            c = is.get();
-        }
-        else {
-            break;
-        }
+    dropTree();
+    arena_.reset();
+    file_.reset();
+    text_.reset();
+    if (flags & UseArena) {
+        // A parsed tree is usually about as large as its text, so start
+        // with one block of that size and let the arena grow from there
+        arena_ = std::make_unique<JsonArena>(std::max<size_t>(sizeHint, 4096));
     }
+    parseOk_ = true;
+    edited_ = false;
 }
 
-JsonValue parseValue(std::istream& is, bool& ok)
+void JsonDocument::dropTree() noexcept
 {
-    char c = is.peek();
-    if (is.good()) {
-        switch (c) {
-            case '[':
-                // start new array
-                return parseArray(is, ok);
-                break;
-            case '{':
-                // start new object
-                return parseObject(is, ok);
-                break;
-            case '"':
-                // start a string
-                return parseString(is, ok);
-                break;
-            case ']':
-                // end of this value (empty array)
-                break;
-            case '}':
-                // not expected
-                ok = false;
-                break;
-            case 't':   // true (fallthrough)
-            case 'f':   // false (fallthrough)
-            case 'n':   // null (fallthrough)
-                return parseLiteral(is, ok);
-                break;
-            default:
-                return parseNumeric(is, ok);
-                // Attempt to process numeric value
-                break;
-        }
+    if (arena_ && !edited_) {
+        // Every node of the tree lives in the arena, which releases them all
+        root_.abandon();
     }
-    
-    return JsonValue();
+    root_ = JsonValue();
 }
 
-// Make JsonArrays, JsonObjects from the stream
-JsonArray parseArray(std::istream& is, bool& ok)
+std::ostream& JsonDocument::to_json(std::ostream &os, unsigned threads, JsonStats* stats) const
 {
-    JsonArray array;
-    
-    // [ true , +2.5, "a string" ]
-    
-    is.get();   // opening [
-    
-    char c;
-    
-    for (;;) {
-        eatWs(is);
-        
-        array.push_back(parseValue(is, ok));
-        
-        eatWs(is);
-        
-        // If next char is ',' keep going in the loop.
-        // If next char is ']' then we're done with this array
-        c = is.get();
-        if (c == ']') {
-            break;
+    JsonStatsCollector collector(stats, &JsonStats::writeNs);
+    JsonWriter writer(os, format_ == Compact ? JsonWriter::Compact : JsonWriter::Indented);
+    if (root_.type() == JsonValue::Array || root_.type() == JsonValue::Object) {
+        if (threads == 1) {
+            writer.write(root_);
+        }
+        else {
+            writer.writeParallel(root_, threads);
         }
     }
-    
-    return array;
+    else {
+        writer.writeRaw(format_ == Compact ? "{}" : "{\n}");
+    }
+    writer.flush();
+    if (JsonStats::Enabled && stats) {
+        stats->bytesWritten += writer.size();
+    }
+    return os;
 }
 
-JsonObject parseObject(std::istream& is, bool& ok)
+void JsonDocument::from_json(std::istream &is, int flags, JsonStats* stats)
 {
-    JsonObject object;
-    
-    // { "key" : value, "key" : value, }
-    
-    is.get();   // opening {
-    
-    char c;
-    
-    for (;;) {
-        eatWs(is);
-        
-        // Get key
-        std::string key = parseString(is, ok);
-        
-        eatWs(is);
-        
-        // Get :
-        c = is.get();
-        if (!is.good() || c != ':') {
-            // Not a proper object. What should we do?
-            // Consume the stream until the next closing '}' brace, if available, then return what we've parsed so far
-            while (is.good()) {
-                c = is.get();
-                if (c == '}') {
-                    break;
-                }
-            }
-            ok = false;
-            return object;
+    JsonStatsCollector collector(stats, &JsonStats::parseNs);
+    // The stream is parsed as it is read, a block at a time
+    reset(flags & ~BorrowStrings, 0);
+    {
+        JsonDomBuilder builder(buildResource(resource(), stats));
+        JsonParser parser(builder);
+        parser.setStats(stats);
+        parseOk_ = parser.parse(is);
+        if (JsonStats::Enabled && stats) {
+            stats->bytesParsed += parser.offset();
         }
-        
-        eatWs(is);
-        
-        // Get value and add it to the JsonObject
-        object[key] = parseValue(is, ok);
-        
-        eatWs(is);
-        
-        // If next char is ',' keep going in the loop.
-        // If next char is '}' then we're done with this object
-        c = is.get();
-        if (c == '}') {
-            break;
+        JsonValue::Type type = builder.result().type();
+        if (parseOk_ && (type == JsonValue::Array || type == JsonValue::Object)) {
+            root_ = std::move(builder.result());
         }
-        if (c != ',') {
-            // Not a proper object. What should we do?
-            // Consume the stream until the next closing '}' brace, if available, then return what we've parsed so far
-            while (is.good()) {
-                c = is.get();
-                if (c == '}') {
-                    break;
-                }
-            }
-            ok = false;
-            return object;
+        else {
+            parseOk_ = false;
         }
     }
-    
-    return object;
+    if (!parseOk_) {
+        reset(NoFlags, 0);
+        parseOk_ = false;
+    }
 }
 
-std::string parseString(std::istream& is, bool& ok)
+JsonDocument JsonDocument::from_json(std::string_view json, int flags, JsonStats* stats)
 {
-    std::string s;
-    char c = is.get();  // opening "
-    for (;;) {
-        c = is.peek();
-        if (is.good()) {
-            if (c == '\\') {
-                s += parseEscape(is, ok);
-            }
-            else if (c == '"') {
-                is.get();   // closing "
-                break;
-            }
-            else {
-                s.push_back(is.get());
-            }
-        }
-        else {
-            break;
-        }
+    JsonDocument doc;
+    doc.parse(json, flags, stats);
+    return doc;
+}
+
+JsonDocument JsonDocument::from_json_in_situ(std::string&& text, int flags, JsonStats* stats)
+{
+    JsonDocument doc;
+    // Held through a pointer, since moving a short string would move its
+    // characters too
+    auto owned = std::make_unique<std::string>(std::move(text));
+    doc.parse(*owned, flags | BorrowStrings | DecodeInPlace, stats);
+    if (doc.parseOk_) {
+        doc.text_ = std::move(owned);
     }
-    return s;
+    return doc;
 }
 
-std::string parseEscape(std::istream& is, bool& ok)
+JsonDocument JsonDocument::from_file(const std::string& path, int flags, JsonStats* stats)
 {
-    std::string s;
-    is.get();   // initial '\' to start the escape
-    char c = is.get();
-    if (is.good()) {
-        switch (c) {
-            case '"':
-                s.push_back('"');
-                break;
-            case '\\':
-                s.push_back('\\');
-                break;
-            case '/':
-                s.push_back('/');
-                break;
-            case 'b':
-                s.push_back('\b');
-                break;
-            case 'f':
-                s.push_back('\f');
-                break;
-            case 'n':
-                s.push_back('\n');
-                break;
-            case 'r':
-                s.push_back('\r');
-                break;
-            case 't':
-                s.push_back('\t');
-                break;
-            default:
-                ok = false;
-                break;
-        }
+    JsonDocument doc;
+    auto file = std::make_unique<JsonMappedFile>();
+    if (!file->open(path)) {
+        doc.parseOk_ = false;
+        return doc;
+    }
+    doc.parse(file->data(), flags, stats);
+    if (doc.parseOk_ && (flags & BorrowStrings)) {
+        doc.file_ = std::move(file);
     }
-    return s;
+    return doc;
 }
 
-JsonValue parseLiteral(std::istream& is, bool& ok)
+void JsonDocument::parse(std::string_view json, int flags, JsonStats* stats)
 {
-    // read up to: whitespace, comma, ], }, or EOF (or other failure).
-    std::string word;
-    char c;
-    for (;;) {
-        c = is.peek();
-        if (is.good()) {
-            if (std::isspace(c) || c == ',' || c == ']' || c == '}') {
-                break;
-            }
-            word.push_back(is.get());
+    JsonDomBuilder builder;
+    JsonParser parser(builder);
+    parse(json, flags, builder, parser, stats);
+}
+
+// Parses with a builder and parser that may be reused from one document to
+// the next, as when many small documents are parsed in a row
+void JsonDocument::parse(std::string_view json, int flags, JsonDomBuilder& builder, JsonParser& parser, JsonStats* stats)
+{
+    JsonStatsCollector collector(stats, &JsonStats::parseNs);
+    if (JsonStats::Enabled && stats) {
+        stats->bytesParsed += json.size();
+    }
+    reset(flags, json.size());
+    
+    // Start with either a JsonObject or a JsonArray
+    size_t first = json.find_first_not_of(" \t\n\r");
+    if (first != std::string_view::npos && json[first] == '[' && (flags & Parallel) && json.size() >= ParallelThreshold) {
+        parseOk_ = parseParallel(json, flags, stats);
+    }
+    else if (first != std::string_view::npos && (json[first] == '[' || json[first] == '{')) {
+        builder.reset(buildResource(resource(), stats));
+        builder.borrowStrings((flags & BorrowStrings) ? json : std::string_view());
+        parser.setIndexed(flags & UseIndex);
+        parser.setStats(stats);
+        if (flags & DecodeInPlace) {
+            parseOk_ = parser.parseInSitu(const_cast<char*>(json.data()), json.size());
         }
         else {
-            break;
+            parseOk_ = parser.parse(json);
         }
+        if (parseOk_) {
+            root_ = std::move(builder.result());
+        }
+        // Release what a failed parse left while the arena is still there
+        builder.reset(std::pmr::get_default_resource());
     }
-    
-    if (word == "true") {
-        return true;
-    }
-    else if (word == "false") {
-        return false;
+    else {
+        parseOk_ = false;
     }
-    else if (word == "null") {
-        return JsonValue();
+    
+    if (!parseOk_) {
+        reset(NoFlags, 0);
+        parseOk_ = false;
     }
-    ok = false;
-    return JsonValue();
 }
 
-JsonValue parseNumeric(std::istream& is, bool& ok)
+// Each range between two cuts is parsed as an array of its own, by feeding
+// the parser the range with brackets around it. If every range parses and
+// none is empty, the ranges joined by the cut commas are exactly the whole
+// array, so the result is only valid when the whole text is.
+bool JsonDocument::parseParallel(std::string_view json, int flags, JsonStats* stats)
 {
-    std::string word;
-    char c;
-    for (;;) {
-        c = is.peek();
-        if (is.good()) {
-            if (c == ',' || c == ']' || c == '}') {
-                break;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> cuts = JsonIndex::splitArray(json, threads * PartsPerThread);
+    size_t parts = cuts.size() + 1;
+    
+    struct Part {
+        std::pmr::memory_resource* resource;
+        JsonValue elements;
+        bool ok = false;
+    };
+    std::vector<Part> results(parts);
+    for (Part& part : results) {
+        // Threads build in sibling arenas, whose values move into arena_
+        part.resource = arena_ ? &arena_->addSibling(std::max<size_t>(json.size() / parts, 4096)) : buildResource(resource(), stats);
+    }
+    size_t workers = std::min<size_t>(threads, parts);
+    // Each thread counts into its own, merged once they are done
+    std::vector<JsonStats> workerStats(stats ? workers : 0);
+    
+    std::atomic<size_t> next(0);
+    auto work = [&](size_t worker) {
+        JsonStats* local = stats ? &workerStats[worker] : nullptr;
+        JsonStatsCollector collector(local);
+        JsonDomBuilder builder;
+        JsonParser parser(builder);
+        parser.setStats(local);
+        for (size_t i = next++; i < parts; i = next++) {
+            Part& part = results[i];
+            builder.reset(part.resource);
+            builder.borrowStrings((flags & BorrowStrings) ? json : std::string_view());
+            size_t begin = (i == 0) ? 0 : cuts[i - 1] + 1;
+            size_t end = (i == parts - 1) ? json.size() : cuts[i];
+            bool ok = (i == 0 || parser.feed("[")) &&
+                      parser.feed(json.substr(begin, end - begin)) &&
+                      (i == parts - 1 || parser.feed("]"));
+            ok = parser.finish() && ok;
+            if (ok && builder.result().type() == JsonValue::Array && (parts == 1 || !builder.result().to_array().empty())) {
+                part.elements = std::move(builder.result());
+                part.ok = true;
             }
-            word.push_back(is.get());
+            builder.reset(std::pmr::get_default_resource());
         }
-        else {
-            break;
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < workers; ++t) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    if (JsonStats::Enabled && stats) {
+        for (const JsonStats& local : workerStats) {
+            stats->merge(local);
         }
+        // Each range was parsed as an array of its own, but they make up one
+        stats->nodes[JsonValue::Array] -= parts - 1;
     }
     
-    double v = 0.0;
-    try {
-        v = std::stod(word);
+    size_t total = 0;
+    for (const Part& part : results) {
+        if (!part.ok) {
+            return false;
+        }
+        total += part.elements.to_array().size();
     }
-    catch (std::exception &) {
-        ok = false;
-        return JsonValue(); // Return a null-type JsonValue if the numeric value couldn't be parsed
+    // Splice the elements together; only the 16 byte values are moved
+    JsonArray array(buildResource(resource(), stats));
+    array.reserve(total);
+    for (Part& part : results) {
+        JsonArray& elements = part.elements.mutable_array();
+        array.insert(array.end(), std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
     }
-    
-    return JsonValue(v);
+    root_ = JsonValue(std::move(array), resource());
+    return true;
 }
 
+std::ostream& operator<<(std::ostream& os, const JsonDocument& doc)
+{
+    return doc.to_json(os);
+}
 
-JsonDocument JsonDocument::from_json(const std::string& s)
+void operator>>(std::istream& is, JsonDocument& doc)
 {
-    JsonDocument doc;
-    return doc;
+    doc.from_json(is);
 }
@@ -11,8 +11,16 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <memory>
+#include "jsonarena.hpp"
+#include "jsonmappedfile.hpp"
 #include "jsonarray.hpp"
 #include "jsonobject.hpp"
+#include "jsonstats.hpp"
+
+class JsonDomBuilder;
+class JsonParser;
 
 class JsonDocument
 {
@@ -22,28 +30,142 @@ public:
         Indented
     };
     
+    enum ParseFlags {
+        NoFlags = 0,
+        // Build the parsed tree in an arena owned by the document. Parsing
+        // then hits the global allocator only a few times, and destroying
+        // the document releases the whole tree at once without visiting it.
+        // Values copied out of such a document are deep copies on the
+        // default resource, so they may outlive it.
+        UseArena = 1 << 0,
+        // Tokenize through a SIMD structural index; see JsonParser::setIndexed
+        UseIndex = 1 << 1,
+        // String values without escapes refer into the input instead of
+        // being copied (see JsonValue::borrow). Who keeps the input alive
+        // depends on where it came from:
+        //  - from_file(): the document keeps the file mapped for as long
+        //    as it holds the tree.
+        //  - from_json(std::string_view): the caller does. The text must
+        //    stay alive and unchanged for as long as the document, or any
+        //    value moved out of it, is in use.
+        //  - from_json_in_situ(): the document owns the text, and escaped
+        //    strings are decoded in place and borrowed as well.
+        // Values copied out of the document own their strings, as does the
+        // std::string from to_string(). Ignored when reading a stream.
+        BorrowStrings = 1 << 2,
+        // Parse a large top-level array on all cores. The array is cut into
+        // ranges of elements with a quick structural pass, the ranges are
+        // parsed on separate threads, and their elements are moved into
+        // one JsonArray. The tree and the validity are the same as when
+        // parsing serially. Texts under 1 MB are always parsed serially.
+        Parallel = 1 << 3
+    };
+    
     JsonDocument(Format format = Compact);
     JsonDocument(const JsonArray&, Format format = Compact);
     JsonDocument(const JsonObject&, Format format = Compact);
+    JsonDocument(JsonArray&&, Format format = Compact);
+    JsonDocument(JsonObject&&, Format format = Compact);
+    ~JsonDocument();
+    
+    JsonDocument(const JsonDocument&);
+    JsonDocument(JsonDocument&&) = default;
+    
+    JsonDocument& operator=(const JsonDocument&);
+    JsonDocument& operator=(JsonDocument&&);
     
     bool isValid() const noexcept { return parseOk_; }
+    bool usesArena() const noexcept { return arena_ != nullptr; }
+    
+    JsonValue::Type type() const noexcept { return root_.type(); }
+    // The top-level value, Null for an invalid document
+    const JsonValue& to_value() const noexcept { return root_; }
+    const JsonArray& to_array() const;
+    const JsonObject& to_object() const;
+    // The top-level array or object for changing in place; a top-level
+    // value of the other type is replaced by an empty one. Copies of a
+    // document without an arena share its tree, and changing it through
+    // these copies only the containers on the way to the change (see
+    // JsonValue::mutable_array). Values put into the tree of a document
+    // with an arena by assigning through these may live elsewhere, so
+    // from then on the tree is destroyed value by value rather than left
+    // for the arena to release.
+    JsonArray& mutable_array();
+    JsonObject& mutable_object();
     
     void setFormat(Format);
     void setMaxIndent(int);
     void setArray(const JsonArray&);
     void setObject(const JsonObject&);
+    void setArray(JsonArray&&);
+    void setObject(JsonObject&&);
     
-    std::ostream& to_json(std::ostream& os) const;
-    void from_json(std::istream& is);
+    // The heap memory held by the tree, and by the text and arena kept for it
+    JsonMemoryUsage memoryUsage() const;
+    // Rebuilds the tree to take as little memory as it can, for documents
+    // kept around for a long time: arrays and objects hold exactly their
+    // elements, the lookup tables of large objects are as small as they
+    // can be, and with UseArena the tree moves to an arena of just its
+    // size. With 'poolStrings', string values are also gathered into one
+    // buffer owned by the document, each distinct text stored once, and
+    // borrowed from there as with BorrowStrings, and a mapped file or
+    // parsed text is released. Borrowed strings keep the tree from being
+    // shared, though: every later copy of it copies it in full, so only
+    // pool strings for documents that are read where they are. Subtrees
+    // shared by several values of the tree each get a copy of their own.
+    void compact(bool poolStrings = false);
     
-    static JsonDocument from_json(const std::string &);
+    // Each of the calls below that writes or parses counts what it did
+    // into 'stats' if it is given one and the library was built with
+    // JSONLIB_STATS; see JsonStats.
     
+    // With 'threads' other than 1, large arrays and objects are rendered
+    // on that many threads (one per core when 0), giving the same text
+    std::ostream& to_json(std::ostream& os, unsigned threads = 1, JsonStats* stats = nullptr) const;
+    // Reads the rest of the stream and parses it as one JSON text
+    void from_json(std::istream& is, int flags = NoFlags, JsonStats* stats = nullptr);
+    
+    // Parses a complete JSON text held in a contiguous buffer. To look at
+    // the contents without building a tree, use a JsonParser with your
+    // own JsonHandler instead.
+    static JsonDocument from_json(std::string_view, int flags = NoFlags, JsonStats* stats = nullptr);
+    // Takes over 'text' and parses it in place: no string value is copied.
+    // Escaped strings are decoded over their own text, which leaves the
+    // buffer no longer valid JSON, and the document keeps the buffer for
+    // as long as it holds the tree. BorrowStrings is implied; with Parallel,
+    // escaped strings are still copied.
+    static JsonDocument from_json_in_situ(std::string&& text, int flags = NoFlags, JsonStats* stats = nullptr);
+    // Maps the file at 'path' into memory and parses it in place. The
+    // document is invalid if the file cannot be read.
+    static JsonDocument from_file(const std::string& path, int flags = NoFlags, JsonStats* stats = nullptr);
+
 private:
-    JsonArray array_;
-    JsonObject object_;
-    JsonValue::Type type_ = JsonValue::Null;
+    friend class JsonLinesReader;
+    
+    void parse(std::string_view, int flags, JsonStats* stats);
+    void parse(std::string_view, int flags, JsonDomBuilder& builder, JsonParser& parser, JsonStats* stats = nullptr);
+    bool parseParallel(std::string_view, int flags, JsonStats* stats);
+    void reset(int flags, size_t sizeHint);
+    void dropTree() noexcept;
+    
+    // Internal flag: the text passed to parse() may be written to
+    static constexpr int DecodeInPlace = 1 << 16;
+    
+    // Smallest text that the Parallel flag applies to
+    static constexpr size_t ParallelThreshold = 1 << 20;
+    // Ranges per thread, so that threads which finish early can take more
+    static constexpr size_t PartsPerThread = 4;
+    std::pmr::memory_resource* resource() const noexcept;
+    
+    // The file, text and arena must outlive root_, which may point into them
+    std::unique_ptr<JsonMappedFile> file_;
+    std::unique_ptr<std::string> text_;
+    std::unique_ptr<JsonArena> arena_;
+    JsonValue root_;
     Format format_;
     bool parseOk_ = true;
+    // Set once the tree was handed out for changing
+    bool edited_ = false;
     int max_indent_ = 16;
 };
 
@@ -0,0 +1,278 @@
+//
+//  jsonindex.cpp
+//  JsonLib
+//
+
+#include "jsonindex.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define JSONLIB_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// One bit per byte of a 64 byte block
+struct BlockMasks
+{
+    std::uint64_t quote = 0;
+    std::uint64_t backslash = 0;
+    std::uint64_t whitespace = 0;
+    std::uint64_t structural = 0;
+};
+
+static void classifyScalar(const char* p, BlockMasks& m)
+{
+    for (int i = 0; i < 64; ++i) {
+        std::uint64_t bit = std::uint64_t(1) << i;
+        switch (p[i]) {
+            case '"':
+                m.quote |= bit;
+                break;
+            case '\\':
+                m.backslash |= bit;
+                break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                m.whitespace |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                m.structural |= bit;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#ifdef JSONLIB_X86_SIMD
+
+// The SIMD classifiers look each byte up by its low nibble in a 16 byte
+// table and compare the result with the byte itself. The four whitespace
+// characters all have different low nibbles. The structural characters do
+// once 0x20 is or'ed in, which folds [ ] onto { }; it also folds in 0x0c
+// and 0x1a, but control characters are invalid outside strings anyway.
+
+__attribute__((target("sse4.2")))
+static void classifySse42(const char* p, BlockMasks& m)
+{
+    const __m128i wsTable = _mm_setr_epi8(' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0);
+    const __m128i opTable = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+    for (int i = 0; i < 4; ++i) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+        __m128i folded = _mm_or_si128(c, _mm_set1_epi8(0x20));
+        int shift = 16 * i;
+        m.quote |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('"'))))) << shift;
+        m.backslash |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('\\'))))) << shift;
+        m.whitespace |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_shuffle_epi8(wsTable, c), c)))) << shift;
+        m.structural |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_shuffle_epi8(opTable, folded), folded)))) << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const char* p, BlockMasks& m)
+{
+    // The 256-bit shuffle looks up within each 128-bit lane
+    const __m256i wsTable = _mm256_setr_epi8(' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0,
+                                             ' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0);
+    const __m256i opTable = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+                                             0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+    for (int i = 0; i < 2; ++i) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+        __m256i folded = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+        int shift = 32 * i;
+        m.quote |= std::uint64_t(std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('"'))))) << shift;
+        m.backslash |= std::uint64_t(std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\'))))) << shift;
+        m.whitespace |= std::uint64_t(std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(wsTable, c), c)))) << shift;
+        m.structural |= std::uint64_t(std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(opTable, folded), folded)))) << shift;
+    }
+}
+
+#endif
+
+// Returns the bits of the characters escaped by a backslash. A character
+// is escaped when it follows a run of backslashes of odd length, so runs
+// are told apart by whether they start on an even or an odd bit: adding a
+// run's start bit to the run carries past its end, and the parity of where
+// that carry lands gives the parity of the run's length. 'carry' holds
+// whether the first character of the next block is escaped.
+static std::uint64_t findEscaped(std::uint64_t backslash, std::uint64_t& carry)
+{
+    const std::uint64_t evenBits = 0x5555555555555555ULL;
+    
+    // An escaped backslash does not start a run
+    backslash &= ~carry;
+    std::uint64_t followsEscape = (backslash << 1) | carry;
+    std::uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+    std::uint64_t evenEnds = oddStarts + backslash;
+    carry = evenEnds < oddStarts ? 1 : 0;
+    std::uint64_t invert = evenEnds << 1;
+    return (evenBits ^ invert) & followsEscape;
+}
+
+// Bit i of the result is the xor of bits 0 through i: with quote bits in,
+// that marks everything from an opening quote up to its closing quote
+static std::uint64_t prefixXor(std::uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static int trailingZeros(std::uint64_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Runs the classification over 'json' and hands each 64 byte block to
+// 'visit', as the offset of the block, a mask of the token starts in it
+// and a mask of the structural characters outside strings. Stops early if
+// 'visit' returns false.
+template<class Visit>
+static void scanBlocks(std::string_view json, JsonIndex::Isa isa, Visit visit)
+{
+    void (*classify)(const char*, BlockMasks&) = classifyScalar;
+#ifdef JSONLIB_X86_SIMD
+    if (isa == JsonIndex::Avx2) {
+        classify = classifyAvx2;
+    }
+    else if (isa == JsonIndex::Sse42) {
+        classify = classifySse42;
+    }
+#endif
+
+    // State carried from one block to the next
+    std::uint64_t escapeCarry = 0;
+    std::uint64_t inStringCarry = 0;
+    std::uint64_t scalarCarry = 0;
+    
+    for (size_t base = 0; base < json.size(); base += 64) {
+        const char* block = json.data() + base;
+        char tail[64];
+        if (json.size() - base < 64) {
+            // Pad the last block with whitespace, which is never indexed
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, json.size() - base);
+            block = tail;
+        }
+        
+        BlockMasks m;
+        classify(block, m);
+        
+        std::uint64_t quote = m.quote & ~findEscaped(m.backslash, escapeCarry);
+        std::uint64_t inString = prefixXor(quote) ^ inStringCarry;
+        inStringCarry = std::uint64_t(0) - (inString >> 63);
+        // String contents and closing quotes, but not opening quotes
+        std::uint64_t stringTail = inString ^ quote;
+        
+        // A number or literal starts wherever a scalar character does not
+        // directly follow another one. Opening quotes are starts even then.
+        std::uint64_t nonQuoteScalar = ~(m.structural | m.whitespace | quote);
+        std::uint64_t followsScalar = (nonQuoteScalar << 1) | scalarCarry;
+        scalarCarry = nonQuoteScalar >> 63;
+        std::uint64_t starts = (m.structural | quote | (nonQuoteScalar & ~followsScalar)) & ~stringTail;
+        
+        if (!visit(base, starts, m.structural & ~stringTail)) {
+            return;
+        }
+    }
+}
+
+JsonIndex::Isa JsonIndex::supportedIsa() noexcept
+{
+#ifdef JSONLIB_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        return Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return Sse42;
+    }
+#endif
+    return Scalar;
+}
+
+bool JsonIndex::build(std::string_view json, Isa isa)
+{
+    size_ = 0;
+    if (json.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+    scanBlocks(json, isa, [&](size_t base, std::uint64_t starts, std::uint64_t) {
+        if (capacity_ - size_ < 64) {
+            size_t capacity = std::max<size_t>(capacity_ * 2, json.size() / 8 + 64);
+            std::unique_ptr<std::uint32_t[]> grown(new std::uint32_t[capacity]);
+            std::copy(positions_.get(), positions_.get() + size_, grown.get());
+            positions_ = std::move(grown);
+            capacity_ = capacity;
+        }
+        std::uint32_t* out = positions_.get() + size_;
+        while (starts) {
+            *out++ = static_cast<std::uint32_t>(base + trailingZeros(starts));
+            starts &= starts - 1;
+        }
+        size_ = out - positions_.get();
+        return true;
+    });
+    return true;
+}
+
+std::vector<size_t> JsonIndex::splitArray(std::string_view json, size_t parts, Isa isa)
+{
+    std::vector<size_t> commas;
+    if (parts < 2) {
+        return commas;
+    }
+    size_t spacing = json.size() / parts;
+    size_t target = spacing;
+    long depth = 0;
+    scanBlocks(json, isa, [&](size_t base, std::uint64_t, std::uint64_t structural) {
+        while (structural) {
+            size_t pos = base + trailingZeros(structural);
+            structural &= structural - 1;
+            switch (json[pos]) {
+                case '{':
+                case '[':
+                    ++depth;
+                    break;
+                case '}':
+                case ']':
+                    --depth;
+                    break;
+                case ',':
+                    if (depth == 1 && pos >= target) {
+                        commas.push_back(pos);
+                        if (commas.size() == parts - 1) {
+                            return false;
+                        }
+                        target = pos + spacing;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return true;
+    });
+    return commas;
+}
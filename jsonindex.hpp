@@ -0,0 +1,60 @@
+//
+//  jsonindex.hpp
+//  JsonLib
+//
+
+#ifndef jsonindex_hpp
+#define jsonindex_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// The first stage of parsing a large text: a list of the offsets at which
+// tokens start. That is every structural character ({ } [ ] : ,) outside
+// of a string, every opening quote, and the first character of every
+// number or literal. Whitespace and string contents never appear in it,
+// so the tokenizer can hop from one token to the next.
+//
+// The text is classified 64 bytes at a time into bit masks, with AVX2 or
+// SSE4.2 when the processor has them and plain C++ otherwise. Escapes and
+// the extent of strings are then worked out for all 64 bytes at once with
+// a few integer operations per block.
+class JsonIndex
+{
+public:
+    enum Isa {
+        Scalar,
+        Sse42,
+        Avx2
+    };
+    
+    // The fastest instruction set this processor supports
+    static Isa supportedIsa() noexcept;
+    
+    // Indexes 'json', replacing the previous contents. Offsets are 32-bit,
+    // so texts of 4 GB and more cannot be indexed and false is returned.
+    // The index only points the tokenizer at tokens; it does not validate
+    // them, and for invalid text it may be incomplete.
+    bool build(std::string_view json, Isa isa = supportedIsa());
+    
+    // Finds up to parts - 1 commas between the elements of the top-level
+    // array in 'json', spread out so as to cut it into ranges of similar
+    // size, and returns their offsets. Only the structure outside strings
+    // is looked at, without building an index, so the ranges can be parsed
+    // separately, with each one checked for syntax then.
+    static std::vector<size_t> splitArray(std::string_view json, size_t parts, Isa isa = supportedIsa());
+    
+    const std::uint32_t* begin() const noexcept { return positions_.get(); }
+    const std::uint32_t* end() const noexcept { return positions_.get() + size_; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    std::unique_ptr<std::uint32_t[]> positions_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+#endif /* jsonindex_hpp */
@@ -0,0 +1,161 @@
+//
+//  jsonlines.cpp
+//  JsonLib
+//
+
+#include "jsonlines.hpp"
+#include <algorithm>
+#include <cstring>
+
+JsonLinesReader::JsonLinesReader(unsigned threads, int flags) :
+    threads_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+    flags_(flags)
+{}
+
+JsonLinesReader::~JsonLinesReader()
+{
+    close();
+}
+
+bool JsonLinesReader::open(const std::string& path)
+{
+    close();
+    if (!file_.open(path)) {
+        return false;
+    }
+    start(file_.data());
+    return true;
+}
+
+void JsonLinesReader::openText(std::string_view text)
+{
+    close();
+    start(text);
+}
+
+void JsonLinesReader::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    space_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    slots_.clear();
+    file_.close();
+    pos_ = nullptr;
+    end_ = nullptr;
+    claimed_ = 0;
+    taken_ = 0;
+    stop_ = false;
+    reading_ = false;
+    current_ = 0;
+    lineBase_ = 0;
+    line_ = 0;
+}
+
+bool JsonLinesReader::next(JsonDocument& doc)
+{
+    if (slots_.empty()) {
+        return false;
+    }
+    for (;;) {
+        Batch& batch = slots_[taken_ % slots_.size()];
+        if (reading_) {
+            if (current_ < batch.documents.size()) {
+                doc = std::move(batch.documents[current_]);
+                line_ = lineBase_ + batch.lines[current_] + 1;
+                ++current_;
+                return true;
+            }
+            // Hand the slot back to the workers
+            lineBase_ += batch.lineCount;
+            batch.documents.clear();
+            batch.lines.clear();
+            batch.lineCount = 0;
+            reading_ = false;
+            current_ = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                batch.ready = false;
+                ++taken_;
+            }
+            space_.notify_all();
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return batch.ready || (pos_ == end_ && claimed_ == taken_); });
+        if (!batch.ready) {
+            return false;
+        }
+        reading_ = true;
+    }
+}
+
+void JsonLinesReader::start(std::string_view text)
+{
+    pos_ = text.data();
+    end_ = text.data() + text.size();
+    slots_.resize(std::max<size_t>(queueDepth_ > 0 ? queueDepth_ : 2 * threads_, threads_));
+    for (unsigned i = 0; i < threads_; ++i) {
+        workers_.emplace_back(&JsonLinesReader::work, this);
+    }
+}
+
+void JsonLinesReader::work()
+{
+    // Each worker reuses one parser for all its documents
+    JsonDomBuilder builder;
+    JsonParser parser(builder);
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [&] { return stop_ || pos_ == end_ || claimed_ < taken_ + slots_.size(); });
+        if (stop_ || pos_ == end_) {
+            return;
+        }
+        // Take about batchSize_ bytes, up to the end of a line
+        const char* begin = pos_;
+        const char* end = end_;
+        if (static_cast<size_t>(end_ - begin) > batchSize_) {
+            const char* cut = begin + batchSize_ - 1;
+            const void* newline = std::memchr(cut, '\n', end_ - cut);
+            if (newline) {
+                end = static_cast<const char*>(newline) + 1;
+            }
+        }
+        pos_ = end;
+        Batch& batch = slots_[claimed_++ % slots_.size()];
+        lock.unlock();
+        
+        parseBatch(begin, end, batch, builder, parser);
+        
+        lock.lock();
+        batch.ready = true;
+        lock.unlock();
+        ready_.notify_one();
+    }
+}
+
+void JsonLinesReader::parseBatch(const char* begin, const char* end, Batch& batch, JsonDomBuilder& builder, JsonParser& parser)
+{
+    size_t line = 0;
+    while (begin != end) {
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        std::string_view text(begin, (newline ? newline : end) - begin);
+        if (text.find_first_not_of(" \t\r") != std::string_view::npos) {
+            batch.documents.emplace_back();
+            batch.documents.back().parse(text, flags_ & ~JsonDocument::BorrowStrings, builder, parser);
+            batch.lines.push_back(line);
+        }
+        if (!newline) {
+            break;
+        }
+        ++line;
+        begin = newline + 1;
+    }
+    batch.lineCount = line;
+}
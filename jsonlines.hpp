@@ -0,0 +1,114 @@
+//
+//  jsonlines.hpp
+//  JsonLib
+//
+
+#ifndef jsonlines_hpp
+#define jsonlines_hpp
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "jsondocument.hpp"
+#include "jsonmappedfile.hpp"
+#include "jsonparser.hpp"
+
+// Reads JSON Lines (NDJSON) text, one JSON document per line, parsing it
+// on a pool of worker threads. The text is cut into batches of whole lines;
+// each worker takes the next batch, parses its lines into JsonDocuments and
+// hands them back, and the caller receives every document in input order
+// through next().
+//
+// Only a bounded number of batches are parsed ahead of the caller, so
+// memory use depends on the batch size and queue depth rather than on the
+// size of the input. Blank lines are skipped. A line that is not a valid
+// JSON object or array gives an invalid document, and reading goes on.
+//
+//     JsonLinesReader reader;
+//     reader.open("events.jsonl");
+//     JsonDocument doc;
+//     while (reader.next(doc)) {
+//         if (!doc.isValid()) ... reader.line() ...
+//     }
+class JsonLinesReader
+{
+public:
+    // Parses with 'threads' workers, or one per core when 0. The flags are
+    // those of JsonDocument::from_json, applied to every document.
+    explicit JsonLinesReader(unsigned threads = 0, int flags = JsonDocument::NoFlags);
+    ~JsonLinesReader();
+    
+    JsonLinesReader(const JsonLinesReader&) = delete;
+    JsonLinesReader& operator=(const JsonLinesReader&) = delete;
+    
+    // Maps the file at 'path' and starts reading it. Returns false if it
+    // cannot be opened.
+    bool open(const std::string& path);
+    // Starts reading 'text', which must remain valid until the reader is
+    // closed or reopened
+    void openText(std::string_view text);
+    // Stops the workers and drops whatever they had parsed ahead
+    void close();
+    
+    // Moves the next document into 'doc'. Returns false once every line
+    // has been read.
+    bool next(JsonDocument& doc);
+    // The line, counting from 1, that the last document came from
+    size_t line() const noexcept { return line_; }
+    
+    // Workers take about this many bytes of lines at a time (64 KB by
+    // default). Small batches keep the documents in cache between being
+    // parsed and read.
+    void setBatchSize(size_t bytes) { batchSize_ = bytes > 0 ? bytes : 1; }
+    // How many batches may be parsed ahead of next(), at least one per
+    // worker (by default two per worker). Both settings take effect with
+    // the next open().
+    void setQueueDepth(size_t batches) { queueDepth_ = batches; }
+
+private:
+    struct Batch {
+        std::vector<JsonDocument> documents;
+        // The line of each document, relative to the start of the batch
+        std::vector<size_t> lines;
+        // Newlines in the batch
+        size_t lineCount = 0;
+        bool ready = false;
+    };
+    
+    void start(std::string_view text);
+    void work();
+    void parseBatch(const char* begin, const char* end, Batch& batch, JsonDomBuilder& builder, JsonParser& parser);
+    
+    unsigned threads_;
+    int flags_;
+    size_t batchSize_ = 64 * 1024;
+    size_t queueDepth_ = 0;
+    
+    JsonMappedFile file_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    // Signalled when a batch is ready, and when a slot for one comes free
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    
+    // Guarded by mutex_
+    const char* pos_ = nullptr;         // start of the next batch to hand out
+    const char* end_ = nullptr;
+    size_t claimed_ = 0;                // batches handed out to workers
+    size_t taken_ = 0;                  // batches finished with by next()
+    bool stop_ = false;
+    // Batch i is parsed into slots_[i % slots_.size()]
+    std::vector<Batch> slots_;
+    
+    // Only used by the reading thread
+    bool reading_ = false;              // the batch at taken_ is being read
+    size_t current_ = 0;                // next document in that batch
+    size_t lineBase_ = 0;               // lines before the batch being read
+    size_t line_ = 0;
+};
+
+#endif /* jsonlines_hpp */
@@ -0,0 +1,75 @@
+//
+//  jsonmappedfile.cpp
+//  JsonLib
+//
+
+#include "jsonmappedfile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JSONLIB_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+JsonMappedFile::~JsonMappedFile()
+{
+    close();
+}
+
+bool JsonMappedFile::open(const std::string& path, Access access)
+{
+    close();
+#ifdef JSONLIB_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        ::madvise(p, size, access == Random ? MADV_RANDOM : MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(p);
+        size_ = size;
+    }
+    // The mapping stays valid once the descriptor is closed
+    ::close(fd);
+#else
+    (void)access;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(file), {});
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+    open_ = true;
+    return true;
+}
+
+void JsonMappedFile::close() noexcept
+{
+#ifdef JSONLIB_HAVE_MMAP
+    if (size_ > 0) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
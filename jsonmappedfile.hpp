@@ -0,0 +1,48 @@
+//
+//  jsonmappedfile.hpp
+//  JsonLib
+//
+
+#ifndef jsonmappedfile_hpp
+#define jsonmappedfile_hpp
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A file mapped read-only into memory, so it can be parsed in place without
+// being copied into a buffer first. The kernel is told how the mapping will
+// be read: sequentially makes it read ahead aggressively, while randomly
+// stops it reading ahead at all. On platforms without mmap the file is read
+// into memory instead.
+class JsonMappedFile
+{
+public:
+    enum Access {
+        Sequential,
+        Random
+    };
+    
+    JsonMappedFile() = default;
+    ~JsonMappedFile();
+    
+    JsonMappedFile(const JsonMappedFile&) = delete;
+    JsonMappedFile& operator=(const JsonMappedFile&) = delete;
+    
+    // Maps the file at 'path', replacing any file mapped before. Returns
+    // false if it cannot be opened or mapped.
+    bool open(const std::string& path, Access access = Sequential);
+    void close() noexcept;
+    
+    bool isOpen() const noexcept { return open_; }
+    std::string_view data() const noexcept { return std::string_view(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+    // Holds the contents where the file could not be mapped
+    std::string buffer_;
+};
+
+#endif /* jsonmappedfile_hpp */
@@ -9,45 +9,259 @@
 #include "jsonobject.hpp"
 #include "jsonvalue.hpp"
 #include "jsonarray.hpp"
+#include "jsonwriter.hpp"
 #include <algorithm>
+#include <stdexcept>
 
-JsonObject::JsonObject(std::initializer_list<std::pair<const Key, JsonValue>> ilist) :
-    data_(ilist)
+// Adds a member known not to be present yet
+template <class K, class Value>
+void JsonObject::append(K&& key, Value&& value)
+{
+    data_.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Value>(value)));
+    if (index_.empty()) {
+        if (data_.size() > LinearLimit) {
+            rebuildIndex();
+        }
+    }
+    else if (data_.size() * 2 > index_.size()) {
+        rebuildIndex();
+    }
+    else {
+        indexMember(data_.size() - 1);
+    }
+}
+
+JsonObject::JsonObject(std::initializer_list<std::pair<const Key, JsonValue>> ilist)
+{
+    insert(ilist);
+}
+
+JsonObject::JsonObject(std::pmr::memory_resource* resource) :
+    data_(resource),
+    index_(resource)
+{}
+
+JsonObject::JsonObject(const JsonObject& other, std::pmr::memory_resource* resource) :
+    data_(other.data_, resource),
+    index_(other.index_, resource)
+{}
+
+JsonObject::JsonObject(JsonObject&& other, std::pmr::memory_resource* resource) :
+    data_(std::move(other.data_), resource),
+    index_(std::move(other.index_), resource)
 {}
 
 JsonObject& JsonObject::operator=(std::initializer_list<std::pair<const Key, JsonValue>> ilist)
 {
-    data_ = ilist;
+    clear();
+    insert(ilist);
     return *this;
 }
 
+void JsonObject::reserve(size_t new_cap)
+{
+    data_.reserve(new_cap);
+    if (new_cap > LinearLimit && new_cap * 2 > index_.size()) {
+        fillIndex(new_cap);
+    }
+}
+
+void JsonObject::shrink_to_fit()
+{
+    data_.shrink_to_fit();
+    if (data_.size() <= LinearLimit) {
+        index_.clear();
+        index_.shrink_to_fit();
+    }
+    else {
+        fillIndex(data_.size());
+    }
+}
+
+void JsonObject::clear() noexcept
+{
+    data_.clear();
+    index_.clear();
+}
+
 void JsonObject::swap(JsonObject& other)
 {
     data_.swap(other.data_);
+    index_.swap(other.index_);
 }
 
-std::pair<JsonObject::JsonMap::iterator,bool> JsonObject::insert(const JsonPair& value)
+std::pair<JsonObject::iterator,bool> JsonObject::insert(const JsonPair& value)
 {
-    return data_.insert(value);
+    size_t pos = indexOf(value.first);
+    if (pos != data_.size()) {
+        return { begin() + pos, false };
+    }
+    append(value.first, value.second);
+    return { end() - 1, true };
 }
 
-JsonObject::JsonMap::iterator JsonObject::insert(JsonMap::const_iterator hint, const JsonPair& value)
+std::pair<JsonObject::iterator,bool> JsonObject::insert(JsonPair&& value)
 {
-    return data_.insert(hint, value);
+    size_t pos = indexOf(value.first);
+    if (pos != data_.size()) {
+        return { begin() + pos, false };
+    }
+    append(std::move(value.first), std::move(value.second));
+    return { end() - 1, true };
+}
+
+JsonObject::iterator JsonObject::insert(const_iterator, const JsonPair& value)
+{
+    return insert(value).first;
+}
+
+void JsonObject::insert(std::initializer_list<std::pair<const Key, JsonValue>> ilist)
+{
+    for (const auto& pr : ilist) {
+        if (!contains(pr.first)) {
+            append(pr.first, pr.second);
+        }
+    }
 }
 
 template<class InputIt>
 void JsonObject::insert(InputIt first, InputIt last)
 {
-    data_.insert(first, last);
+    for (; first != last; ++first) {
+        insert(*first);
+    }
 }
 
-std::vector<JsonObject::Key> JsonObject::keys(Ordering method) const
+JsonObject::iterator JsonObject::erase(const_iterator pos)
 {
-    std::vector<Key> keys;
+    return erase(pos, pos + 1);
+}
+
+JsonObject::iterator JsonObject::erase(const_iterator first, const_iterator last)
+{
+    auto it = data_.erase(first.base(), last.base());
+    // Positions after the erased range have shifted
+    rebuildIndex();
+    return iterator(it);
+}
+
+size_t JsonObject::erase(std::string_view key)
+{
+    size_t pos = indexOf(key);
+    if (pos == data_.size()) {
+        return 0;
+    }
+    erase(cbegin() + pos);
+    return 1;
+}
+
+JsonValue& JsonObject::at(std::string_view key)
+{
+    size_t pos = indexOf(key);
+    if (pos == data_.size()) {
+        throw std::out_of_range("JsonObject::at: key not found");
+    }
+    return data_[pos].second;
+}
+
+const JsonValue& JsonObject::at(std::string_view key) const
+{
+    size_t pos = indexOf(key);
+    if (pos == data_.size()) {
+        throw std::out_of_range("JsonObject::at: key not found");
+    }
+    return data_[pos].second;
+}
+
+void JsonObject::add(std::string_view key, JsonValue&& value)
+{
+    append(key, std::move(value));
+}
+
+JsonValue& JsonObject::operator[](std::string_view key)
+{
+    size_t pos = indexOf(key);
+    if (pos == data_.size()) {
+        append(key, JsonValue());
+    }
+    return data_[pos].second;
+}
+
+// Returns the position of 'key' in data_, or data_.size() if it is absent
+size_t JsonObject::indexOf(std::string_view key) const noexcept
+{
+    // Small objects are searched without hashing the key
+    return indexOf(key, index_.empty() ? 0 : hashKey(key));
+}
+
+size_t JsonObject::indexOf(std::string_view key, size_t hash) const noexcept
+{
+    if (index_.empty()) {
+        for (size_t i = 0; i < data_.size(); ++i) {
+            if (data_[i].first == key) {
+                return i;
+            }
+        }
+        return data_.size();
+    }
+    
+    size_t mask = index_.size() - 1;
+    for (size_t slot = hash & mask; index_[slot] != 0; slot = (slot + 1) & mask) {
+        size_t pos = index_[slot] - 1;
+        if (data_[pos].first == key) {
+            return pos;
+        }
+    }
+    return data_.size();
+}
+
+void JsonObject::indexMember(size_t pos) noexcept
+{
+    size_t mask = index_.size() - 1;
+    size_t slot = hashKey(data_[pos].first) & mask;
+    while (index_[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    index_[slot] = static_cast<uint32_t>(pos + 1);
+}
+
+void JsonObject::rebuildIndex()
+{
+    index_.clear();
+    if (data_.size() <= LinearLimit) {
+        index_.shrink_to_fit();
+        return;
+    }
+    // Keep the table between a quarter and half full
+    fillIndex(data_.size() * 2);
+}
+
+// Rebuilds the table with the fewest slots that stay at most half full
+// until 'capacity' members are in
+void JsonObject::fillIndex(size_t capacity)
+{
+    size_t slots = 64;
+    while (slots < capacity * 2) {
+        slots *= 2;
+    }
+    if (slots < index_.capacity()) {
+        // Give back the room of a larger table
+        index_ = std::pmr::vector<uint32_t>(slots, 0, index_.get_allocator());
+    }
+    else {
+        index_.assign(slots, 0);
+    }
+    for (size_t pos = 0; pos < data_.size(); ++pos) {
+        indexMember(pos);
+    }
+}
+
+std::vector<std::string> JsonObject::keys(Ordering method) const
+{
+    std::vector<std::string> keys;
     keys.reserve(data_.size());
     for (auto const& pr : data_) {
-        keys.push_back(pr.first);
+        keys.emplace_back(pr.first);
     }
     if (method == Ordered) {
         std::sort(keys.begin(), keys.end());
@@ -57,20 +271,53 @@ std::vector<JsonObject::Key> JsonObject::keys(Ordering method) const
 
 bool JsonObject::equals(const JsonObject& other) const
 {
-    return (data_ == other.data_);
+    // Member order does not matter for equality
+    if (data_.size() != other.data_.size()) {
+        return false;
+    }
+    for (const auto& pr : data_) {
+        size_t pos = other.indexOf(pr.first);
+        if (pos == other.data_.size() || pr.second != other.data_[pos].second) {
+            return false;
+        }
+    }
+    return true;
 }
 
-std::ostream& JsonObject::serialize(std::ostream& os) const
+JsonMemoryUsage JsonObject::memoryUsage() const
+{
+    JsonMemoryUsage usage;
+    JsonValue::Counted counted;
+    addMemoryUsage(usage, counted);
+    return usage;
+}
+
+void JsonObject::addMemoryUsage(JsonMemoryUsage& usage, JsonValue::Counted& counted) const
 {
-    os << "{";
-    if (!data_.empty()) {
-        auto it = data_.cbegin();
-        os << "\"" << it->first << "\":" << it->second;
-        for (auto it = ++data_.cbegin(); it != data_.cend(); ++it) {
-            os << ",\"" << it->first << "\":" << it->second;
+    usage.members += data_.size() * sizeof(JsonPair);
+    usage.slack += (data_.capacity() - data_.size()) * sizeof(JsonPair);
+    usage.indexes += index_.size() * sizeof(uint32_t);
+    usage.slack += (index_.capacity() - index_.size()) * sizeof(uint32_t);
+    for (const auto& pr : data_) {
+        if (JsonValue::textBytes(pr.first) != 0) {
+            usage.keys += pr.first.size() + 1;
+            usage.slack += pr.first.capacity() - pr.first.size();
         }
+        pr.second.addMemoryUsage(usage, counted);
+    }
+}
+
+std::ostream& JsonObject::serialize(std::ostream& os) const
+{
+    if (data_.size() > JsonWriter::SmallContainer) {
+        JsonWriter writer(os);
+        writer.write(*this);
+        return os;
     }
-    return os << "}";
+    char buffer[JsonWriter::SmallBuffer];
+    JsonWriter writer(os, buffer, sizeof(buffer));
+    writer.write(*this);
+    return os;
 }
 
 
@@ -11,30 +11,117 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
-#include <unordered_map>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include "jsonvalue.hpp"
 
-class JsonValue;
 class JsonArray;
 
+// Members are kept in one contiguous vector in insertion order. Small
+// objects are searched linearly; once an object grows past a threshold an
+// open-addressing index of member positions is kept alongside, so lookups
+// stay O(1). As with std::vector, inserting or erasing members invalidates
+// iterators and references into the object.
 class JsonObject
 {
-    using Key = std::string;
-    using JsonMap = std::unordered_map<Key, JsonValue>;
+    using Key = std::pmr::string;
     using JsonPair = std::pair<Key, JsonValue>;
+    using JsonMembers = std::pmr::vector<JsonPair>;
 
 public:
     enum Ordering {
-        Unordered,
-        Ordered
+        Unordered,  // insertion order
+        Ordered     // sorted
     };
     
+    // A member as iterators give it. The key is const even through a
+    // mutable iterator, since the lookup index is built on it.
+    //
+    // Keys are std::pmr::strings, so that they can live on the object's
+    // resource, and unlike the std::strings they once were they do not
+    // convert to std::string implicitly: 'std::string k = it->first' no
+    // longer compiles. Take key(), a std::string_view, and write
+    // std::string(it->key()) where a copy is needed.
+    template <class Value>
+    struct Member
+    {
+        const Key& first;
+        Value& second;
+        
+        std::string_view key() const noexcept { return first; }
+    };
+    
+    // Random access iterators over the members, which give a Member by
+    // value rather than a reference to one: bind it with 'auto', 'auto&&'
+    // or 'const auto&', as for std::vector<bool>.
+    template <class Value, class Base>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Member<Value>;
+        using difference_type = std::ptrdiff_t;
+        using reference = Member<Value>;
+        // Holds the Member that operator-> points to
+        struct pointer
+        {
+            Member<Value> member;
+            const Member<Value>* operator->() const noexcept { return &member; }
+        };
+        
+        Iterator() = default;
+        explicit Iterator(Base it) noexcept : it_(it) {}
+        // An iterator converts to a const_iterator
+        template <class V, class B, class = std::enable_if_t<std::is_convertible_v<B, Base>>>
+        Iterator(const Iterator<V, B>& other) noexcept : it_(other.base()) {}
+        
+        Base base() const noexcept { return it_; }
+        
+        reference operator*() const noexcept { return { it_->first, it_->second }; }
+        pointer operator->() const noexcept { return { **this }; }
+        reference operator[](difference_type n) const noexcept { return { it_[n].first, it_[n].second }; }
+        
+        Iterator& operator++() noexcept { ++it_; return *this; }
+        Iterator operator++(int) noexcept { return Iterator(it_++); }
+        Iterator& operator--() noexcept { --it_; return *this; }
+        Iterator operator--(int) noexcept { return Iterator(it_--); }
+        Iterator& operator+=(difference_type n) noexcept { it_ += n; return *this; }
+        Iterator& operator-=(difference_type n) noexcept { it_ -= n; return *this; }
+        
+        friend Iterator operator+(Iterator it, difference_type n) noexcept { return it += n; }
+        friend Iterator operator+(difference_type n, Iterator it) noexcept { return it += n; }
+        friend Iterator operator-(Iterator it, difference_type n) noexcept { return it -= n; }
+        friend difference_type operator-(const Iterator& a, const Iterator& b) noexcept { return a.it_ - b.it_; }
+        friend bool operator==(const Iterator& a, const Iterator& b) noexcept { return a.it_ == b.it_; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) noexcept { return a.it_ != b.it_; }
+        friend bool operator<(const Iterator& a, const Iterator& b) noexcept { return a.it_ < b.it_; }
+        friend bool operator>(const Iterator& a, const Iterator& b) noexcept { return a.it_ > b.it_; }
+        friend bool operator<=(const Iterator& a, const Iterator& b) noexcept { return a.it_ <= b.it_; }
+        friend bool operator>=(const Iterator& a, const Iterator& b) noexcept { return a.it_ >= b.it_; }
+        
+    private:
+        Base it_;
+    };
+    
+    using iterator = Iterator<JsonValue, JsonMembers::iterator>;
+    using const_iterator = Iterator<const JsonValue, JsonMembers::const_iterator>;
+    
     JsonObject() = default;
     ~JsonObject() = default;
     
     JsonObject(std::initializer_list<std::pair<const Key, JsonValue>> ilist);
     
+    // Keys and values are allocated from 'resource' instead of the default resource
+    explicit JsonObject(std::pmr::memory_resource* resource);
+    JsonObject(const JsonObject&, std::pmr::memory_resource* resource);
+    JsonObject(JsonObject&&, std::pmr::memory_resource* resource);
+    
     JsonObject(const JsonObject&) = default;
     JsonObject(JsonObject&&) = default;
     
@@ -42,55 +129,110 @@ public:
     JsonObject& operator=(JsonObject&&) = default;
     JsonObject& operator=(std::initializer_list<std::pair<const Key, JsonValue>> ilist);
 
-    // Iterators
-    JsonMap::iterator       begin()  noexcept       { return data_.begin();  }
-    JsonMap::const_iterator begin()  const noexcept { return data_.begin();  }
-    JsonMap::const_iterator cbegin() const noexcept { return data_.cbegin(); }
-    JsonMap::iterator       end()    noexcept       { return data_.end();    }
-    JsonMap::const_iterator end()    const noexcept { return data_.end();    }
-    JsonMap::const_iterator cend()   const noexcept { return data_.cend();   }
+    // Iterators, in insertion order
+    iterator       begin()  noexcept       { return iterator(data_.begin());        }
+    const_iterator begin()  const noexcept { return const_iterator(data_.begin());  }
+    const_iterator cbegin() const noexcept { return const_iterator(data_.cbegin()); }
+    iterator       end()    noexcept       { return iterator(data_.end());          }
+    const_iterator end()    const noexcept { return const_iterator(data_.end());    }
+    const_iterator cend()   const noexcept { return const_iterator(data_.cend());   }
     
     // Capacity
     bool empty() const noexcept { return data_.empty(); }
     size_t size() const noexcept { return data_.size(); }
     size_t max_size() const noexcept { return data_.max_size(); }
+    size_t capacity() const noexcept { return data_.capacity(); }
+    // Like std::unordered_map::reserve(), also makes the lookup table big
+    // enough that adding up to new_cap members never rebuilds it
+    void reserve(size_t new_cap);
+    // Releases unused capacity, and shrinks the lookup table to the least
+    // that keeps it at most half full
+    void shrink_to_fit();
 
     // Modifiers
-    void clear() noexcept { data_.clear(); }
+    void clear() noexcept;
     void swap(JsonObject& other);
 
-    // Inserts
-    std::pair<JsonMap::iterator,bool> insert(const JsonPair& value);
-    JsonMap::iterator insert(JsonMap::const_iterator hint, const JsonPair& value);
+    // Inserts. Like std::unordered_map, an existing key is left untouched.
+    std::pair<iterator,bool> insert(const JsonPair& value);
+    std::pair<iterator,bool> insert(JsonPair&& value);
+    iterator insert(const_iterator hint, const JsonPair& value);
     void insert(std::initializer_list<std::pair<const Key, JsonValue>> ilist);
     template<class InputIt>
     void insert(InputIt first, InputIt last);
 
-    // Erases
-    JsonMap::iterator erase(JsonMap::const_iterator pos) { return data_.erase(pos); }
-    JsonMap::iterator erase(JsonMap::const_iterator first, JsonMap::const_iterator last) { return data_.erase(first, last); }
-    size_t erase(const Key& key) { return data_.erase(key); }
+    // Constructs the value of a new member from 'args' directly on the
+    // object's resource. If 'key' is present nothing is constructed and the
+    // arguments are left alone, so emplace() and try_emplace() are the same.
+    template <class... Args>
+    std::pair<iterator,bool> try_emplace(std::string_view key, Args&&... args)
+    {
+        size_t pos = indexOf(key);
+        if (pos != data_.size()) {
+            return { begin() + pos, false };
+        }
+        add(key, JsonValue::make(resource(), std::forward<Args>(args)...));
+        return { end() - 1, true };
+    }
+    template <class... Args>
+    std::pair<iterator,bool> emplace(std::string_view key, Args&&... args)
+    {
+        return try_emplace(key, std::forward<Args>(args)...);
+    }
+
+    // Erases. Remaining members keep their relative order.
+    iterator erase(const_iterator pos);
+    iterator erase(const_iterator first, const_iterator last);
+    size_t erase(std::string_view key);
 
     // Lookup
-    JsonValue& at(const Key& key)             { return data_.at(key); }
-    const JsonValue& at(const Key& key) const { return data_.at(key); }
+    JsonValue& at(std::string_view key);
+    const JsonValue& at(std::string_view key) const;
 
-    JsonValue& operator[](const Key& key) { return data_[key]; }
-    JsonValue& operator[](Key&& key)      { return data_[std::move(key)]; }
+    JsonValue& operator[](std::string_view key);
 
-    size_t count(const Key& key) const { return data_.count(key); }
+    size_t count(std::string_view key) const { return indexOf(key) != data_.size(); }
 
-    JsonMap::iterator find(const Key& key)             { return data_.find(key); }
-    JsonMap::const_iterator find(const Key& key) const { return data_.find(key); }
+    iterator find(std::string_view key)             { return begin() + indexOf(key); }
+    const_iterator find(std::string_view key) const { return begin() + indexOf(key); }
 
-    bool contains(const Key& key) const { return data_.count(key); }
+    bool contains(std::string_view key) const { return indexOf(key) != data_.size(); }
+    
+    // Lookups with the key's hash worked out beforehand by hashKey(), for
+    // keys that are looked up again and again, as by a compiled JsonPath
+    static size_t hashKey(std::string_view key) noexcept { return std::hash<std::string_view>()(key); }
+    const_iterator find(std::string_view key, size_t hash) const { return begin() + indexOf(key, hash); }
+    
+    std::vector<std::string> keys(Ordering method) const;
+    
+    std::pmr::memory_resource* resource() const noexcept { return data_.get_allocator().resource(); }
     
-    std::vector<Key> keys(Ordering method) const;
     bool equals(const JsonObject&) const;
+    // The heap memory held by the object and everything in it
+    JsonMemoryUsage memoryUsage() const;
     std::ostream& serialize(std::ostream&) const;
     
 private:
-    JsonMap data_;
+    friend class JsonValue;
+    
+    // Objects up to this size are searched linearly and carry no index
+    static constexpr size_t LinearLimit = 16;
+    
+    size_t indexOf(std::string_view key) const noexcept;
+    size_t indexOf(std::string_view key, size_t hash) const noexcept;
+    template <class K, class Value>
+    void append(K&& key, Value&& value);
+    void add(std::string_view key, JsonValue&& value);
+    void indexMember(size_t pos) noexcept;
+    void rebuildIndex();
+    void fillIndex(size_t capacity);
+    void addMemoryUsage(JsonMemoryUsage&, JsonValue::Counted&) const;
+    
+    JsonMembers data_;
+    // Open-addressing table of member position + 1, 0 marks an empty slot.
+    // Empty while size() <= LinearLimit unless reserve() made room for
+    // more, otherwise at most half full.
+    std::pmr::vector<uint32_t> index_;
 };
 
 bool operator==(const JsonObject& lhs, const JsonObject& rhs);
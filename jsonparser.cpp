@@ -0,0 +1,1004 @@
+//
+//  jsonparser.cpp
+//  JsonLib
+//
+
+#include "jsonparser.hpp"
+#include "jsonarray.hpp"
+#include "jsonobject.hpp"
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void eatWs(const char*& it, const char* end);
+std::string_view parseString(const char*& it, const char* end, std::string& scratch, bool& ok);
+void parseEscape(const char*& it, const char* end, std::string& s, bool& ok);
+bool matchWord(const char*& it, const char* end, const char* word, size_t len);
+JsonValue parseNumeric(const char*& it, const char* end, bool& ok);
+const char* stringEnd(const char* it, const char* end, bool escaped);
+const char* scalarEnd(const char* it, const char* end);
+bool endsInEscape(std::string_view s);
+
+// Filling in a JsonStats. Without JSONLIB_STATS each of these compiles to
+// nothing.
+static std::uint64_t startClock(JsonStats* stats)
+{
+    return (JsonStats::Enabled && stats) ? JsonStatsCollector::now() : 0;
+}
+
+static void stopClock(JsonStats* stats, std::uint64_t start, std::uint64_t JsonStats::* total)
+{
+    if (JsonStats::Enabled && stats) {
+        stats->*total += JsonStatsCollector::now() - start;
+    }
+}
+
+static void countValue(JsonStats* stats, JsonValue::Type type)
+{
+    if (JsonStats::Enabled && stats) {
+        ++stats->nodes[type];
+    }
+}
+
+static void countString(JsonStats* stats, size_t length)
+{
+    if (JsonStats::Enabled && stats && length > stats->longestString) {
+        stats->longestString = length;
+    }
+}
+
+static void countDepth(JsonStats* stats, size_t depth)
+{
+    if (JsonStats::Enabled && stats && depth > stats->maxDepth) {
+        stats->maxDepth = depth;
+    }
+}
+
+JsonDomBuilder::JsonDomBuilder(std::pmr::memory_resource* resource) :
+    resource_(resource)
+{}
+
+bool JsonDomBuilder::onNull()
+{
+    add(JsonValue());
+    return true;
+}
+
+bool JsonDomBuilder::onBool(bool b)
+{
+    add(JsonValue(b));
+    return true;
+}
+
+bool JsonDomBuilder::onNumber(const JsonValue& number)
+{
+    add(JsonValue(number));
+    return true;
+}
+
+bool JsonDomBuilder::onString(std::string_view s)
+{
+    if (!borrowed_.empty() && s.data() >= borrowed_.data() && s.data() + s.size() <= borrowed_.data() + borrowed_.size()) {
+        add(JsonValue::borrow(s));
+    }
+    else {
+        add(JsonValue(s, resource_));
+    }
+    return true;
+}
+
+bool JsonDomBuilder::onStartObject()
+{
+    frames_.push_back({ memberCount_, true });
+    return true;
+}
+
+bool JsonDomBuilder::onKey(std::string_view key)
+{
+    if (memberCount_ == members_.size()) {
+        members_.emplace_back();
+    }
+    members_[memberCount_++].first = key;
+    return true;
+}
+
+bool JsonDomBuilder::onEndObject()
+{
+    size_t base = frames_.back().base;
+    frames_.pop_back();
+    
+    // A repeated key keeps the last value, as with object[key] = value
+    JsonObject object(resource_);
+    object.reserve(memberCount_ - base);
+    for (size_t i = base; i < memberCount_; ++i) {
+        auto added = object.try_emplace(members_[i].first, std::move(members_[i].second));
+        if (!added.second) {
+            added.first->second = std::move(members_[i].second);
+        }
+    }
+    memberCount_ = base;
+    add(JsonValue(std::move(object), resource_));
+    return true;
+}
+
+bool JsonDomBuilder::onStartArray()
+{
+    frames_.push_back({ elements_.size(), false });
+    return true;
+}
+
+bool JsonDomBuilder::onEndArray()
+{
+    size_t base = frames_.back().base;
+    frames_.pop_back();
+    
+    JsonArray array(resource_);
+    array.reserve(elements_.size() - base);
+    for (size_t i = base; i < elements_.size(); ++i) {
+        array.push_back(std::move(elements_[i]));
+    }
+    elements_.resize(base);
+    add(JsonValue(std::move(array), resource_));
+    return true;
+}
+
+void JsonDomBuilder::reset(std::pmr::memory_resource* resource)
+{
+    frames_.clear();
+    elements_.clear();
+    for (size_t i = 0; i < memberCount_; ++i) {
+        members_[i].second = JsonValue();
+    }
+    memberCount_ = 0;
+    root_ = JsonValue();
+    resource_ = resource;
+}
+
+// Stores a finished value in the innermost open container
+void JsonDomBuilder::add(JsonValue&& value)
+{
+    if (frames_.empty()) {
+        root_ = std::move(value);
+    }
+    else if (frames_.back().object) {
+        members_[memberCount_ - 1].second = std::move(value);
+    }
+    else {
+        elements_.push_back(std::move(value));
+    }
+}
+
+// How the tokenizer gets from one token to the next. The tokenizer calls
+// next() once after every token it has consumed; it moves 'it' to where the
+// following token starts and returns false if the input ends first. After
+// a number or literal, which is read up to the first character that cannot
+// be part of it, endScalar() is called before next(). When a token fails to
+// parse, truncated() says whether that may only be because the input was
+// cut off in the middle of it.
+
+// Skips whitespace a byte at a time
+struct ByteCursor
+{
+    const char* end;
+    
+    bool next(const char*& it)
+    {
+        eatWs(it, end);
+        return it != end;
+    }
+    bool endScalar(const char*&) { return true; }
+    bool truncated(const char*) { return false; }
+};
+
+// Steps through a JsonIndex, one entry per token. Whatever lies between
+// the end of a structural character or string and the next entry can only
+// be whitespace, so it is skipped without being looked at. Numbers and
+// literals are the exception, as the index does not say where they end:
+// anything else that follows one is stopped at, like ByteCursor does, so
+// that the same error is reported at the same offset.
+struct IndexCursor
+{
+    const char* begin;
+    const char* end;
+    const std::uint32_t* pos;
+    const std::uint32_t* last;
+    // Set when a number or literal is followed by more than whitespace
+    bool stray = false;
+    
+    bool next(const char*& it)
+    {
+        if (stray) {
+            return true;
+        }
+        if (pos == last) {
+            eatWs(it, end);
+            return false;
+        }
+        const char* token = begin + *pos++;
+        if (token < it) {
+            // The token just read ran over the next entry
+            return false;
+        }
+        it = token;
+        return true;
+    }
+    bool endScalar(const char*& it)
+    {
+        const char* limit = pos != last ? begin + *pos : end;
+        eatWs(it, limit);
+        stray = (it != limit);
+        return true;
+    }
+    bool truncated(const char*) { return false; }
+};
+
+// Skips whitespace in one chunk of an input that arrives in pieces. Unless
+// it is the last chunk, running into its end suspends the parse rather than
+// failing it. A number or literal that reaches the end may go on in the
+// next chunk, so it is only complete if the chunk is known to end with it.
+struct ChunkCursor
+{
+    const char* end;
+    bool last;          // no more input follows
+    bool boundary;      // the chunk ends where a token does
+    bool suspended = false;
+    
+    bool next(const char*& it)
+    {
+        eatWs(it, end);
+        if (it == end) {
+            suspended = !last;
+            return false;
+        }
+        return true;
+    }
+    bool endScalar(const char*& it) { return it != end || last || boundary; }
+    bool truncated(const char* token)
+    {
+        if (last || boundary) {
+            return false;
+        }
+        suspended = (*token == '"' ? stringEnd(token + 1, end, false) : scalarEnd(token, end)) == nullptr;
+        return suspended;
+    }
+};
+
+JsonParser::JsonParser(JsonHandler& handler) :
+    handler_(&handler)
+{}
+
+JsonParser::JsonParser(JsonDomBuilder& builder) :
+    handler_(&builder),
+    builder_(&builder)
+{}
+
+bool JsonParser::parse(std::string_view json)
+{
+    restart();
+    const char* begin = json.data();
+    const char* it = begin;
+    const char* end = begin + json.size();
+    
+    bool ok;
+    if (indexed_ && json.size() >= IndexThreshold && index_.build(json)) {
+        IndexCursor cursor{ begin, end, index_.begin(), index_.end() };
+        ok = builder_ ? run(*builder_, cursor, it) : run(*handler_, cursor, it);
+    }
+    else {
+        ByteCursor cursor{ end };
+        ok = builder_ ? run(*builder_, cursor, it) : run(*handler_, cursor, it);
+    }
+    if (ok) {
+        // Only whitespace may follow the value
+        eatWs(it, end);
+        ok = (it == end);
+    }
+    restart();
+    offset_ = it - begin;
+    return ok;
+}
+
+bool JsonParser::parseInSitu(char* json, size_t size)
+{
+    inSitu_ = true;
+    bool ok = parse(std::string_view(json, size));
+    inSitu_ = false;
+    return ok;
+}
+
+bool JsonParser::parse(std::istream& is)
+{
+    restart();
+    std::unique_ptr<char[]> buffer(new char[StreamChunk]);
+    bool ok = true;
+    while (ok && is) {
+        is.read(buffer.get(), StreamChunk);
+        ok = feed(std::string_view(buffer.get(), static_cast<size_t>(is.gcount())));
+    }
+    return finish();
+}
+
+bool JsonParser::feed(std::string_view chunk)
+{
+    if (state_ == Failed) {
+        return false;
+    }
+    const char* begin = chunk.data();
+    const char* it = begin;
+    const char* end = begin + chunk.size();
+    size_t base = fed_;
+    fed_ += chunk.size();
+    
+    if (!carry_.empty()) {
+        // Find where the token cut off by the last chunk ends in this one
+        // and parse it whole
+        const char* rest = carry_[0] == '"' ? stringEnd(it, end, endsInEscape(carry_)) : scalarEnd(it, end);
+        if (!rest) {
+            carry_.append(it, end);
+            return true;
+        }
+        size_t carried = carry_.size();
+        carry_.append(it, rest);
+        const char* token = carry_.data();
+        if (!resume(token, carry_.data() + carry_.size(), true, false)) {
+            offset_ = base - carried + (token - carry_.data());
+            return false;
+        }
+        carry_.clear();
+        it = rest;
+    }
+    
+    bool ok = resume(it, end, false, false);
+    if (ok && it != end) {
+        // Keep the start of a token that goes on in the next chunk
+        carry_.assign(it, end);
+    }
+    offset_ = base + (it - begin);
+    return ok;
+}
+
+bool JsonParser::finish()
+{
+    bool ok = (state_ != Failed);
+    if (ok && state_ != Done) {
+        // A token held back from the last chunk now ends with the input
+        const char* it = carry_.data();
+        ok = resume(it, carry_.data() + carry_.size(), true, true) && state_ == Done;
+        offset_ = fed_ - carry_.size() + (it - carry_.data());
+    }
+    restart();
+    return ok;
+}
+
+void JsonParser::restart()
+{
+    stack_.clear();
+    carry_.clear();
+    state_ = Value;
+    fed_ = 0;
+}
+
+// Tokenizes [it, end) as one chunk of a larger input, carrying on from
+// where the previous chunk left off. Returns false on an error; otherwise
+// 'it' is left at the end of the chunk or at the start of a token that
+// the chunk cut off.
+bool JsonParser::resume(const char*& it, const char* end, bool boundary, bool last)
+{
+    if (state_ != Done) {
+        ChunkCursor cursor{ end, last, boundary };
+        bool complete = builder_ ? run(*builder_, cursor, it) : run(*handler_, cursor, it);
+        if (!complete) {
+            if (!cursor.suspended) {
+                state_ = Failed;
+            }
+            return cursor.suspended;
+        }
+        state_ = Done;
+    }
+    // Only whitespace may follow the value
+    eatWs(it, end);
+    if (it != end) {
+        state_ = Failed;
+        return false;
+    }
+    return true;
+}
+
+// The tokenizer proper. It walks the input once, without recursion, keeping
+// track of the open containers in stack_. The state says what the grammar
+// allows at the current token: any value, an object key, or the ',' or
+// closing bracket that follows a value inside a container. If the cursor
+// suspends the parse at the end of a chunk, the state to pick up in is
+// saved in state_ and 'it' left at the start of the unfinished token, if
+// any, so the next call carries on exactly where this one stopped.
+template<class Handler, class Cursor>
+bool JsonParser::run(Handler& handler, Cursor& cursor, const char*& it)
+{
+    const char* end = cursor.end;
+    State state = state_;
+    bool ok = true;
+    
+    // Moves to the next token, or saves the state to resume in if the chunk
+    // ends first
+    auto advance = [&](State resume) {
+        if (cursor.next(it)) {
+            return true;
+        }
+        state_ = resume;
+        return false;
+    };
+    // A token failed to parse: a syntax error, or cut off by the end of the
+    // chunk, in which case it is read again in full with the next one
+    auto cut = [&](const char* token) {
+        if (cursor.truncated(token)) {
+            it = token;
+            state_ = state;
+        }
+        return false;
+    };
+    
+    if (!advance(state)) {
+        return false;
+    }
+    // The states only used when resuming
+    if (state == FirstKey) {
+        state = (*it == '}') ? Next : Key;
+    }
+    else if (state == FirstValue) {
+        state = (*it == ']') ? Next : Value;
+    }
+    else if (state == Colon) {
+        if (*it != ':') {
+            return false;
+        }
+        ++it;
+        if (!advance(Value)) {
+            return false;
+        }
+        state = Value;
+    }
+    
+    for (;;) {
+        const char* token = it;
+        if (state == Key) {
+            if (*it != '"') {
+                return false;
+            }
+            std::uint64_t start = startClock(stats_);
+            std::string_view key = parseString(it, end, scratch_, ok);
+            stopClock(stats_, start, &JsonStats::stringNs);
+            if (!ok) {
+                return cut(token);
+            }
+            countString(stats_, key.size());
+            if (!handler.onKey(key) || !advance(Colon)) {
+                return false;
+            }
+            if (*it != ':') {
+                return false;
+            }
+            ++it;
+            if (!advance(Value)) {
+                return false;
+            }
+            state = Value;
+            continue;
+        }
+        
+        bool more = true;
+        if (state == Next) {
+            char c = *it++;
+            bool inObject = (stack_.back() == '{');
+            if (c == ',') {
+                state = inObject ? Key : Value;
+                if (!advance(state)) {
+                    return false;
+                }
+                continue;
+            }
+            if (c != (inObject ? '}' : ']')) {
+                return false;
+            }
+            stack_.pop_back();
+            more = inObject ? handler.onEndObject() : handler.onEndArray();
+        }
+        else {
+            switch (*it) {
+                case '{':
+                    ++it;
+                    stack_.push_back('{');
+                    countValue(stats_, JsonValue::Object);
+                    countDepth(stats_, stack_.size());
+                    if (!handler.onStartObject() || !advance(FirstKey)) {
+                        return false;
+                    }
+                    // An empty object is closed like any other
+                    state = (*it == '}') ? Next : Key;
+                    continue;
+                case '[':
+                    ++it;
+                    stack_.push_back('[');
+                    countValue(stats_, JsonValue::Array);
+                    countDepth(stats_, stack_.size());
+                    if (!handler.onStartArray() || !advance(FirstValue)) {
+                        return false;
+                    }
+                    state = (*it == ']') ? Next : Value;
+                    continue;
+                case '"': {
+                    std::uint64_t start = startClock(stats_);
+                    std::string_view s = parseString(it, end, scratch_, ok);
+                    stopClock(stats_, start, &JsonStats::stringNs);
+                    if (!ok) {
+                        return cut(token);
+                    }
+                    countValue(stats_, JsonValue::String);
+                    countString(stats_, s.size());
+                    if (inSitu_ && s.data() == scratch_.data()) {
+                        char* body = const_cast<char*>(token) + 1;
+                        std::memcpy(body, s.data(), s.size());
+                        s = std::string_view(body, s.size());
+                    }
+                    more = handler.onString(s);
+                    break;
+                }
+                case 't':
+                    if (!matchWord(it, end, "true", 4) || !cursor.endScalar(it)) {
+                        return cut(token);
+                    }
+                    countValue(stats_, JsonValue::Bool);
+                    more = handler.onBool(true);
+                    break;
+                case 'f':
+                    if (!matchWord(it, end, "false", 5) || !cursor.endScalar(it)) {
+                        return cut(token);
+                    }
+                    countValue(stats_, JsonValue::Bool);
+                    more = handler.onBool(false);
+                    break;
+                case 'n':
+                    if (!matchWord(it, end, "null", 4) || !cursor.endScalar(it)) {
+                        return cut(token);
+                    }
+                    countValue(stats_, JsonValue::Null);
+                    more = handler.onNull();
+                    break;
+                default: {
+                    std::uint64_t start = startClock(stats_);
+                    JsonValue number = parseNumeric(it, end, ok);
+                    stopClock(stats_, start, &JsonStats::numberNs);
+                    if (!ok || !cursor.endScalar(it)) {
+                        return cut(token);
+                    }
+                    countValue(stats_, number.type());
+                    more = handler.onNumber(number);
+                    break;
+                }
+            }
+        }
+        
+        // A value, or the end of a container, is complete
+        if (!more) {
+            return false;
+        }
+        if (stack_.empty()) {
+            return true;
+        }
+        if (!advance(Next)) {
+            return false;
+        }
+        state = Next;
+    }
+}
+
+
+
+// -------------------------------
+// Tokenizer helpers
+// -------------------------------
+//
+// Each function takes the read position by reference and advances it past
+// whatever it consumed. On a syntax error 'ok' is cleared and the caller
+// unwinds immediately, so the position is only meaningful while ok is true.
+
+inline bool isJsonWs(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+void eatWs(const char*& it, const char* end)
+{
+    while (it != end && isJsonWs(*it)) {
+        ++it;
+    }
+}
+
+// Returns the first character from 'it' on that ends a string or needs
+// decoding: a quote, a backslash or a control character
+const char* skipPlain(const char* it, const char* end)
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    while (end - it >= 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, backslash)),
+                                       _mm_cmpeq_epi8(_mm_max_epu8(c, control), control));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return it + __builtin_ctz(mask);
+        }
+        it += 16;
+    }
+#endif
+    while (it != end && *it != '"' && *it != '\\' && static_cast<unsigned char>(*it) >= 0x20) {
+        ++it;
+    }
+    return it;
+}
+
+// Returns the position just past the closing quote of a string whose
+// contents start at 'it', or nullptr if the string goes on past 'end'.
+// 'escaped' says whether the first character is escaped by a backslash
+// that came before 'it'. Escapes are only skipped here, not checked.
+const char* stringEnd(const char* it, const char* end, bool escaped)
+{
+    if (escaped) {
+        if (it == end) {
+            return nullptr;
+        }
+        ++it;
+    }
+    for (;;) {
+        it = skipPlain(it, end);
+        if (it == end) {
+            return nullptr;
+        }
+        if (*it != '\\') {
+            // The closing quote, or a control character the parser rejects
+            return it + 1;
+        }
+        if (end - it < 2) {
+            return nullptr;
+        }
+        it += 2;
+    }
+}
+
+// Returns the first character from 'it' on that cannot be part of a number
+// or literal, or nullptr if there is none before 'end'
+const char* scalarEnd(const char* it, const char* end)
+{
+    for (; it != end; ++it) {
+        char c = *it;
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '+' || c == '-' || c == '.')) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+// Whether the start of a string ends with a backslash that escapes whatever
+// comes next
+bool endsInEscape(std::string_view s)
+{
+    size_t backslashes = 0;
+    while (backslashes < s.size() && s[s.size() - 1 - backslashes] == '\\') {
+        ++backslashes;
+    }
+    return (backslashes & 1) != 0;
+}
+
+// Returns a view of the decoded string. That is a view straight into the
+// input when the string has no escapes, and into 'scratch' otherwise.
+std::string_view parseString(const char*& it, const char* end, std::string& scratch, bool& ok)
+{
+    ++it;   // opening "
+    const char* start = it;
+    bool escaped = false;
+    for (;;) {
+        // Skip over the longest run of plain characters in one go
+        const char* run = it;
+        it = skipPlain(it, end);
+        if (escaped) {
+            scratch.append(run, it);
+        }
+        
+        if (it == end) {
+            ok = false;
+            break;
+        }
+        if (*it == '"') {
+            ++it;   // closing "
+            break;
+        }
+        if (*it == '\\') {
+            if (!escaped) {
+                escaped = true;
+                scratch.assign(start, it);
+            }
+            parseEscape(it, end, scratch, ok);
+            if (!ok) {
+                break;
+            }
+        }
+        else {
+            // Unescaped control character
+            ok = false;
+            break;
+        }
+    }
+    if (escaped) {
+        return scratch;
+    }
+    return std::string_view(start, it - start - (ok ? 1 : 0));
+}
+
+// Reads four hex digits of a \u escape
+bool parseHex4(const char*& it, const char* end, unsigned& cp)
+{
+    if (end - it < 4) {
+        return false;
+    }
+    cp = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = *it++;
+        cp <<= 4;
+        if (c >= '0' && c <= '9') {
+            cp |= c - '0';
+        }
+        else if (c >= 'a' && c <= 'f') {
+            cp |= c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F') {
+            cp |= c - 'A' + 10;
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendUtf8(std::string& s, unsigned cp)
+{
+    if (cp < 0x80) {
+        s.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800) {
+        s.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000) {
+        s.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else {
+        s.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        s.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+void parseEscape(const char*& it, const char* end, std::string& s, bool& ok)
+{
+    ++it;   // initial '\' to start the escape
+    if (it == end) {
+        ok = false;
+        return;
+    }
+    switch (*it++) {
+        case '"':
+            s.push_back('"');
+            break;
+        case '\\':
+            s.push_back('\\');
+            break;
+        case '/':
+            s.push_back('/');
+            break;
+        case 'b':
+            s.push_back('\b');
+            break;
+        case 'f':
+            s.push_back('\f');
+            break;
+        case 'n':
+            s.push_back('\n');
+            break;
+        case 'r':
+            s.push_back('\r');
+            break;
+        case 't':
+            s.push_back('\t');
+            break;
+        case 'u': {
+            unsigned cp;
+            if (!parseHex4(it, end, cp)) {
+                ok = false;
+                break;
+            }
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                // High surrogate, must be followed by an escaped low surrogate
+                unsigned lo;
+                if (end - it < 2 || it[0] != '\\' || it[1] != 'u') {
+                    ok = false;
+                    break;
+                }
+                it += 2;
+                if (!parseHex4(it, end, lo) || lo < 0xDC00 || lo > 0xDFFF) {
+                    ok = false;
+                    break;
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+            else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                // Lone low surrogate
+                ok = false;
+                break;
+            }
+            appendUtf8(s, cp);
+            break;
+        }
+        default:
+            ok = false;
+            break;
+    }
+}
+
+bool matchWord(const char*& it, const char* end, const char* word, size_t len)
+{
+    if (static_cast<size_t>(end - it) < len || std::memcmp(it, word, len) != 0) {
+        return false;
+    }
+    it += len;
+    return true;
+}
+
+// Parses a number in place. Integral literals become exact Int values
+// (int64_t, or uint64_t above INT64_MAX); everything else, including
+// integers too large for 64 bits, becomes a correctly rounded Double.
+JsonValue parseNumeric(const char*& it, const char* end, bool& ok)
+{
+    // -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+    const char* start = it;
+    auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+    
+    bool negative = false;
+    if (it != end && *it == '-') {
+        negative = true;
+        ++it;
+    }
+    if (it == end || !isDigit(*it)) {
+        ok = false;
+        return JsonValue();
+    }
+    
+    // Accumulate up to 19 significant digits, which always fit in a uint64_t
+    std::uint64_t mantissa = 0;
+    int significant = 0;
+    int dropped = 0;        // significant digits that did not fit
+    auto addDigit = [&](char c) {
+        if (significant == 0 && c == '0') {
+            return;
+        }
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (c - '0');
+            ++significant;
+        }
+        else {
+            ++dropped;
+        }
+    };
+    
+    int intDigits = 0;
+    if (*it == '0') {
+        ++it;
+    }
+    else {
+        while (it != end && isDigit(*it)) {
+            addDigit(*it++);
+            ++intDigits;
+        }
+    }
+    bool integral = true;
+    int fracDigits = 0;     // fraction digits up to the last one kept in the mantissa
+    int fracZeros = 0;      // zeros between the point and the first significant digit
+    if (it != end && *it == '.') {
+        integral = false;
+        ++it;
+        if (it == end || !isDigit(*it)) {
+            ok = false;
+            return JsonValue();
+        }
+        while (it != end && isDigit(*it)) {
+            if (significant == 0 && *it == '0') {
+                ++fracZeros;
+                ++fracDigits;
+            }
+            else if (significant < 19) {
+                ++fracDigits;
+            }
+            addDigit(*it++);
+        }
+    }
+    int exponent = 0;
+    if (it != end && (*it == 'e' || *it == 'E')) {
+        integral = false;
+        ++it;
+        bool negativeExp = false;
+        if (it != end && (*it == '+' || *it == '-')) {
+            negativeExp = (*it == '-');
+            ++it;
+        }
+        if (it == end || !isDigit(*it)) {
+            ok = false;
+            return JsonValue();
+        }
+        while (it != end && isDigit(*it)) {
+            if (exponent < 100000) {
+                exponent = exponent * 10 + (*it - '0');
+            }
+            ++it;
+        }
+        if (negativeExp) {
+            exponent = -exponent;
+        }
+    }
+    
+    if (integral) {
+        if (dropped == 0) {
+            if (!negative) {
+                return JsonValue(static_cast<unsigned long long>(mantissa));
+            }
+            if (mantissa <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+                return JsonValue(-static_cast<long long>(mantissa));
+            }
+            if (mantissa == static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + 1) {
+                return JsonValue(std::numeric_limits<long long>::min());
+            }
+        }
+        else if (dropped == 1 && !negative) {
+            // Twenty digits may still fit a uint64_t
+            std::uint64_t last = *(it - 1) - '0';
+            if (mantissa <= (std::numeric_limits<std::uint64_t>::max() - last) / 10) {
+                return JsonValue(static_cast<unsigned long long>(mantissa * 10 + last));
+            }
+        }
+    }
+    
+    // Exact fast path: both the mantissa and the power of ten are exactly
+    // representable, so a single multiplication or division rounds correctly
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    int exp10 = exponent - fracDigits;
+    if (dropped == 0 && mantissa <= (std::uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+        double d = static_cast<double>(mantissa);
+        d = exp10 < 0 ? d / powersOf10[-exp10] : d * powersOf10[exp10];
+        return JsonValue(negative ? -d : d);
+    }
+    
+    double d = 0.0;
+    auto result = std::from_chars(start, it, d);
+    if (result.ec == std::errc::result_out_of_range) {
+        // Decide between overflow and underflow from the decimal magnitude
+        int magnitude = exponent + (intDigits > 0 ? intDigits : -fracZeros);
+        d = magnitude > 0 ? std::numeric_limits<double>::infinity() : 0.0;
+        d = negative ? -d : d;
+    }
+    else if (result.ec != std::errc() || result.ptr != it) {
+        ok = false;
+        return JsonValue();
+    }
+    return JsonValue(d);
+}
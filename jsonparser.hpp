@@ -0,0 +1,194 @@
+//
+//  jsonparser.hpp
+//  JsonLib
+//
+
+#ifndef jsonparser_hpp
+#define jsonparser_hpp
+
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "jsonindex.hpp"
+#include "jsonstats.hpp"
+#include "jsonvalue.hpp"
+
+// Receives the contents of a JSON text as a sequence of events, in document
+// order. Every callback returns true to continue, or false to stop parsing.
+// The default implementations ignore the event, so a handler only needs to
+// override the ones it cares about.
+//
+// The string_view passed to onKey() and onString() is only valid for the
+// duration of the call. It points straight into the input when the string
+// has no escapes, and into a scratch buffer holding the decoded text when
+// it does.
+class JsonHandler
+{
+public:
+    virtual ~JsonHandler() = default;
+    
+    virtual bool onNull() { return true; }
+    virtual bool onBool(bool) { return true; }
+    // The number is an Int or a Double, parsed exactly as JsonDocument would
+    virtual bool onNumber(const JsonValue&) { return true; }
+    virtual bool onString(std::string_view) { return true; }
+    virtual bool onStartObject() { return true; }
+    virtual bool onKey(std::string_view) { return true; }
+    virtual bool onEndObject() { return true; }
+    virtual bool onStartArray() { return true; }
+    virtual bool onEndArray() { return true; }
+};
+
+// The handler JsonDocument parses with: assembles the events into a tree
+// allocated from 'resource'. Values of unfinished containers are kept on
+// flat stacks and each container is built at its exact size once it ends.
+class JsonDomBuilder final : public JsonHandler
+{
+public:
+    explicit JsonDomBuilder(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    
+    bool onNull() override;
+    bool onBool(bool) override;
+    bool onNumber(const JsonValue&) override;
+    bool onString(std::string_view) override;
+    bool onStartObject() override;
+    bool onKey(std::string_view) override;
+    bool onEndObject() override;
+    bool onStartArray() override;
+    bool onEndArray() override;
+    
+    // String values that lie within 'input' are borrowed from it rather
+    // than copied (see JsonValue::borrow), so 'input' must outlive the tree.
+    // Strings with escapes are decoded elsewhere and still copied.
+    void borrowStrings(std::string_view input) { borrowed_ = input; }
+    
+    // The top-level value, complete once parsing has succeeded
+    JsonValue& result() noexcept { return root_; }
+    // Drops whatever an earlier parse left behind, including the values of
+    // containers a failed parse never closed, and builds the next tree from
+    // 'resource'. Reusing a builder this way keeps its stacks allocated.
+    void reset(std::pmr::memory_resource* resource);
+
+private:
+    struct Frame {
+        size_t base;    // first slot of this container in elements_ or members_
+        bool object;
+    };
+    
+    void add(JsonValue&&);
+    
+    std::pmr::memory_resource* resource_;
+    std::string_view borrowed_;
+    std::vector<Frame> frames_;
+    std::vector<JsonValue> elements_;
+    // Slots above memberCount_ are kept so their key buffers get reused
+    std::vector<std::pair<std::string, JsonValue>> members_;
+    size_t memberCount_ = 0;
+    JsonValue root_;
+};
+
+// Tokenizes a JSON text and reports it to a JsonHandler without building
+// anything itself. Besides the input, the parser only holds one byte per
+// level of nesting and a buffer for decoding escaped strings, so memory
+// use no longer grows with the size of the document. Runs of plain string
+// characters are scanned 16 bytes at a time where SSE2 is available.
+//
+// Since the tokenizer does not recurse, nesting is limited only by memory,
+// and a JsonDocument of any depth can be parsed and dropped. Writing,
+// comparing and hashing a tree, and copying one that holds borrowed
+// strings, still recurse once per level, though, so input that may nest
+// tens of thousands of levels deep is best handled with a JsonHandler, or
+// checked for depth before doing those.
+class JsonParser
+{
+public:
+    explicit JsonParser(JsonHandler& handler);
+    explicit JsonParser(JsonDomBuilder& builder);
+    
+    // Parses one complete JSON value, which may be surrounded by whitespace.
+    // Returns false on a syntax error or when the handler stopped parsing;
+    // the events reported up to that point are not taken back.
+    bool parse(std::string_view json);
+    // Reads the rest of the stream and parses it as above, a block at a
+    // time through feed() so that no copy of the whole text is made
+    bool parse(std::istream& is);
+    // Parses like parse(std::string_view), but decodes each escaped string
+    // value over its own text in 'json', which is never shorter than the
+    // decoded form. The views passed to onString() then always point into
+    // 'json', where they stay valid after the call. Keys are still decoded
+    // into the scratch buffer.
+    bool parseInSitu(char* json, size_t size);
+    
+    // Parses input that arrives in pieces, such as a request body read off
+    // a socket. Each chunk is tokenized as it is fed and its events reported
+    // before feed() returns, so no byte is scanned twice and nothing needs
+    // to be buffered, except for a token cut in two by the end of a chunk:
+    // its start is kept until the rest arrives. The chunk need not outlive
+    // the call. finish() marks the end of the input and returns whether it
+    // held exactly one complete value; the parser is then ready for the
+    // next one. After an error feed() keeps returning false until finish().
+    bool feed(std::string_view chunk);
+    bool finish();
+    
+    // Where parsing stopped in the last input, relative to its start. For
+    // input that is fed in chunks, relative to the start of the first one.
+    size_t offset() const noexcept { return offset_; }
+    
+    // Locate the tokens of large inputs through a JsonIndex built up front,
+    // rather than by skipping whitespace a byte at a time. Off by default:
+    // the index costs a pass over the input and four bytes per token, and
+    // scanning strings and numbers remains the bulk of the work either way.
+    void setIndexed(bool indexed) { indexed_ = indexed; }
+    
+    // Counts what is parsed into 'stats', or stops counting if null. Only
+    // has an effect when built with JSONLIB_STATS; see JsonStats.
+    void setStats(JsonStats* stats) { stats_ = stats; }
+
+private:
+    // What the grammar allows at the next token
+    enum State {
+        Value,
+        FirstValue,     // a value or the end of the array just opened
+        Key,
+        FirstKey,       // a key or the end of the object just opened
+        Colon,
+        Next,           // ',' or the end of the innermost container
+        Done,
+        Failed
+    };
+    
+    // Inputs smaller than this are tokenized without a JsonIndex
+    static constexpr size_t IndexThreshold = 64 * 1024;
+    // How much of a stream is read and parsed at a time
+    static constexpr size_t StreamChunk = 64 * 1024;
+    
+    template<class Handler, class Cursor>
+    bool run(Handler& handler, Cursor& cursor, const char*& it);
+    bool resume(const char*& it, const char* end, bool boundary, bool last);
+    void restart();
+    
+    JsonHandler* handler_;
+    // Set when parsing for a JsonDocument, so the tokenizer can call the
+    // builder directly instead of through virtual calls
+    JsonDomBuilder* builder_ = nullptr;
+    // '[' or '{' for each open container
+    std::string stack_;
+    std::string scratch_;
+    JsonIndex index_;
+    // Where the tokenizer stopped, while parsing input fed in chunks
+    State state_ = Value;
+    // The start of a token cut off by the end of the last chunk
+    std::string carry_;
+    // Bytes fed since the first chunk
+    size_t fed_ = 0;
+    size_t offset_ = 0;
+    bool indexed_ = false;
+    JsonStats* stats_ = nullptr;
+    // Set for the duration of parseInSitu()
+    bool inSitu_ = false;
+};
+
+#endif /* jsonparser_hpp */
@@ -0,0 +1,415 @@
+//
+//  jsonpath.cpp
+//  JsonLib
+//
+
+#include "jsonpath.hpp"
+#include "jsonarray.hpp"
+#include "jsonobject.hpp"
+#include "jsonreader.hpp"
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <limits>
+#include <unordered_map>
+
+static bool isNameChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+// Reads an optionally negative integer. Returns false, leaving 'it' alone,
+// if there is none.
+static bool parseInteger(const char*& it, const char* end, std::int64_t& value)
+{
+    auto result = std::from_chars(it, end, value);
+    if (result.ec != std::errc() || value == std::numeric_limits<std::int64_t>::min()) {
+        return false;
+    }
+    it = result.ptr;
+    return true;
+}
+
+// Counts the elements of the array at the start of 'json'
+static std::int64_t countElements(std::string_view json)
+{
+    JsonReader reader(json);
+    std::int64_t n = 0;
+    if (reader.array()) {
+        while (reader.nextElement()) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+JsonPath::Step JsonPath::member(std::string key)
+{
+    Step step;
+    step.kind = Member;
+    step.hash = JsonObject::hashKey(key);
+    step.key = std::move(key);
+    return step;
+}
+
+JsonPath::Step JsonPath::wildcard()
+{
+    Step step;
+    step.kind = Wildcard;
+    return step;
+}
+
+JsonPath JsonPath::pointer(std::string_view pointer)
+{
+    JsonPath path;
+    if (pointer.empty()) {
+        return path;
+    }
+    if (pointer[0] != '/') {
+        path.ok_ = false;
+        return path;
+    }
+
+    size_t pos = 1;
+    for (;;) {
+        size_t slash = std::min(pointer.find('/', pos), pointer.size());
+        std::string token;
+        for (size_t i = pos; i < slash; ++i) {
+            if (pointer[i] != '~') {
+                token += pointer[i];
+            }
+            else if (i + 1 < slash && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+                token += (pointer[++i] == '0') ? '~' : '/';
+            }
+            else {
+                path.ok_ = false;
+                return path;
+            }
+        }
+
+        Step step = member(std::move(token));
+        // The same token names an element when it is a plain decimal number
+        const std::string& key = step.key;
+        bool digits = !key.empty() && std::all_of(key.begin(), key.end(), [](char c) { return c >= '0' && c <= '9'; });
+        if (digits && (key.size() == 1 || key[0] != '0')) {
+            std::int64_t index;
+            if (std::from_chars(key.data(), key.data() + key.size(), index).ec == std::errc()) {
+                step.index = index;
+            }
+        }
+        path.steps_.push_back(std::move(step));
+
+        if (slash == pointer.size()) {
+            break;
+        }
+        pos = slash + 1;
+    }
+    return path;
+}
+
+JsonPath JsonPath::compile(std::string_view text)
+{
+    JsonPath path;
+    const char* it = text.data();
+    const char* end = it + text.size();
+    auto fail = [&]() {
+        path.steps_.clear();
+        path.ok_ = false;
+        return path;
+    };
+
+    if (it == end || *it != '$') {
+        return fail();
+    }
+    ++it;
+    while (it != end) {
+        if (*it == '.') {
+            ++it;
+            if (it != end && *it == '*') {
+                ++it;
+                path.steps_.push_back(wildcard());
+                continue;
+            }
+            const char* name = it;
+            while (it != end && isNameChar(*it)) {
+                ++it;
+            }
+            if (it == name) {
+                return fail();
+            }
+            path.steps_.push_back(member(std::string(name, it)));
+            continue;
+        }
+        if (*it != '[' || ++it == end) {
+            return fail();
+        }
+
+        if (*it == '*') {
+            ++it;
+            path.steps_.push_back(wildcard());
+        }
+        else if (*it == '\'' || *it == '"') {
+            char quote = *it++;
+            std::string name;
+            while (it != end && *it != quote) {
+                if (*it == '\\') {
+                    if (++it == end) {
+                        return fail();
+                    }
+                }
+                name += *it++;
+            }
+            if (it == end) {
+                return fail();
+            }
+            ++it;
+            path.steps_.push_back(member(std::move(name)));
+        }
+        else {
+            Step step;
+            step.kind = Index;
+            step.hasStart = parseInteger(it, end, step.start);
+            if (it != end && *it == ':') {
+                step.kind = Slice;
+                ++it;
+                step.hasEnd = parseInteger(it, end, step.end);
+                if (it != end && *it == ':') {
+                    ++it;
+                    parseInteger(it, end, step.step);
+                }
+            }
+            else if (step.hasStart) {
+                step.index = step.start;
+            }
+            else {
+                return fail();
+            }
+            path.steps_.push_back(step);
+        }
+
+        if (it == end || *it != ']') {
+            return fail();
+        }
+        ++it;
+    }
+    return path;
+}
+
+bool JsonPath::isSingular() const noexcept
+{
+    return std::all_of(steps_.begin(), steps_.end(), [](const Step& step) { return step.kind == Member || step.kind == Index; });
+}
+
+// Slices follow Python: negative bounds count from the end, bounds out of
+// range are clamped, and a negative step walks backwards
+bool JsonPath::elementRange(const Step& step, std::int64_t size, std::int64_t& first, std::int64_t& last, std::int64_t& stride)
+{
+    stride = 1;
+    switch (step.kind) {
+        case Member:
+        case Index:
+            first = (step.index < 0 && step.kind == Index) ? size + step.index : step.index;
+            last = first + 1;
+            return first >= 0 && first < size;
+        case Wildcard:
+            first = 0;
+            last = size;
+            return size > 0;
+        case Slice:
+            break;
+    }
+
+    stride = step.step;
+    if (stride == 0) {
+        return false;
+    }
+    auto bound = [size](std::int64_t i, std::int64_t low, std::int64_t high) {
+        return std::clamp(i >= 0 ? i : size + i, low, high);
+    };
+    if (stride > 0) {
+        first = step.hasStart ? bound(step.start, 0, size) : 0;
+        last = step.hasEnd ? bound(step.end, 0, size) : size;
+        return first < last;
+    }
+    first = step.hasStart ? bound(step.start, -1, size - 1) : size - 1;
+    last = step.hasEnd ? bound(step.end, -1, size - 1) : -1;
+    return first > last;
+}
+
+// Whether the elements a step selects depend on the length of the array
+bool JsonPath::needsSize(const Step& step)
+{
+    switch (step.kind) {
+        case Index:
+            return step.index < 0;
+        case Slice:
+            return step.step < 0 || (step.hasStart && step.start < 0) || (step.hasEnd && step.end < 0);
+        default:
+            return false;
+    }
+}
+
+// Calls 'emit' with each value that steps i and on select from 'value'.
+// Returns false as soon as 'emit' does.
+template<class Emit>
+bool JsonPath::walk(const JsonValue& value, size_t i, Emit& emit) const
+{
+    if (i == steps_.size()) {
+        return emit(value);
+    }
+    const Step& step = steps_[i];
+
+    if (value.type() == JsonValue::Object) {
+        const JsonObject& object = value.to_object();
+        if (step.kind == Member) {
+            auto it = object.find(step.key, step.hash);
+            return it == object.end() || walk(it->second, i + 1, emit);
+        }
+        if (step.kind == Wildcard) {
+            for (const auto& pr : object) {
+                if (!walk(pr.second, i + 1, emit)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::int64_t first, last, stride;
+    if (value.type() == JsonValue::Array && elementRange(step, value.to_array().size(), first, last, stride)) {
+        const JsonArray& array = value.to_array();
+        for (std::int64_t k = first; ; k += stride) {
+            if (!walk(array[k], i + 1, emit)) {
+                return false;
+            }
+            // Stop before stepping past the end, which could overflow
+            if (stride > 0 ? last - k <= stride : k - last <= -stride) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+const JsonValue* JsonPath::find(const JsonValue& root) const
+{
+    const JsonValue* found = nullptr;
+    if (ok_) {
+        auto emit = [&](const JsonValue& v) {
+            found = &v;
+            return false;
+        };
+        walk(root, 0, emit);
+    }
+    return found;
+}
+
+std::vector<const JsonValue*> JsonPath::select(const JsonValue& root) const
+{
+    std::vector<const JsonValue*> matches;
+    if (ok_) {
+        auto emit = [&](const JsonValue& v) {
+            matches.push_back(&v);
+            return true;
+        };
+        walk(root, 0, emit);
+    }
+    return matches;
+}
+
+bool JsonPath::select(std::string_view json, std::vector<JsonValue>& matches) const
+{
+    if (!ok_) {
+        return false;
+    }
+    JsonReader reader(json);
+    stream(reader, json, 0, matches);
+    return reader.finish();
+}
+
+// Consumes the value the reader stands at, parsing what steps i and on
+// select from it into 'matches'
+void JsonPath::stream(JsonReader& reader, std::string_view json, size_t i, std::vector<JsonValue>& matches) const
+{
+    if (i == steps_.size()) {
+        JsonValue value = reader.get_value();
+        if (reader.isValid()) {
+            matches.push_back(std::move(value));
+        }
+        return;
+    }
+    const Step& step = steps_[i];
+    JsonValue::Type type = reader.type();
+
+    // A repeated key keeps the place of its first member and the value of
+    // its last, as when the object is parsed into a tree, so every member
+    // has to be looked at
+    if (type == JsonValue::Object && (step.kind == Member || step.kind == Wildcard)) {
+        reader.object();
+        std::string_view key;
+        if (step.kind == Member) {
+            std::vector<JsonValue> found;
+            while (reader.nextField(key)) {
+                if (key == step.key) {
+                    found.clear();
+                    stream(reader, json, i + 1, found);
+                }
+            }
+            std::move(found.begin(), found.end(), std::back_inserter(matches));
+            return;
+        }
+        std::vector<std::vector<JsonValue>> members;
+        std::unordered_map<std::string, size_t> positions;
+        while (reader.nextField(key)) {
+            auto added = positions.try_emplace(std::string(key), members.size());
+            if (added.second) {
+                members.emplace_back();
+            }
+            std::vector<JsonValue>& found = members[added.first->second];
+            found.clear();
+            stream(reader, json, i + 1, found);
+        }
+        for (std::vector<JsonValue>& found : members) {
+            std::move(found.begin(), found.end(), std::back_inserter(matches));
+        }
+        return;
+    }
+
+    std::int64_t first, last, stride;
+    if (type == JsonValue::Array) {
+        // Without the length, a range open at the end runs as far as needed
+        std::int64_t size = needsSize(step) ? countElements(json.substr(reader.offset())) : std::numeric_limits<std::int64_t>::max();
+        if (elementRange(step, size, first, last, stride)) {
+            // Matches of a backward slice come in forwards, one group per
+            // element; the groups are put in order at the end
+            size_t mark = matches.size();
+            std::vector<size_t> groups;
+            reader.array();
+            for (std::int64_t k = 0; reader.nextElement(); ++k) {
+                bool selected = (stride > 0) ? (k >= first && k < last && (k - first) % stride == 0)
+                                             : (k <= first && k > last && (first - k) % -stride == 0);
+                if (selected) {
+                    groups.push_back(matches.size());
+                    stream(reader, json, i + 1, matches);
+                }
+                if ((stride > 0) ? k + 1 >= last : k >= first) {
+                    reader.leave();
+                    break;
+                }
+            }
+            if (stride < 0 && groups.size() > 1) {
+                std::vector<JsonValue> ordered;
+                ordered.reserve(matches.size() - mark);
+                groups.push_back(matches.size());
+                for (size_t g = groups.size() - 1; g-- > 0;) {
+                    std::move(matches.begin() + groups[g], matches.begin() + groups[g + 1], std::back_inserter(ordered));
+                }
+                matches.resize(mark);
+                std::move(ordered.begin(), ordered.end(), std::back_inserter(matches));
+            }
+            return;
+        }
+    }
+    reader.skip();
+}
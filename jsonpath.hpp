@@ -0,0 +1,106 @@
+//
+//  jsonpath.hpp
+//  JsonLib
+//
+
+#ifndef jsonpath_hpp
+#define jsonpath_hpp
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "jsonvalue.hpp"
+
+class JsonReader;
+
+// A path into a JSON tree, compiled once and evaluated any number of times.
+// Paths are written either as a JSON Pointer (RFC 6901):
+//
+//     /store/book/0/title
+//
+// or in a subset of JSONPath: member names, indexes counting back from the
+// end when negative, wildcards and slices.
+//
+//     $.store.book[*].title
+//     $['store']['book'][-1]
+//     $.store.book[0:10:2]
+//
+// Member names are hashed when the path is compiled, so evaluating it does
+// no more than look each one up. A path can be evaluated against a tree or
+// straight against JSON text, in which case only the matches are parsed.
+//
+//     JsonPath titles = JsonPath::compile("$.store.book[*].title");
+//     for (const JsonValue* title : titles.select(doc.to_value())) ...
+class JsonPath
+{
+public:
+    // The empty path, which selects the value it is evaluated against
+    JsonPath() = default;
+
+    // Compile a JSON Pointer or a JSONPath. The result is invalid, and
+    // matches nothing, if the syntax is wrong.
+    static JsonPath pointer(std::string_view pointer);
+    static JsonPath compile(std::string_view path);
+
+    bool isValid() const noexcept { return ok_; }
+    // True when the path can match at most one value: it has no wildcards
+    // or slices, as with any JSON Pointer
+    bool isSingular() const noexcept;
+
+    // The first match in document order, or null if there is none
+    const JsonValue* find(const JsonValue& root) const;
+    // Every match, in document order. The pointers are valid for as long
+    // as the tree they point into is neither changed nor destroyed.
+    std::vector<const JsonValue*> select(const JsonValue& root) const;
+
+    // Evaluate against a JSON text with a JsonReader, parsing the matches
+    // into 'matches' and only skipping over the rest. A slice with a
+    // negative step or bound, or a negative index, takes an extra pass over
+    // the array to count its elements. The matches are those of the tree
+    // the text parses into, repeated keys included. Returns false, with the
+    // matches up to that point, if the text turns out to be malformed or
+    // anything but whitespace follows it; parts that are skipped are only
+    // checked as far as JsonReader::skip() checks them.
+    bool select(std::string_view json, std::vector<JsonValue>& matches) const;
+
+private:
+    enum Kind {
+        Member,
+        Index,
+        Slice,
+        Wildcard
+    };
+
+    struct Step {
+        Kind kind = Member;
+        // Member: the name and its JsonObject::hashKey()
+        std::string key;
+        size_t hash = 0;
+        // Member: the array element a JSON Pointer token also names, or -1.
+        // Index: the element, counting from the end when negative.
+        std::int64_t index = -1;
+        // Slice: [start:end:step], with start and end optional
+        std::int64_t start = 0;
+        std::int64_t end = 0;
+        std::int64_t step = 1;
+        bool hasStart = false;
+        bool hasEnd = false;
+    };
+
+    static Step member(std::string key);
+    static Step wildcard();
+    // The elements of an array of 'size' elements that 'step' selects:
+    // first, first + stride, ... up to but excluding last. False if none.
+    static bool elementRange(const Step& step, std::int64_t size, std::int64_t& first, std::int64_t& last, std::int64_t& stride);
+    static bool needsSize(const Step& step);
+
+    template<class Emit>
+    bool walk(const JsonValue& value, size_t i, Emit& emit) const;
+    void stream(JsonReader& reader, std::string_view json, size_t i, std::vector<JsonValue>& matches) const;
+
+    std::vector<Step> steps_;
+    bool ok_ = true;
+};
+
+#endif /* jsonpath_hpp */
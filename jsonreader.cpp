@@ -0,0 +1,393 @@
+//
+//  jsonreader.cpp
+//  JsonLib
+//
+
+#include "jsonreader.hpp"
+#include "jsonparser.hpp"
+
+void eatWs(const char*& it, const char* end);
+const char* skipPlain(const char* it, const char* end);
+std::string_view parseString(const char*& it, const char* end, std::string& scratch, bool& ok);
+bool matchWord(const char*& it, const char* end, const char* word, size_t len);
+JsonValue parseNumeric(const char*& it, const char* end, bool& ok);
+
+JsonReader::JsonReader(std::string_view json) :
+    begin_(json.data()),
+    it_(json.data()),
+    end_(json.data() + json.size())
+{}
+
+JsonValue::Type JsonReader::type()
+{
+    if (!ok_ || !pending_) {
+        return JsonValue::Null;
+    }
+    eatWs(it_, end_);
+    if (it_ == end_) {
+        fail();
+        return JsonValue::Null;
+    }
+    switch (*it_) {
+        case '{':
+            return JsonValue::Object;
+        case '[':
+            return JsonValue::Array;
+        case '"':
+            return JsonValue::String;
+        case 't':
+        case 'f':
+            return JsonValue::Bool;
+        case 'n':
+            return JsonValue::Null;
+        default:
+            break;
+    }
+    for (const char* p = it_; p != end_; ++p) {
+        char c = *p;
+        if (c == '.' || c == 'e' || c == 'E') {
+            return JsonValue::Double;
+        }
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+')) {
+            break;
+        }
+    }
+    return JsonValue::Int;
+}
+
+bool JsonReader::object()
+{
+    return enter('{');
+}
+
+bool JsonReader::array()
+{
+    return enter('[');
+}
+
+bool JsonReader::nextField(std::string_view& key)
+{
+    if (!nextMember('}')) {
+        return false;
+    }
+    if (*it_ != '"') {
+        return fail();
+    }
+    bool ok = true;
+    key = parseString(it_, end_, scratch_, ok);
+    if (!ok) {
+        return fail();
+    }
+    eatWs(it_, end_);
+    if (it_ == end_ || *it_ != ':') {
+        return fail();
+    }
+    ++it_;
+    pending_ = true;
+    return true;
+}
+
+bool JsonReader::nextElement()
+{
+    if (!nextMember(']')) {
+        return false;
+    }
+    pending_ = true;
+    return true;
+}
+
+bool JsonReader::find_field(std::string_view key)
+{
+    std::string_view name;
+    while (nextField(name)) {
+        if (name == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::int64_t JsonReader::get_int64()
+{
+    JsonValue v = getNumber();
+    if (v.type() != JsonValue::Int || v.is_uint64()) {
+        fail();
+        return 0;
+    }
+    return v.to_int();
+}
+
+std::uint64_t JsonReader::get_uint64()
+{
+    JsonValue v = getNumber();
+    if (v.type() != JsonValue::Int || (!v.is_uint64() && v.to_int() < 0)) {
+        fail();
+        return 0;
+    }
+    return v.to_uint();
+}
+
+double JsonReader::get_double()
+{
+    JsonValue v = getNumber();
+    if (v.type() != JsonValue::Int && v.type() != JsonValue::Double) {
+        fail();
+        return 0.0;
+    }
+    return v.to_double();
+}
+
+bool JsonReader::get_bool()
+{
+    if (!atValue()) {
+        return false;
+    }
+    pending_ = false;
+    if (matchWord(it_, end_, "true", 4)) {
+        return true;
+    }
+    if (!matchWord(it_, end_, "false", 5)) {
+        fail();
+    }
+    return false;
+}
+
+std::string_view JsonReader::get_string()
+{
+    if (!atValue()) {
+        return std::string_view();
+    }
+    if (*it_ != '"') {
+        fail();
+        return std::string_view();
+    }
+    bool ok = true;
+    std::string_view s = parseString(it_, end_, scratch_, ok);
+    if (!ok) {
+        fail();
+        return std::string_view();
+    }
+    pending_ = false;
+    return s;
+}
+
+bool JsonReader::is_null()
+{
+    if (!atValue()) {
+        return false;
+    }
+    if (matchWord(it_, end_, "null", 4)) {
+        pending_ = false;
+        return true;
+    }
+    return false;
+}
+
+JsonValue JsonReader::get_value()
+{
+    if (!atValue()) {
+        return JsonValue();
+    }
+    const char* start = it_;
+    skip();
+    if (!ok_) {
+        return JsonValue();
+    }
+    JsonDomBuilder builder;
+    JsonParser parser(builder);
+    if (!parser.parse(std::string_view(start, it_ - start))) {
+        fail();
+        return JsonValue();
+    }
+    return std::move(builder.result());
+}
+
+void JsonReader::skip()
+{
+    if (!atValue()) {
+        return;
+    }
+    pending_ = false;
+    switch (*it_) {
+        case '"':
+            ++it_;
+            skipString();
+            break;
+        case '{':
+        case '[':
+            ++it_;
+            skipContainer(1);
+            break;
+        default:
+            // A number or literal runs up to the next delimiter
+            while (it_ != end_) {
+                char c = *it_;
+                if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                    break;
+                }
+                ++it_;
+            }
+            break;
+    }
+}
+
+void JsonReader::leave()
+{
+    if (!ok_ || stack_.empty()) {
+        fail();
+        return;
+    }
+    pending_ = false;
+    if (skipContainer(1)) {
+        stack_.pop_back();
+        first_ = false;
+    }
+}
+
+bool JsonReader::finish()
+{
+    if (!ok_ || pending_ || !stack_.empty()) {
+        return fail();
+    }
+    eatWs(it_, end_);
+    if (it_ != end_) {
+        return fail();
+    }
+    return true;
+}
+
+bool JsonReader::fail()
+{
+    ok_ = false;
+    pending_ = false;
+    return false;
+}
+
+// Checks that there is a value to consume and moves to its first character
+bool JsonReader::atValue()
+{
+    if (!ok_ || !pending_) {
+        return fail();
+    }
+    eatWs(it_, end_);
+    if (it_ == end_) {
+        return fail();
+    }
+    return true;
+}
+
+bool JsonReader::enter(char open)
+{
+    if (!atValue()) {
+        return false;
+    }
+    if (*it_ != open) {
+        return fail();
+    }
+    ++it_;
+    stack_.push_back(open);
+    pending_ = false;
+    first_ = true;
+    return true;
+}
+
+// Moves to the start of the next member of the innermost container, or
+// leaves the container and returns false if it ends here
+bool JsonReader::nextMember(char close)
+{
+    if (!ok_ || stack_.empty() || stack_.back() != (close == '}' ? '{' : '[')) {
+        return fail();
+    }
+    if (pending_) {
+        skip();
+        if (!ok_) {
+            return false;
+        }
+    }
+    eatWs(it_, end_);
+    if (it_ == end_) {
+        return fail();
+    }
+    if (*it_ == close) {
+        ++it_;
+        stack_.pop_back();
+        first_ = false;
+        return false;
+    }
+    if (!first_) {
+        if (*it_ != ',') {
+            return fail();
+        }
+        ++it_;
+        eatWs(it_, end_);
+        if (it_ == end_) {
+            return fail();
+        }
+    }
+    first_ = false;
+    return true;
+}
+
+// Moves past the closing quote of a string whose opening quote has been
+// read, without decoding it
+bool JsonReader::skipString()
+{
+    for (;;) {
+        it_ = skipPlain(it_, end_);
+        if (it_ == end_) {
+            return fail();
+        }
+        char c = *it_++;
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\' || it_ == end_) {
+            // Unescaped control character, or input ending in an escape
+            return fail();
+        }
+        ++it_;
+    }
+}
+
+// Moves past the end of the container 'depth' levels up from the current
+// position, keeping count of the brackets outside of strings
+bool JsonReader::skipContainer(int depth)
+{
+    while (it_ != end_) {
+        switch (*it_++) {
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) {
+                    return true;
+                }
+                break;
+            case '"':
+                if (!skipString()) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return fail();
+}
+
+JsonValue JsonReader::getNumber()
+{
+    if (!atValue()) {
+        return JsonValue();
+    }
+    pending_ = false;
+    bool ok = true;
+    JsonValue v = parseNumeric(it_, end_, ok);
+    if (!ok) {
+        fail();
+        return JsonValue();
+    }
+    return v;
+}
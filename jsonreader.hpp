@@ -0,0 +1,110 @@
+//
+//  jsonreader.hpp
+//  JsonLib
+//
+
+#ifndef jsonreader_hpp
+#define jsonreader_hpp
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "jsonvalue.hpp"
+
+// A forward-only cursor over a JSON text that parses values only when they
+// are asked for. The reader always stands at one value, initially the top-
+// level one, which the caller either reads with a get_ function, enters
+// with object() or array(), or passes over with skip(). Values passed over
+// are not parsed beyond finding where they end, and nothing is allocated.
+//
+//     JsonReader reader(body);
+//     std::string_view key;
+//     if (reader.object()) {
+//         while (reader.nextField(key)) {
+//             if (key == "id") {
+//                 id = reader.get_int64();
+//             }
+//         }
+//     }
+//     if (!reader.finish()) ...
+//
+// Nothing past the top-level value is looked at until finish() is called,
+// which checks that only whitespace follows it. The first error, whether a syntax error or a value of the wrong type, is
+// sticky: from then on every call fails and isValid() returns false.
+// Skipped values are only checked for balanced brackets and terminated
+// strings. The views returned by nextField() and get_string() are valid
+// until the next call on the reader, and the text must outlive the reader.
+class JsonReader
+{
+public:
+    explicit JsonReader(std::string_view json);
+    
+    bool isValid() const noexcept { return ok_; }
+    // How far into the text the reader has got, which after an error is
+    // near where it was found
+    size_t offset() const noexcept { return it_ - begin_; }
+    
+    // The type of the current value, without consuming it. A number is an
+    // Int unless it has a fraction or an exponent.
+    JsonValue::Type type();
+    
+    // Enter the current value, which must be an object or array
+    bool object();
+    bool array();
+    // Moves to the next member of the innermost object and sets 'key' to its
+    // name, skipping the previous member's value if it was not consumed.
+    // Returns false, having left the object, once there are no more members.
+    bool nextField(std::string_view& key);
+    // The same for the elements of the innermost array
+    bool nextElement();
+    // Moves forward through the innermost object to the member named 'key'.
+    // Members are only visited once, so to find several fields, ask for them
+    // in the order they appear. Returns false, having left the object, if
+    // no member further on has that name.
+    bool find_field(std::string_view key);
+    
+    // Consume the current value. A value of another type is an error;
+    // integers have to fit the requested type exactly.
+    std::int64_t get_int64();
+    std::uint64_t get_uint64();
+    double get_double();
+    bool get_bool();
+    std::string_view get_string();
+    // Consumes the current value if it is null, and returns whether it was
+    bool is_null();
+    // Parses the current value, however large, into a JsonValue
+    JsonValue get_value();
+    // Passes over the current value
+    void skip();
+    // Passes over the rest of the innermost container and leaves it. A
+    // container that was entered has to be read to its end, or left this
+    // way, before the reader can go on with the container around it.
+    void leave();
+    // Once the top-level value has been consumed, checks that nothing but
+    // whitespace follows it. Fails, like any other call, if anything else
+    // does or the value was not consumed; returns isValid() otherwise.
+    bool finish();
+
+private:
+    bool fail();
+    bool atValue();
+    bool enter(char open);
+    bool nextMember(char close);
+    bool skipString();
+    bool skipContainer(int depth);
+    JsonValue getNumber();
+    
+    const char* begin_;
+    const char* it_;
+    const char* end_;
+    // '[' or '{' for each container entered and not yet left
+    std::string stack_;
+    std::string scratch_;
+    // The reader stands at a value that has not been consumed
+    bool pending_ = true;
+    // Nothing has been read from the innermost container yet
+    bool first_ = false;
+    bool ok_ = true;
+};
+
+#endif /* jsonreader_hpp */
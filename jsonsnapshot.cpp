@@ -0,0 +1,574 @@
+//
+//  jsonsnapshot.cpp
+//  JsonLib
+//
+
+#include "jsonsnapshot.hpp"
+#include "jsonarray.hpp"
+#include "jsonobject.hpp"
+#include "jsonparser.hpp"
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// Layout, all offsets counting from the start of the header:
+//
+//   header    magic, version, byte order mark, size of the data, root node
+//   string    uint32 length, the text, '\0'
+//   int       int64 or uint64
+//   double    double
+//   array     uint64 count, count element nodes
+//   object    uint64 count, uint64 slots, count key nodes, count value
+//             nodes, slots uint32 table entries
+//
+// A node keeps its tag in the low 4 bits and its payload, an offset or a
+// small int, in the high 60. Records of 8 byte values start at offsets
+// that are multiples of 8 and strings at multiples of 4.
+
+static const char Magic[8] = { 'J', 'S', 'O', 'N', 'S', 'N', 'A', 'P' };
+static const std::uint32_t Version = 1;
+static const std::uint32_t ByteOrderMark = 0x01020304;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint64_t size;
+    std::uint64_t root;
+};
+
+enum SnapshotTag : std::uint64_t {
+    NullTag,
+    FalseTag,
+    TrueTag,
+    SmallIntTag,
+    IntTag,
+    UIntTag,
+    DoubleTag,
+    StringTag,
+    ArrayTag,
+    ObjectTag
+};
+
+static const int TagBits = 4;
+static const std::uint64_t TagMask = (1 << TagBits) - 1;
+// Ints that fit in the payload of a node
+static const std::int64_t SmallIntMin = -(std::int64_t(1) << 59);
+static const std::int64_t SmallIntMax = (std::int64_t(1) << 59) - 1;
+// Objects up to this size are searched linearly, as JsonObject does
+static const std::uint64_t LinearLimit = 16;
+
+static std::uint64_t makeNode(SnapshotTag tag, std::uint64_t payload)
+{
+    return (payload << TagBits) | tag;
+}
+
+template <class T>
+static T load(const char* p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// FNV-1a. Unlike std::hash, it gives the same table in every build that
+// reads the snapshot.
+static std::uint64_t hashKey(std::string_view key)
+{
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static std::uint64_t tableSlots(std::uint64_t count)
+{
+    if (count <= LinearLimit) {
+        return 0;
+    }
+    // At most half full
+    std::uint64_t slots = 64;
+    while (slots < count * 2) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+
+
+// -------------------------------
+// Writing
+// -------------------------------
+
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::string& out) : out_(out), base_(out.size()) {}
+    
+    bool write(const JsonValue& root);
+
+private:
+    // An array or object whose record is written but not all its elements
+    struct Frame {
+        const JsonValue* container;
+        std::uint64_t offset;
+        std::uint64_t count;
+        std::uint64_t slots;
+        std::uint64_t next = 0;
+    };
+    
+    std::uint64_t value(const JsonValue& root);
+    std::uint64_t node(const JsonValue& v);
+    std::uint64_t string(std::string_view s);
+    std::uint64_t key(std::string_view s);
+    // Pads the data to a multiple of 'alignment' and reserves 'bytes' of
+    // zeros, returning their offset
+    std::uint64_t reserve(size_t alignment, size_t bytes);
+    template <class T>
+    void store(std::uint64_t offset, T v) { std::memcpy(&out_[base_ + offset], &v, sizeof(v)); }
+    
+    std::string& out_;
+    size_t base_;
+    // The string node of every key written so far. The keys point into the
+    // tree being written.
+    std::unordered_map<std::string_view, std::uint64_t> keys_;
+    // The open arrays and objects, outermost first
+    std::vector<Frame> frames_;
+    bool ok_ = true;
+};
+
+bool SnapshotWriter::write(const JsonValue& root)
+{
+    reserve(8, sizeof(SnapshotHeader));
+    std::uint64_t node = value(root);
+    if (!ok_) {
+        out_.resize(base_);
+        return false;
+    }
+    
+    SnapshotHeader header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.size = out_.size() - base_;
+    header.root = node;
+    store(0, header);
+    return true;
+}
+
+std::uint64_t SnapshotWriter::reserve(size_t alignment, size_t bytes)
+{
+    size_t offset = out_.size() - base_;
+    offset += (alignment - offset % alignment) % alignment;
+    out_.resize(base_ + offset + bytes);
+    return offset;
+}
+
+// Writes 'root' and everything under it, depth first. The elements of the
+// open arrays and objects are kept track of on a stack of their own rather
+// than by recursing, so that no depth of nesting can run out of stack.
+std::uint64_t SnapshotWriter::value(const JsonValue& root)
+{
+    std::uint64_t rootNode = node(root);
+    while (!frames_.empty() && ok_) {
+        Frame& frame = frames_.back();
+        if (frame.next == frame.count) {
+            frames_.pop_back();
+            continue;
+        }
+        // The frame is copied out, as writing the element may push another
+        std::uint64_t i = frame.next++;
+        std::uint64_t offset = frame.offset;
+        if (frame.container->type() == JsonValue::Array) {
+            std::uint64_t element = node(frame.container->to_array()[i]);
+            store(offset + 8 + 8 * i, element);
+            continue;
+        }
+        
+        std::uint64_t count = frame.count;
+        std::uint64_t slots = frame.slots;
+        const auto& pr = frame.container->to_object().begin()[i];
+        std::uint64_t keyNode = key(pr.first);
+        store(offset + 16 + 8 * i, keyNode);
+        if (slots != 0) {
+            std::uint64_t table = offset + 16 + 16 * count;
+            std::uint64_t slot = hashKey(pr.first) & (slots - 1);
+            while (load<std::uint32_t>(&out_[base_ + table + 4 * slot]) != 0) {
+                slot = (slot + 1) & (slots - 1);
+            }
+            store(table + 4 * slot, static_cast<std::uint32_t>(i + 1));
+        }
+        std::uint64_t valueNode = node(pr.second);
+        store(offset + 16 + 8 * count + 8 * i, valueNode);
+    }
+    return rootNode;
+}
+
+// Writes a scalar or string, or the record of an array or object with its
+// elements left to value()
+std::uint64_t SnapshotWriter::node(const JsonValue& v)
+{
+    switch (v.type()) {
+        case JsonValue::Bool:
+            return v.to_bool() ? TrueTag : FalseTag;
+        case JsonValue::Int: {
+            if (v.is_uint64()) {
+                std::uint64_t offset = reserve(8, 8);
+                store(offset, v.to_uint());
+                return makeNode(UIntTag, offset);
+            }
+            std::int64_t i = v.to_int();
+            if (i >= SmallIntMin && i <= SmallIntMax) {
+                return makeNode(SmallIntTag, static_cast<std::uint64_t>(i));
+            }
+            std::uint64_t offset = reserve(8, 8);
+            store(offset, i);
+            return makeNode(IntTag, offset);
+        }
+        case JsonValue::Double: {
+            std::uint64_t offset = reserve(8, 8);
+            store(offset, v.to_double());
+            return makeNode(DoubleTag, offset);
+        }
+        case JsonValue::String:
+            return string(v.to_string_view());
+        case JsonValue::Array: {
+            std::uint64_t count = v.to_array().size();
+            std::uint64_t offset = reserve(8, 8 + 8 * count);
+            store(offset, count);
+            frames_.push_back({ &v, offset, count, 0 });
+            return makeNode(ArrayTag, offset);
+        }
+        case JsonValue::Object: {
+            std::uint64_t count = v.to_object().size();
+            if (count >= std::numeric_limits<std::uint32_t>::max()) {
+                ok_ = false;
+                return NullTag;
+            }
+            std::uint64_t slots = tableSlots(count);
+            std::uint64_t offset = reserve(8, 16 + 16 * count + 4 * slots);
+            store(offset, count);
+            store(offset + 8, slots);
+            frames_.push_back({ &v, offset, count, slots });
+            return makeNode(ObjectTag, offset);
+        }
+        default:
+            return NullTag;
+    }
+}
+
+std::uint64_t SnapshotWriter::string(std::string_view s)
+{
+    if (s.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        ok_ = false;
+        return NullTag;
+    }
+    std::uint64_t offset = reserve(4, 4 + s.size() + 1);
+    store(offset, static_cast<std::uint32_t>(s.size()));
+    std::memcpy(&out_[base_ + offset + 4], s.data(), s.size());
+    return makeNode(StringTag, offset);
+}
+
+std::uint64_t SnapshotWriter::key(std::string_view s)
+{
+    auto it = keys_.find(s);
+    if (it != keys_.end()) {
+        return it->second;
+    }
+    std::uint64_t node = string(s);
+    keys_.emplace(s, node);
+    return node;
+}
+
+bool JsonSnapshot::write(const JsonValue& root, std::string& out)
+{
+    SnapshotWriter writer(out);
+    return writer.write(root);
+}
+
+bool JsonSnapshot::writeFile(const JsonValue& root, const std::string& path)
+{
+    std::string data;
+    if (!write(root, data)) {
+        return false;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+    file.close();
+    return !file.fail();
+}
+
+
+
+// -------------------------------
+// Reading
+// -------------------------------
+
+bool JsonSnapshot::open(const std::string& path)
+{
+    close();
+    if (!file_.open(path, JsonMappedFile::Random)) {
+        return false;
+    }
+    if (!openData(file_.data())) {
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+bool JsonSnapshot::openData(std::string_view data)
+{
+    root_ = JsonSnapshotValue();
+    if (data.size() < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    SnapshotHeader header = load<SnapshotHeader>(data.data());
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version ||
+        header.byteOrder != ByteOrderMark ||
+        header.size > data.size()) {
+        return false;
+    }
+    root_ = JsonSnapshotValue(data.data(), header.size, header.root);
+    return true;
+}
+
+void JsonSnapshot::close() noexcept
+{
+    root_ = JsonSnapshotValue();
+    file_.close();
+}
+
+JsonValue::Type JsonSnapshotValue::type() const noexcept
+{
+    switch (node_ & TagMask) {
+        case FalseTag:
+        case TrueTag:
+            return JsonValue::Bool;
+        case SmallIntTag:
+        case IntTag:
+        case UIntTag:
+            return JsonValue::Int;
+        case DoubleTag:
+            return JsonValue::Double;
+        case StringTag:
+            return JsonValue::String;
+        case ArrayTag:
+            return JsonValue::Array;
+        case ObjectTag:
+            return JsonValue::Object;
+        default:
+            return JsonValue::Null;
+    }
+}
+
+bool JsonSnapshotValue::is_uint64() const noexcept
+{
+    return (node_ & TagMask) == UIntTag;
+}
+
+JsonValue JsonSnapshotValue::scalar() const noexcept
+{
+    std::uint64_t offset = node_ >> TagBits;
+    bool fits = offset <= size_ && size_ - offset >= 8;
+    switch (node_ & TagMask) {
+        case FalseTag:
+            return JsonValue(false);
+        case TrueTag:
+            return JsonValue(true);
+        case SmallIntTag:
+            // Arithmetic shift, bringing back the sign
+            return JsonValue(static_cast<long long>(static_cast<std::int64_t>(node_) >> TagBits));
+        case IntTag:
+            return fits ? JsonValue(static_cast<long long>(load<std::int64_t>(base_ + offset))) : JsonValue();
+        case UIntTag:
+            return fits ? JsonValue(static_cast<unsigned long long>(load<std::uint64_t>(base_ + offset))) : JsonValue();
+        case DoubleTag:
+            return fits ? JsonValue(load<double>(base_ + offset)) : JsonValue();
+        default:
+            return JsonValue();
+    }
+}
+
+std::string_view JsonSnapshotValue::string(std::uint64_t node) const noexcept
+{
+    std::uint64_t offset = node >> TagBits;
+    if ((node & TagMask) != StringTag || offset > size_ || size_ - offset < 4) {
+        return std::string_view();
+    }
+    std::uint64_t length = load<std::uint32_t>(base_ + offset);
+    if (size_ - offset - 4 < length) {
+        return std::string_view();
+    }
+    return std::string_view(base_ + offset + 4, length);
+}
+
+std::string_view JsonSnapshotValue::to_string_view() const noexcept
+{
+    return string(node_);
+}
+
+std::uint64_t JsonSnapshotValue::count() const noexcept
+{
+    std::uint64_t tag = node_ & TagMask;
+    std::uint64_t offset = node_ >> TagBits;
+    if ((tag != ArrayTag && tag != ObjectTag) || offset > size_) {
+        return 0;
+    }
+    std::uint64_t left = size_ - offset;
+    if (tag == ArrayTag) {
+        if (left < 8) {
+            return 0;
+        }
+        std::uint64_t count = load<std::uint64_t>(base_ + offset);
+        return (count <= (left - 8) / 8) ? count : 0;
+    }
+    
+    if (left < 16) {
+        return 0;
+    }
+    std::uint64_t count = load<std::uint64_t>(base_ + offset);
+    std::uint64_t slots = load<std::uint64_t>(base_ + offset + 8);
+    left -= 16;
+    if (count > left / 16 || slots > (left - 16 * count) / 4 || (slots & (slots - 1)) != 0) {
+        return 0;
+    }
+    return count;
+}
+
+size_t JsonSnapshotValue::size() const noexcept
+{
+    return static_cast<size_t>(count());
+}
+
+// The node at 'offset' in this array or object record. Arrays and objects
+// are written after their parent, so one that is not must be damaged, and
+// could lead back to the parent.
+JsonSnapshotValue JsonSnapshotValue::node(std::uint64_t offset) const noexcept
+{
+    std::uint64_t node = load<std::uint64_t>(base_ + offset);
+    std::uint64_t tag = node & TagMask;
+    if ((tag == ArrayTag || tag == ObjectTag) && (node >> TagBits) <= (node_ >> TagBits)) {
+        return JsonSnapshotValue();
+    }
+    return JsonSnapshotValue(base_, size_, node);
+}
+
+JsonSnapshotValue JsonSnapshotValue::operator[](size_t pos) const noexcept
+{
+    std::uint64_t n = count();
+    if (pos >= n) {
+        return JsonSnapshotValue();
+    }
+    std::uint64_t offset = node_ >> TagBits;
+    if ((node_ & TagMask) == ArrayTag) {
+        return node(offset + 8 + 8 * pos);
+    }
+    return node(offset + 16 + 8 * n + 8 * pos);
+}
+
+std::string_view JsonSnapshotValue::key(size_t pos) const noexcept
+{
+    std::uint64_t n = count();
+    if ((node_ & TagMask) != ObjectTag || pos >= n) {
+        return std::string_view();
+    }
+    return string(load<std::uint64_t>(base_ + (node_ >> TagBits) + 16 + 8 * pos));
+}
+
+size_t JsonSnapshotValue::indexOf(std::string_view key) const noexcept
+{
+    std::uint64_t n = count();
+    // count() has only checked the record when it is not empty
+    if ((node_ & TagMask) != ObjectTag || n == 0) {
+        return static_cast<size_t>(n);
+    }
+    std::uint64_t offset = node_ >> TagBits;
+    std::uint64_t slots = load<std::uint64_t>(base_ + offset + 8);
+    if (slots == 0) {
+        for (std::uint64_t i = 0; i < n; ++i) {
+            if (this->key(i) == key) {
+                return static_cast<size_t>(i);
+            }
+        }
+        return static_cast<size_t>(n);
+    }
+    
+    const char* table = base_ + offset + 16 + 16 * n;
+    std::uint64_t mask = slots - 1;
+    // Bounded by the table size in case the table is damaged
+    for (std::uint64_t slot = hashKey(key) & mask, probes = 0; probes < slots; slot = (slot + 1) & mask, ++probes) {
+        std::uint32_t entry = load<std::uint32_t>(table + 4 * slot);
+        if (entry == 0 || entry > n) {
+            break;
+        }
+        if (this->key(entry - 1) == key) {
+            return entry - 1;
+        }
+    }
+    return static_cast<size_t>(n);
+}
+
+// Reports the values to a JsonDomBuilder, keeping the open arrays and
+// objects on a stack of their own rather than recursing, as a damaged or
+// deeply nested snapshot could otherwise run out of stack
+JsonValue JsonSnapshotValue::to_value(const JsonValue::allocator_type& alloc) const
+{
+    struct Frame {
+        JsonSnapshotValue container;
+        size_t size;
+        size_t next;
+    };
+    std::vector<Frame> frames;
+    JsonDomBuilder builder(alloc.resource());
+    JsonSnapshotValue v = *this;
+    for (;;) {
+        switch (v.type()) {
+            case JsonValue::Null:
+                builder.onNull();
+                break;
+            case JsonValue::Bool:
+                builder.onBool(v.to_bool());
+                break;
+            case JsonValue::String:
+                builder.onString(v.to_string_view());
+                break;
+            case JsonValue::Array:
+                builder.onStartArray();
+                frames.push_back({ v, v.size(), 0 });
+                break;
+            case JsonValue::Object:
+                builder.onStartObject();
+                frames.push_back({ v, v.size(), 0 });
+                break;
+            default:
+                builder.onNumber(v.scalar());
+                break;
+        }
+        
+        // Close the containers that are complete, and go on with the next
+        // element of the innermost open one
+        while (!frames.empty() && frames.back().next == frames.back().size) {
+            if (frames.back().container.type() == JsonValue::Object) {
+                builder.onEndObject();
+            }
+            else {
+                builder.onEndArray();
+            }
+            frames.pop_back();
+        }
+        if (frames.empty()) {
+            return std::move(builder.result());
+        }
+        Frame& frame = frames.back();
+        if (frame.container.type() == JsonValue::Object) {
+            builder.onKey(frame.container.key(frame.next));
+        }
+        v = frame.container[frame.next++];
+    }
+}
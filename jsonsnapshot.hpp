@@ -0,0 +1,135 @@
+//
+//  jsonsnapshot.hpp
+//  JsonLib
+//
+
+#ifndef jsonsnapshot_hpp
+#define jsonsnapshot_hpp
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include "jsonmappedfile.hpp"
+#include "jsonvalue.hpp"
+
+// A read-only view of one value in a JsonSnapshot. It is 24 bytes and is
+// passed around by value; it is valid for as long as the snapshot stays
+// open. The accessors match those of JsonValue, and each takes constant
+// time except a lookup by key in an object of more than 16 members, which
+// probes a hash table stored with it.
+//
+// Any value of the wrong type, or reached through an index or key that is
+// out of range, reads as null. So does any part of a snapshot that turns
+// out to be damaged: every read is checked against the size of the data.
+class JsonSnapshotValue
+{
+public:
+    // Null
+    JsonSnapshotValue() = default;
+    
+    JsonValue::Type type() const noexcept;
+    bool is_uint64() const noexcept;
+    
+    // Scalars convert as JsonValue's accessors do
+    bool to_bool() const noexcept { return scalar().to_bool(); }
+    std::int64_t to_int() const noexcept { return scalar().to_int(); }
+    std::uint64_t to_uint() const noexcept { return scalar().to_uint(); }
+    double to_double() const noexcept { return scalar().to_double(); }
+    // Points into the snapshot. The text is followed by a '\0'.
+    std::string_view to_string_view() const noexcept;
+    
+    // The number of elements of an array or members of an object
+    size_t size() const noexcept;
+    // Element 'pos' of an array, or the value of member 'pos' of an object
+    // in document order
+    JsonSnapshotValue operator[](size_t pos) const noexcept;
+    // The key of member 'pos' of an object
+    std::string_view key(size_t pos) const noexcept;
+    
+    // The position of the member called 'key' in an object, or size() if
+    // there is none
+    size_t indexOf(std::string_view key) const noexcept;
+    bool contains(std::string_view key) const noexcept { return indexOf(key) != size(); }
+    JsonSnapshotValue operator[](std::string_view key) const noexcept { return (*this)[indexOf(key)]; }
+    
+    // Copies the value, and everything under it however deeply nested,
+    // into a JsonValue
+    JsonValue to_value(const JsonValue::allocator_type& alloc = {}) const;
+
+private:
+    friend class JsonSnapshot;
+    
+    JsonSnapshotValue(const char* base, std::uint64_t size, std::uint64_t node) noexcept :
+        base_(base),
+        size_(size),
+        node_(node)
+    {}
+    
+    JsonValue scalar() const noexcept;
+    // The count at the start of an array or object record, or 0 if the
+    // node is neither or the record does not fit in the data
+    std::uint64_t count() const noexcept;
+    JsonSnapshotValue node(std::uint64_t offset) const noexcept;
+    std::string_view string(std::uint64_t node) const noexcept;
+    
+    const char* base_ = nullptr;
+    std::uint64_t size_ = 0;
+    std::uint64_t node_ = 0;
+};
+
+// A JSON tree serialized so that it can be used where it lies, without
+// parsing or even reading it all: opening a snapshot file maps it into
+// memory, and only the pages that are looked at are ever read from disk.
+// A snapshot is written once from a JsonValue, such as the root of a parsed
+// JsonDocument, and opened any number of times after that.
+//
+//     JsonSnapshot::writeFile(doc.to_value(), "config.snap");
+//     ...
+//     JsonSnapshot snap;
+//     snap.open("config.snap");
+//     int port = snap.root()["server"]["port"].to_int();
+//
+// The data is a header followed by a tape of records. Every value is a 64
+// bit node: a type tag, and either the value itself, for null, booleans
+// and ints of up to 60 bits, or the offset of its record. An array record
+// holds the nodes of its elements and an object record the nodes of its
+// keys and values, so either is indexed in constant time. Objects of more
+// than 16 members also carry an open-addressing table of their members by
+// key hash. Keys are stored once however many objects use them.
+//
+// Numbers are stored in the byte order of the machine that wrote them, and
+// a snapshot will not open on a machine of the other byte order.
+class JsonSnapshot
+{
+public:
+    JsonSnapshot() = default;
+    
+    JsonSnapshot(const JsonSnapshot&) = delete;
+    JsonSnapshot& operator=(const JsonSnapshot&) = delete;
+    
+    // Appends the snapshot of 'root' to 'out'. Returns false, leaving 'out'
+    // as it was, if a string is 4 GB or more or an object has 2^32 or more
+    // members.
+    static bool write(const JsonValue& root, std::string& out);
+    static bool writeFile(const JsonValue& root, const std::string& path);
+    
+    // Maps the snapshot file at 'path', replacing any snapshot opened
+    // before. Returns false if it cannot be opened or its header is not
+    // that of a snapshot this build can read.
+    bool open(const std::string& path);
+    // Opens the snapshot in 'data', which must remain valid until the
+    // snapshot is closed or reopened
+    bool openData(std::string_view data);
+    void close() noexcept;
+    
+    bool isOpen() const noexcept { return root_.base_ != nullptr; }
+    // The root value, null if no snapshot is open
+    JsonSnapshotValue root() const noexcept { return root_; }
+
+private:
+    JsonMappedFile file_;
+    JsonSnapshotValue root_;
+};
+
+#endif /* jsonsnapshot_hpp */
@@ -0,0 +1,90 @@
+//
+//  jsonstats.cpp
+//  JsonLib
+//
+
+#include "jsonstats.hpp"
+#include <algorithm>
+#include <chrono>
+
+std::uint64_t JsonStats::nodeCount() const noexcept
+{
+    std::uint64_t total = 0;
+    for (std::uint64_t n : nodes) {
+        total += n;
+    }
+    return total;
+}
+
+void JsonStats::merge(const JsonStats& other) noexcept
+{
+    bytesParsed += other.bytesParsed;
+    parseNs += other.parseNs;
+    for (size_t i = 0; i <= JsonValue::Object; ++i) {
+        nodes[i] += other.nodes[i];
+    }
+    maxDepth = std::max(maxDepth, other.maxDepth);
+    longestString = std::max(longestString, other.longestString);
+    allocations += other.allocations;
+    allocatedBytes += other.allocatedBytes;
+    numberNs += other.numberNs;
+    stringNs += other.stringNs;
+    bytesWritten += other.bytesWritten;
+    writeNs += other.writeNs;
+}
+
+// The stats this thread's allocations are counted into
+static thread_local JsonStats* currentStats = nullptr;
+
+// Forwards to new_delete_resource(), counting allocations on the way. The
+// comparison is one-sided: this resource says it is equal to
+// new_delete_resource(), but new_delete_resource() only says so of itself.
+// JsonValue asks the resource a value is on, so a tree built here is shared
+// or moved into containers on new_delete_resource(), which is what matters
+// for parsed documents, while values going the other way are copied. Memory
+// is freed correctly either way, since both end up in operator delete.
+class CountingResource : public std::pmr::memory_resource
+{
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        JsonStatsCollector::countAllocation(bytes);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other || other == *std::pmr::new_delete_resource();
+    }
+};
+
+JsonStats* JsonStatsCollector::exchangeCurrent(JsonStats* stats) noexcept
+{
+    JsonStats* previous = currentStats;
+    currentStats = stats;
+    return previous;
+}
+
+std::pmr::memory_resource* JsonStatsCollector::counted(std::pmr::memory_resource* resource) noexcept
+{
+    // Never destroyed, since trees built on it may outlive everything else
+    static CountingResource* counting = new CountingResource();
+    return resource == std::pmr::new_delete_resource() ? counting : resource;
+}
+
+void JsonStatsCollector::countAllocation(size_t bytes) noexcept
+{
+    if (currentStats) {
+        ++currentStats->allocations;
+        currentStats->allocatedBytes += bytes;
+    }
+}
+
+std::uint64_t JsonStatsCollector::now() noexcept
+{
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
@@ -0,0 +1,112 @@
+//
+//  jsonstats.hpp
+//  JsonLib
+//
+
+#ifndef jsonstats_hpp
+#define jsonstats_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include "jsonvalue.hpp"
+
+// Counters filled in while a JsonDocument is parsed or written, for seeing
+// where the time and memory of a slow parse went. They are only collected
+// when the library is built with JSONLIB_STATS defined, and then only by
+// calls that are passed a JsonStats. Otherwise the same calls compile, the
+// JsonStats is left alone, and parsing is exactly as fast as without it.
+//
+//     JsonStats stats;
+//     JsonDocument doc = JsonDocument::from_json(text, JsonDocument::NoFlags, &stats);
+//     metrics.record("json.parse_ns", stats.parseNs);
+//
+// The counts add up over every call the same JsonStats is passed to.
+struct JsonStats
+{
+#ifdef JSONLIB_STATS
+    static constexpr bool Enabled = true;
+#else
+    static constexpr bool Enabled = false;
+#endif
+
+    // Parsing
+    std::uint64_t bytesParsed = 0;
+    std::uint64_t parseNs = 0;
+    // Values parsed, by JsonValue::Type
+    std::uint64_t nodes[JsonValue::Object + 1] = {};
+    // The deepest nesting of arrays and objects, the outermost being 1
+    std::uint64_t maxDepth = 0;
+    // The longest string or key, once unescaped
+    std::uint64_t longestString = 0;
+    // Allocations made for the tree, and their total size. With UseArena
+    // they are carved out of the arena rather than made on the heap. On
+    // the default resource they are only counted while that is still
+    // std::pmr::new_delete_resource().
+    std::uint64_t allocations = 0;
+    std::uint64_t allocatedBytes = 0;
+    // Time spent decoding numbers and strings, keys included, summed over
+    // the threads of a Parallel parse. The clock is read around every one,
+    // which adds noticeably to parseNs.
+    std::uint64_t numberNs = 0;
+    std::uint64_t stringNs = 0;
+
+    // Writing
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t writeNs = 0;
+
+    std::uint64_t nodeCount() const noexcept;
+    // Adds the counts of 'other', keeping the larger of each maximum
+    void merge(const JsonStats& other) noexcept;
+    void reset() noexcept { *this = JsonStats(); }
+};
+
+// How the library fills in a JsonStats; not meant for use elsewhere.
+// Everything it does is behind a test of JsonStats::Enabled, so without
+// JSONLIB_STATS the compiler drops it.
+class JsonStatsCollector
+{
+public:
+    // Until destroyed, counts the allocations this thread makes for trees
+    // into 'stats', if not null, and adds the time taken to its 'elapsed'
+    explicit JsonStatsCollector(JsonStats* stats, std::uint64_t JsonStats::* elapsed = nullptr) noexcept :
+        stats_(JsonStats::Enabled ? stats : nullptr),
+        elapsed_(elapsed)
+    {
+        if (stats_) {
+            previous_ = exchangeCurrent(stats_);
+            start_ = now();
+        }
+    }
+    ~JsonStatsCollector()
+    {
+        if (JsonStats::Enabled && stats_) {
+            if (elapsed_) {
+                stats_->*elapsed_ += now() - start_;
+            }
+            exchangeCurrent(previous_);
+        }
+    }
+    
+    JsonStatsCollector(const JsonStatsCollector&) = delete;
+    JsonStatsCollector& operator=(const JsonStatsCollector&) = delete;
+    
+    // The resource to build a tree on in place of 'resource' so that its
+    // allocations are counted. A JsonArena counts its own, and is returned
+    // as it is.
+    static std::pmr::memory_resource* counted(std::pmr::memory_resource* resource) noexcept;
+    static void countAllocation(size_t bytes) noexcept;
+    // Nanoseconds on a steady clock
+    static std::uint64_t now() noexcept;
+
+private:
+    // Sets the stats this thread's allocations are counted into
+    static JsonStats* exchangeCurrent(JsonStats* stats) noexcept;
+    
+    JsonStats* stats_;
+    std::uint64_t JsonStats::* elapsed_;
+    JsonStats* previous_ = nullptr;
+    std::uint64_t start_ = 0;
+};
+
+#endif /* jsonstats_hpp */
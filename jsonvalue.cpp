@@ -9,8 +9,110 @@
 #include "jsonarray.hpp"
 #include "jsonobject.hpp"
 #include "jsonvalue.hpp"
-#include <iomanip>
+#include "jsonwriter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
 #include <limits>
+#include <vector>
+
+static_assert(sizeof(void*) != 8 || sizeof(JsonValue) == 16, "JsonValue should stay two words wide");
+
+// Out-of-line payloads are placed on a memory resource and remember it
+// themselves (through their allocator), so no resource pointer needs to
+// be stored in the JsonValue.
+template <class T, class... Args>
+T* newNode(std::pmr::memory_resource* r, Args&&... args)
+{
+    void* p = r->allocate(sizeof(T), alignof(T));
+    try {
+        return new (p) T(std::forward<Args>(args)...);
+    }
+    catch (...) {
+        r->deallocate(p, sizeof(T), alignof(T));
+        throw;
+    }
+}
+
+template <class T>
+void deleteNode(T* node, std::pmr::memory_resource* r) noexcept
+{
+    node->~T();
+    r->deallocate(node, sizeof(T), alignof(T));
+}
+
+// What a node knows of borrowed strings below it, in increasing order of
+// precedence when the elements of a container are taken together
+enum Borrows : std::uint8_t {
+    NotBorrowed,
+    // The container was handed out for changing, so it is worked out
+    // again from the elements when next asked
+    MaybeBorrowed,
+    Borrowed
+};
+
+// The count is atomic, so values sharing a node may be copied and dropped
+// on different threads. A node that holds a borrowed string anywhere below
+// it is never shared: copying it copies its elements, so that the copy
+// owns its text.
+template <class T>
+struct JsonValue::Node
+{
+    template <class... Args>
+    explicit Node(std::uint8_t borrows, Args&&... args) :
+        borrows(borrows),
+        value(std::forward<Args>(args)...)
+    {}
+    
+    std::atomic<size_t> refs{1};
+    // The hash of 'value', or 0 until it is first asked for
+    mutable std::atomic<size_t> hash{0};
+    // A Borrows, kept like the hash by whoever asks first
+    mutable std::atomic<std::uint8_t> borrows;
+    T value;
+};
+
+template <class T>
+void releaseNode(T* node) noexcept
+{
+    // The last reference needs no atomic decrement, and that is the common
+    // case of a tree being dropped that was never copied
+    if (node->refs.load(std::memory_order_acquire) == 1 ||
+        node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        deleteNode(node, node->value.resource());
+    }
+}
+
+// Takes another reference to 'node' if it can be shared with a value on
+// 'r', and otherwise makes a copy of it there
+template <class T>
+T* copyNode(T* node, std::pmr::memory_resource* r, bool borrows)
+{
+    if (!borrows && *node->value.resource() == *r) {
+        node->refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+    T* copy = newNode<T>(r, NotBorrowed, node->value, r);
+    copy->hash.store(node->hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return copy;
+}
+
+// Leaves 'node' referred to by the caller alone, copying it if need be
+template <class T>
+void unshareNode(T*& node)
+{
+    if (node->refs.load(std::memory_order_acquire) != 1) {
+        std::pmr::memory_resource* r = node->value.resource();
+        T* copy = newNode<T>(r, NotBorrowed, node->value, r);
+        releaseNode(node);
+        node = copy;
+    }
+    // Whatever the caller puts in may be borrowed, and changes the hash
+    node->borrows.store(MaybeBorrowed, std::memory_order_relaxed);
+    node->hash.store(0, std::memory_order_relaxed);
+}
 
 JsonValue::JsonValue(bool b) :
     bool_val_(b),
@@ -18,151 +120,665 @@ JsonValue::JsonValue(bool b) :
 {}
 
 JsonValue::JsonValue(int v) :
-    double_val_(v),
+    int_val_(v),
+    type_(Int)
+{}
+
+JsonValue::JsonValue(long v) :
+    int_val_(v),
+    type_(Int)
+{}
+
+JsonValue::JsonValue(long long v) :
+    int_val_(v),
     type_(Int)
 {}
 
+JsonValue::JsonValue(unsigned int v) :
+    int_val_(v),
+    type_(Int)
+{}
+
+JsonValue::JsonValue(unsigned long v) :
+    JsonValue(static_cast<unsigned long long>(v))
+{}
+
+JsonValue::JsonValue(unsigned long long v) :
+    int_val_(static_cast<std::int64_t>(v)),
+    type_(Int),
+    flags_(v > static_cast<unsigned long long>(std::numeric_limits<std::int64_t>::max()) ? UnsignedInt : 0)
+{}
+
 JsonValue::JsonValue(double v) :
     double_val_(v),
     type_(Double)
 {}
 
 JsonValue::JsonValue(const char* s) :
-    string_val_(s),
-    type_(String)
+    JsonValue(std::string_view(s), allocator_type())
 {}
 
 JsonValue::JsonValue(const std::string& s) :
-    string_val_(s),
-    type_(String)
+    JsonValue(std::string_view(s), allocator_type())
 {}
 
 JsonValue::JsonValue(std::string&& s) :
-    string_val_(s),
-    type_(String)
+    JsonValue(std::string_view(s), allocator_type())
 {}
 
 JsonValue::JsonValue(const JsonArray& a) :
-    array_ptr_(std::make_unique<JsonArray>(a)),
-    type_(Array)
+    JsonValue(a, allocator_type())
 {}
 
 JsonValue::JsonValue(JsonArray&& a) :
-    array_ptr_(std::make_unique<JsonArray>(std::move(a))),
-    type_(Array)
+    JsonValue(std::move(a), allocator_type(a.resource()))
 {}
 
 JsonValue::JsonValue(const JsonObject& o) :
-    object_ptr_(std::make_unique<JsonObject>(o)),
-    type_(Object)
+    JsonValue(o, allocator_type())
 {}
 
 JsonValue::JsonValue(JsonObject&& o) :
-    object_ptr_(std::make_unique<JsonObject>(std::move(o))),
+    JsonValue(std::move(o), allocator_type(o.resource()))
+{}
+
+JsonValue::JsonValue(std::string_view s, const allocator_type& alloc) :
+    string_ptr_(newNode<std::pmr::string>(alloc.resource(), s, alloc.resource())),
+    type_(String)
+{}
+
+JsonValue::JsonValue(const char* s, const allocator_type& alloc) :
+    JsonValue(std::string_view(s), alloc)
+{}
+
+JsonValue::JsonValue(const std::string& s, const allocator_type& alloc) :
+    JsonValue(std::string_view(s), alloc)
+{}
+
+JsonValue::JsonValue(const JsonArray& a, const allocator_type& alloc) :
+    array_ptr_(newNode<Node<JsonArray>>(alloc.resource(), NotBorrowed, a, alloc.resource())),
+    type_(Array)
+{}
+
+JsonValue::JsonValue(JsonArray&& a, const allocator_type& alloc) :
+    array_ptr_(newNode<Node<JsonArray>>(alloc.resource(), elementsBorrow(a), std::move(a), alloc.resource())),
+    type_(Array)
+{}
+
+JsonValue::JsonValue(const JsonObject& o, const allocator_type& alloc) :
+    object_ptr_(newNode<Node<JsonObject>>(alloc.resource(), NotBorrowed, o, alloc.resource())),
+    type_(Object)
+{}
+
+JsonValue::JsonValue(JsonObject&& o, const allocator_type& alloc) :
+    object_ptr_(newNode<Node<JsonObject>>(alloc.resource(), elementsBorrow(o), std::move(o), alloc.resource())),
     type_(Object)
 {}
 
 JsonValue::JsonValue(const JsonValue& other) :
-    double_val_(other.double_val_),
-    string_val_(other.string_val_),
-    bool_val_(other.bool_val_),
-    type_(other.type_)
+    JsonValue(other, allocator_type())
+{}
+
+JsonValue::JsonValue(JsonValue&& other) noexcept :
+    int_val_(other.int_val_),
+    type_(other.type_),
+    flags_(other.flags_),
+    borrowed_size_(other.borrowed_size_)
+{
+    other.type_ = Null;
+    other.flags_ = 0;
+}
+
+JsonValue::JsonValue(const JsonValue& other, const allocator_type& alloc) :
+    int_val_(other.int_val_),
+    type_(other.type_),
+    flags_(other.flags_)
 {
-    if (other.array_ptr_) {
-        array_ptr_ = std::make_unique<JsonArray>(*other.array_ptr_);
+    std::pmr::memory_resource* r = alloc.resource();
+    switch (type_) {
+        case String:
+            // A copy owns its text, even when the original borrows it
+            string_ptr_ = newNode<std::pmr::string>(r, other.to_string_view(), r);
+            flags_ = 0;
+            break;
+        case Array:
+            array_ptr_ = copyNode(other.array_ptr_, r, other.borrowsText());
+            break;
+        case Object:
+            object_ptr_ = copyNode(other.object_ptr_, r, other.borrowsText());
+            break;
+        default:
+            // Scalars were copied along with the payload bits
+            break;
+    }
+}
+
+JsonValue::JsonValue(JsonValue&& other, const allocator_type& alloc) :
+    JsonValue()
+{
+    std::pmr::memory_resource* r = other.resource();
+    if (r == nullptr || *r == *alloc.resource()) {
+        // Scalar, borrowed string, or already on the right resource: just take it
+        *this = std::move(other);
     }
-    if (other.object_ptr_) {
-        object_ptr_ = std::make_unique<JsonObject>(*other.object_ptr_);
+    else {
+        *this = JsonValue(static_cast<const JsonValue&>(other), alloc);
     }
 }
 
 JsonValue& JsonValue::operator=(const JsonValue& other)
 {
     if (this != &other) {
-        array_ptr_.reset();
-        object_ptr_.reset();
-        if (other.array_ptr_) {
-            array_ptr_ = std::make_unique<JsonArray>(*other.array_ptr_);
-        }
-        if (other.object_ptr_) {
-            object_ptr_ = std::make_unique<JsonObject>(*other.object_ptr_);
-        }
-        double_val_ = other.double_val_;
-        string_val_ = other.string_val_;
-        bool_val_ = other.bool_val_;
+        JsonValue copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+JsonValue& JsonValue::operator=(JsonValue&& other) noexcept
+{
+    if (this != &other) {
+        destroy();
+        int_val_ = other.int_val_;
         type_ = other.type_;
+        flags_ = other.flags_;
+        borrowed_size_ = other.borrowed_size_;
+        other.type_ = Null;
+        other.flags_ = 0;
     }
     return *this;
 }
 
-const JsonArray& JsonValue::to_array() const
+JsonValue JsonValue::borrow(std::string_view s)
 {
-    return *array_ptr_;
+    if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+        return JsonValue(s, allocator_type());
+    }
+    JsonValue v;
+    v.borrowed_ptr_ = s.data();
+    v.borrowed_size_ = static_cast<std::uint32_t>(s.size());
+    v.type_ = String;
+    v.flags_ = BorrowedString;
+    return v;
 }
 
-const JsonObject& JsonValue::to_object() const
+void JsonValue::destroy() noexcept
 {
-    return *object_ptr_;
+    switch (type_) {
+        case String:
+            if (!(flags_ & BorrowedString)) {
+                deleteNode(string_ptr_, string_ptr_->get_allocator().resource());
+            }
+            break;
+        case Array:
+        case Object:
+            releaseContainer();
+            break;
+        default:
+            break;
+    }
+    type_ = Null;
+    flags_ = 0;
 }
 
-bool JsonValue::equals(const JsonValue& other) const
+// Containers nested deeper than this below the one being released are
+// not destroyed from within their parent's destructor, but put off until
+// the outermost release returns, so that dropping a deep tree cannot run
+// out of stack
+static constexpr unsigned MaxReleaseDepth = 256;
+static thread_local unsigned releaseDepth = 0;
+static thread_local std::vector<JsonValue> releaseLater;
+
+void JsonValue::releaseContainer() noexcept
 {
-    if (!(type_ == other.type_ &&
-          bool_val_ == other.bool_val_ &&
-          double_val_ == other.double_val_ &&
-          string_val_ == other.string_val_)) {
-        return false;
+    if (releaseDepth == MaxReleaseDepth) {
+        try {
+            releaseLater.push_back(std::move(*this));
+            return;
+        }
+        catch (...) {
+            // Out of memory: release it here after all
+        }
     }
+    ++releaseDepth;
+    if (type_ == Array) {
+        releaseNode(array_ptr_);
+    }
+    else {
+        releaseNode(object_ptr_);
+    }
+    --releaseDepth;
     
-    if ((array_ptr_ && !other.array_ptr_) || (other.array_ptr_ && !array_ptr_)) {
-        return false;
+    if (releaseDepth == 0 && !releaseLater.empty()) {
+        // Each container put off may put off more in turn, so this goes
+        // through the tree MaxReleaseDepth levels at a time
+        releaseDepth = 1;
+        while (!releaseLater.empty()) {
+            JsonValue value(std::move(releaseLater.back()));
+            releaseLater.pop_back();
+        }
+        releaseDepth = 0;
+    }
+}
+
+std::pmr::memory_resource* JsonValue::resource() const noexcept
+{
+    switch (type_) {
+        case String:
+            if (flags_ & BorrowedString) {
+                return nullptr;
+            }
+            return string_ptr_->get_allocator().resource();
+        case Array:
+            return array_ptr_->value.resource();
+        case Object:
+            return object_ptr_->value.resource();
+        default:
+            return nullptr;
     }
-    else if (array_ptr_ && other.array_ptr_) {
-        if (!array_ptr_->equals(*other.array_ptr_)) {
+}
+
+bool JsonValue::to_bool() const noexcept
+{
+    switch (type_) {
+        case Bool:
+            return bool_val_;
+        case Int:
+            return int_val_ != 0;
+        case Double:
+            return double_val_ != 0.0;
+        default:
             return false;
+    }
+}
+
+std::uint64_t JsonValue::to_uint() const noexcept
+{
+    switch (type_) {
+        case Bool:
+            return bool_val_;
+        case Int:
+            return static_cast<std::uint64_t>(int_val_);
+        case Double:
+            return static_cast<std::uint64_t>(double_val_);
+        default:
+            return 0;
+    }
+}
+
+std::int64_t JsonValue::to_int() const noexcept
+{
+    switch (type_) {
+        case Bool:
+            return bool_val_;
+        case Int:
+            return int_val_;
+        case Double:
+            return static_cast<std::int64_t>(double_val_);
+        default:
+            return 0;
+    }
+}
+
+double JsonValue::to_double() const noexcept
+{
+    switch (type_) {
+        case Bool:
+            return bool_val_;
+        case Int:
+            if (flags_ & UnsignedInt) {
+                return static_cast<double>(static_cast<std::uint64_t>(int_val_));
+            }
+            return static_cast<double>(int_val_);
+        case Double:
+            return double_val_;
+        default:
+            return 0.0;
+    }
+}
+
+std::string_view JsonValue::to_string_view() const noexcept
+{
+    if (type_ == String) {
+        if (flags_ & BorrowedString) {
+            return std::string_view(borrowed_ptr_, borrowed_size_);
         }
+        return *string_ptr_;
     }
-    
-    if ((object_ptr_ && !other.object_ptr_) || (other.object_ptr_ && !object_ptr_)) {
-        return false;
+    return std::string_view();
+}
+
+std::string JsonValue::to_string() const
+{
+    return std::string(to_string_view());
+}
+
+const JsonArray& JsonValue::to_array() const
+{
+    return array_ptr_->value;
+}
+
+const JsonObject& JsonValue::to_object() const
+{
+    return object_ptr_->value;
+}
+
+JsonArray& JsonValue::mutable_array()
+{
+    if (type_ != Array) {
+        *this = JsonValue(JsonArray());
     }
-    else if (object_ptr_ && other.object_ptr_) {
-        if (!object_ptr_->equals(*other.object_ptr_)) {
-            return false;
+    unshareNode(array_ptr_);
+    return array_ptr_->value;
+}
+
+JsonObject& JsonValue::mutable_object()
+{
+    if (type_ != Object) {
+        *this = JsonValue(JsonObject());
+    }
+    unshareNode(object_ptr_);
+    return object_ptr_->value;
+}
+
+std::uint8_t JsonValue::borrowState() const noexcept
+{
+    switch (type_) {
+        case String:
+            return (flags_ & BorrowedString) ? Borrowed : NotBorrowed;
+        case Array:
+            return array_ptr_->borrows.load(std::memory_order_relaxed);
+        case Object:
+            return object_ptr_->borrows.load(std::memory_order_relaxed);
+        default:
+            return NotBorrowed;
+    }
+}
+
+// What a container made of these elements knows, without looking below
+// the changed containers among them
+std::uint8_t JsonValue::elementsBorrow(const JsonArray& a) noexcept
+{
+    std::uint8_t borrows = NotBorrowed;
+    for (const JsonValue& v : a) {
+        borrows = std::max(borrows, v.borrowState());
+    }
+    return borrows;
+}
+
+std::uint8_t JsonValue::elementsBorrow(const JsonObject& o) noexcept
+{
+    std::uint8_t borrows = NotBorrowed;
+    for (const auto& pr : o) {
+        borrows = std::max(borrows, pr.second.borrowState());
+    }
+    return borrows;
+}
+
+template <class Visit>
+void JsonValue::visitElements(Visit visit) const
+{
+    if (type_ == Array) {
+        for (const JsonValue& v : array_ptr_->value) {
+            visit(v);
+        }
+    }
+    else if (type_ == Object) {
+        for (const auto& pr : object_ptr_->value) {
+            visit(pr.second);
+        }
+    }
+}
+
+// Whether this is a borrowed string, or holds one at some depth
+bool JsonValue::borrowsText() const noexcept
+{
+    std::uint8_t borrows = borrowState();
+    if (borrows == MaybeBorrowed) {
+        borrows = resolveBorrows();
+    }
+    return borrows == Borrowed;
+}
+
+// Works out, and keeps, what the changed containers of this tree hold.
+// They are listed first, each before those below it, and then settled
+// from the bottom up, so that no depth of nesting can run out of stack.
+std::uint8_t JsonValue::resolveBorrows() const noexcept
+{
+    try {
+        std::vector<const JsonValue*> changed{ this };
+        for (size_t i = 0; i < changed.size(); ++i) {
+            changed[i]->visitElements([&](const JsonValue& v) {
+                if (v.borrowState() == MaybeBorrowed) {
+                    changed.push_back(&v);
+                }
+            });
+        }
+        for (size_t i = changed.size(); i-- > 0; ) {
+            const JsonValue& container = *changed[i];
+            std::uint8_t borrows = NotBorrowed;
+            container.visitElements([&](const JsonValue& v) {
+                borrows = std::max(borrows, v.borrowState());
+            });
+            if (container.type_ == Array) {
+                container.array_ptr_->borrows.store(borrows, std::memory_order_relaxed);
+            }
+            else {
+                container.object_ptr_->borrows.store(borrows, std::memory_order_relaxed);
+            }
         }
+        return borrowState();
+    }
+    catch (...) {
+        // Out of memory: assume the worst, which only costs a deep copy
+        return Borrowed;
+    }
+}
+
+size_t JsonMemoryUsage::total() const noexcept
+{
+    return containers + elements + members + indexes + strings + keys + slack + text + arena;
+}
+
+JsonMemoryUsage& JsonMemoryUsage::operator+=(const JsonMemoryUsage& other) noexcept
+{
+    containers += other.containers;
+    elements += other.elements;
+    members += other.members;
+    indexes += other.indexes;
+    strings += other.strings;
+    keys += other.keys;
+    slack += other.slack;
+    text += other.text;
+    arena += other.arena;
+    mapped += other.mapped;
+    return *this;
+}
+
+JsonMemoryUsage JsonValue::memoryUsage() const
+{
+    JsonMemoryUsage usage;
+    Counted counted;
+    addMemoryUsage(usage, counted);
+    return usage;
+}
+
+void JsonValue::addMemoryUsage(JsonMemoryUsage& usage, Counted& counted) const
+{
+    switch (type_) {
+        case String:
+            if (!(flags_ & BorrowedString)) {
+                size_t text = textBytes(*string_ptr_);
+                usage.strings += sizeof(std::pmr::string) + (text ? string_ptr_->size() + 1 : 0);
+                usage.slack += text ? string_ptr_->capacity() - string_ptr_->size() : 0;
+            }
+            break;
+        case Array:
+            if (counted.insert(array_ptr_).second) {
+                usage.containers += sizeof(*array_ptr_);
+                array_ptr_->value.addMemoryUsage(usage, counted);
+            }
+            break;
+        case Object:
+            if (counted.insert(object_ptr_).second) {
+                usage.containers += sizeof(*object_ptr_);
+                object_ptr_->value.addMemoryUsage(usage, counted);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Whether two nodes both have a hash, and the hashes differ
+template <class T>
+bool knownDifferent(const T* a, const T* b) noexcept
+{
+    size_t ha = a->hash.load(std::memory_order_relaxed);
+    size_t hb = b->hash.load(std::memory_order_relaxed);
+    return ha != 0 && hb != 0 && ha != hb;
+}
+
+bool JsonValue::equals(const JsonValue& other) const
+{
+    if (type_ != other.type_) {
+        return false;
     }
     
-    return true;
+    switch (type_) {
+        case Bool:
+            return bool_val_ == other.bool_val_;
+        case Int:
+            return int_val_ == other.int_val_ && flags_ == other.flags_;
+        case Double:
+            return double_val_ == other.double_val_;
+        case String:
+            return to_string_view() == other.to_string_view();
+        case Array:
+            if (array_ptr_ == other.array_ptr_) {
+                return true;
+            }
+            return !knownDifferent(array_ptr_, other.array_ptr_) && array_ptr_->value.equals(other.array_ptr_->value);
+        case Object:
+            if (object_ptr_ == other.object_ptr_) {
+                return true;
+            }
+            return !knownDifferent(object_ptr_, other.object_ptr_) && object_ptr_->value.equals(other.object_ptr_->value);
+        default:
+            return true;
+    }
 }
 
-std::ostream& JsonValue::serialize(std::ostream& os) const
+// Spreads the bits of 'h' over the whole word (the finalizer of MurmurHash3)
+static std::uint64_t mixHash(std::uint64_t h) noexcept
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+size_t JsonValue::hash() const noexcept
 {
+    std::uint64_t h = 0;
     switch (type_) {
         case Bool:
-            os << std::boolalpha << bool_val_;
+            h = bool_val_;
             break;
         case Int:
-            os << (int)double_val_;
+            h = static_cast<std::uint64_t>(int_val_) ^ (flags_ & UnsignedInt ? 0x8000000000000000ULL : 0);
             break;
-        case Double:
-            os << std::setprecision(std::numeric_limits<double>::digits10 + 1) << double_val_;
+        case Double: {
+            // 0.0 and -0.0 are equal
+            double d = double_val_ == 0.0 ? 0.0 : double_val_;
+            std::memcpy(&h, &d, sizeof(h));
             break;
+        }
         case String:
-            os << std::quoted(string_val_);
+            h = std::hash<std::string_view>()(to_string_view());
             break;
-        case Array:
-            os << *array_ptr_;
+        case Array: {
+            size_t known = array_ptr_->hash.load(std::memory_order_relaxed);
+            if (known != 0) {
+                return known;
+            }
+            h = array_ptr_->value.size();
+            for (const JsonValue& v : array_ptr_->value) {
+                h = mixHash(h ^ v.hash());
+            }
             break;
-        case Object:
-            os << *object_ptr_;
+        }
+        case Object: {
+            size_t known = object_ptr_->hash.load(std::memory_order_relaxed);
+            if (known != 0) {
+                return known;
+            }
+            // Summed, since member order does not matter for equality
+            h = object_ptr_->value.size();
+            for (const auto& pr : object_ptr_->value) {
+                h += mixHash(std::hash<std::string_view>()(pr.first) ^ mixHash(pr.second.hash()));
+            }
             break;
+        }
         default:
-            os << "null";
             break;
     }
+    
+    size_t result = static_cast<size_t>(mixHash(h ^ (std::uint64_t(type_) << 56)));
+    // 0 marks a hash not worked out yet
+    if (result == 0) {
+        result = 1;
+    }
+    if (type_ == Array) {
+        array_ptr_->hash.store(result, std::memory_order_relaxed);
+    }
+    else if (type_ == Object) {
+        object_ptr_->hash.store(result, std::memory_order_relaxed);
+    }
+    return result;
+}
+
+std::ostream& JsonValue::serialize(std::ostream& os) const
+{
+    // Arrays and objects pick their own buffer by their size
+    if (type_ == Array) {
+        return to_array().serialize(os);
+    }
+    if (type_ == Object) {
+        return to_object().serialize(os);
+    }
+    // Mostly used for short output, which a heap block would only slow down
+    char buffer[JsonWriter::SmallBuffer];
+    JsonWriter writer(os, buffer, sizeof(buffer));
+    writer.write(*this);
     return os;
 }
 
+char* JsonValue::format_number(char* buf) const noexcept
+{
+    char* end = buf + MaxNumberLength;
+    if (type_ == Int) {
+        if (flags_ & UnsignedInt) {
+            return std::to_chars(buf, end, static_cast<std::uint64_t>(int_val_)).ptr;
+        }
+        return std::to_chars(buf, end, int_val_).ptr;
+    }
+    
+    if (type_ != Double || !std::isfinite(double_val_)) {
+        std::memcpy(buf, "null", 4);
+        return buf + 4;
+    }
+    char* last = std::to_chars(buf, end, double_val_).ptr;
+    // "1" would read back as an Int
+    if (std::find_if(buf, last, [](char c) { return c == '.' || c == 'e'; }) == last) {
+        *last++ = '.';
+        *last++ = '0';
+    }
+    return last;
+}
+
 
 
 // -------------------------------
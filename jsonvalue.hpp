@@ -11,17 +11,78 @@
 
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <iostream>
+#include <type_traits>
+#include <utility>
 
 class JsonArray;
 class JsonObject;
 
+// The heap memory held by a tree of values, by what it is used for. The
+// counts are of bytes requested from memory resources; what an allocator
+// adds on top for its own bookkeeping is not included. An array or object
+// shared by several values of the tree is counted once. One shared with
+// another tree is counted in each.
+struct JsonMemoryUsage
+{
+    // The nodes holding arrays and objects, with their reference counts
+    size_t containers = 0;
+    // Array slots and object members in use. A member holds its key,
+    // which takes no more room unless it is too long to fit in place.
+    size_t elements = 0;
+    size_t members = 0;
+    // The lookup tables of large objects
+    size_t indexes = 0;
+    // String values, their text included; borrowed strings take none
+    size_t strings = 0;
+    // The text of keys too long to fit in place
+    size_t keys = 0;
+    // Capacity reserved past the end of arrays, objects and strings
+    size_t slack = 0;
+    // JsonDocument only: the text it keeps for borrowed strings to refer
+    // into, and what its arena holds beyond the tree, most of it left by
+    // containers that grew while being built
+    size_t text = 0;
+    size_t arena = 0;
+    // JsonDocument only: the size of a file it keeps mapped. Its pages
+    // belong to the page cache rather than the heap, so are not in total().
+    size_t mapped = 0;
+    
+    size_t total() const noexcept;
+    JsonMemoryUsage& operator+=(const JsonMemoryUsage&) noexcept;
+};
+
+// A JsonValue is a 16 byte tagged union: one 8 byte payload slot whose
+// meaning is given by type_. Scalars are stored inline; strings, arrays
+// and objects are owned through the payload pointer.
+//
+// The out-of-line payloads are allocated from a std::pmr::memory_resource,
+// the default resource unless an allocator is passed in. JsonValue is
+// allocator-aware, so a JsonArray or JsonObject built on some resource
+// places every value inserted into it on that same resource.
+//
+// A String may also be borrowed: it refers to text owned by someone else,
+// keeping the pointer in the payload and the length in what would other-
+// wise be padding. See borrow() for the rules that come with that.
+//
+// Arrays and objects are shared rather than copied: copying a value on the
+// same resource just counts one more reference to its array or object. The
+// shared containers are never changed; mutable_array() and mutable_object()
+// first give the value a container of its own when others refer to it too.
+// That copy shares the elements in turn, so changing a value deep in a tree
+// copies only the containers on the path down to it.
 class JsonValue
 {
 public:
-    enum Type {
+    using allocator_type = std::pmr::polymorphic_allocator<JsonValue>;
+
+    enum Type : std::uint8_t {
         Null,
         Bool,
         Int,
@@ -30,12 +91,18 @@ public:
         Array,
         Object
     };
-    
-    JsonValue() = default;
-    ~JsonValue() = default;
-    
+
+    JsonValue() noexcept : int_val_(0) {}
+    explicit JsonValue(const allocator_type&) noexcept : JsonValue() {}
+    ~JsonValue() { destroy(); }
+
     JsonValue(bool);
     JsonValue(int);
+    JsonValue(long);
+    JsonValue(long long);
+    JsonValue(unsigned int);
+    JsonValue(unsigned long);
+    JsonValue(unsigned long long);
     JsonValue(double);
     JsonValue(const char*);
     JsonValue(const std::string&);
@@ -44,27 +111,144 @@ public:
     JsonValue(JsonArray&&);
     JsonValue(const JsonObject&);
     JsonValue(JsonObject&&);
-    
+
+    JsonValue(std::string_view, const allocator_type&);
+    JsonValue(const char*, const allocator_type&);
+    JsonValue(const std::string&, const allocator_type&);
+    JsonValue(const JsonArray&, const allocator_type&);
+    JsonValue(JsonArray&&, const allocator_type&);
+    JsonValue(const JsonObject&, const allocator_type&);
+    JsonValue(JsonObject&&, const allocator_type&);
+
     JsonValue(const JsonValue&);
-    JsonValue(JsonValue&&) = default;
-    
+    JsonValue(JsonValue&&) noexcept;
+    JsonValue(const JsonValue&, const allocator_type&);
+    JsonValue(JsonValue&&, const allocator_type&);
+
     JsonValue& operator=(const JsonValue&);
-    JsonValue& operator=(JsonValue&&) = default;
-    
+    JsonValue& operator=(JsonValue&&) noexcept;
+
+    // A String that refers to 's' instead of holding a copy of it. The text
+    // must outlive the value, and any value it is moved into. Copying the
+    // value, on the other hand, makes a copy of the text. Strings of 4 GB
+    // and more are copied straight away.
+    static JsonValue borrow(std::string_view s);
+    // Constructs a value from 'args', allocating from alloc's resource when
+    // the value has anything to allocate. This is how emplace_back() and
+    // try_emplace() build values in place on their container's resource.
+    template <class... Args>
+    static JsonValue make(const allocator_type& alloc, Args&&... args)
+    {
+        if constexpr (std::is_constructible_v<JsonValue, Args&&..., const allocator_type&>) {
+            return JsonValue(std::forward<Args>(args)..., alloc);
+        }
+        else {
+            return JsonValue(std::forward<Args>(args)...);
+        }
+    }
+
+    // Scalar accessors convert between Bool, Int and Double where that is
+    // meaningful and return a zero value for any other type.
+    bool to_bool() const noexcept;
+    std::int64_t to_int() const noexcept;
+    std::uint64_t to_uint() const noexcept;
+    double to_double() const noexcept;
+    std::string_view to_string_view() const noexcept;
+    std::string to_string() const;
+
     const JsonArray& to_array() const;
     const JsonObject& to_object() const;
-    
+    // The array or object for changing in place, after copying it if it is
+    // shared. A value of another type is first replaced by an empty array
+    // or object. The reference is only good until the value is next copied
+    // or assigned, or its hash() taken: from then on the container is
+    // shared again, and its hash may be kept.
+    JsonArray& mutable_array();
+    JsonObject& mutable_object();
+
     Type type() const noexcept { return type_; }
+    // An Int holds any int64_t, or a uint64_t above INT64_MAX. The latter
+    // is only exact through to_uint().
+    bool is_uint64() const noexcept { return type_ == Int && (flags_ & UnsignedInt); }
+    // True for a String made by borrow()
+    bool is_borrowed() const noexcept { return type_ == String && (flags_ & BorrowedString); }
+    // Compares arrays element by element and objects member by member in
+    // any order. Arrays and objects whose hashes are both known, and differ,
+    // are told apart without looking at their contents.
     bool equals(const JsonValue&) const;
+    // A hash consistent with equals(). That of an array or object is worked
+    // out once and kept with it, so hashing the same tree again, or a tree
+    // that contains it, costs nothing for that part. Changing the container
+    // through mutable_array() or mutable_object() drops the kept hash.
+    size_t hash() const noexcept;
+    // The heap memory held by the value and everything in it
+    JsonMemoryUsage memoryUsage() const;
     std::ostream& serialize(std::ostream&) const;
     
+    // Room format_number() may need
+    static constexpr size_t MaxNumberLength = 32;
+    // Writes an Int or a Double into 'buf' and returns one past the last
+    // character written. A Double is written in the shortest form that
+    // reads back as the same value, and keeps a fraction or exponent so
+    // that it also reads back as a Double. JSON has no NaN or infinity;
+    // those are written as null.
+    char* format_number(char* buf) const noexcept;
+
 private:
-    std::unique_ptr<JsonArray> array_ptr_;
-    std::unique_ptr<JsonObject> object_ptr_;
-    double double_val_ = 0.0;
-    std::string string_val_;
-    bool bool_val_ = false;
+    friend class JsonArray;
+    friend class JsonObject;
+    friend class JsonDocument;
+    
+    // Arrays and objects already counted by memoryUsage()
+    using Counted = std::unordered_set<const void*>;
+    
+    enum Flags : std::uint8_t {
+        UnsignedInt = 1 << 0,
+        BorrowedString = 1 << 1
+    };
+
+    // An array or object together with the count of values sharing it
+    template <class T>
+    struct Node;
+    
+    // What is known of borrowed strings: a Borrows from jsonvalue.cpp
+    std::uint8_t borrowState() const noexcept;
+    static std::uint8_t elementsBorrow(const JsonArray&) noexcept;
+    static std::uint8_t elementsBorrow(const JsonObject&) noexcept;
+    template <class Visit>
+    void visitElements(Visit visit) const;
+    bool borrowsText() const noexcept;
+    std::uint8_t resolveBorrows() const noexcept;
+    void addMemoryUsage(JsonMemoryUsage&, Counted&) const;
+    // Bytes 's' has allocated for its text; none while it fits in place
+    template <class String>
+    static size_t textBytes(const String& s) noexcept
+    {
+        const char* inside = reinterpret_cast<const char*>(&s);
+        bool inPlace = s.data() >= inside && s.data() < inside + sizeof(s);
+        return inPlace ? 0 : s.capacity() + 1;
+    }
+    
+    void destroy() noexcept;
+    void releaseContainer() noexcept;
+    // Drops the payload without running any destructors. Only valid when
+    // the payload lives in an arena that is about to be released wholesale.
+    void abandon() noexcept { type_ = Null; flags_ = 0; }
+    std::pmr::memory_resource* resource() const noexcept;
+
+    union {
+        bool bool_val_;
+        std::int64_t int_val_;
+        double double_val_;
+        std::pmr::string* string_ptr_;
+        const char* borrowed_ptr_;
+        Node<JsonArray>* array_ptr_;
+        Node<JsonObject>* object_ptr_;
+    };
     Type type_ = Null;
+    std::uint8_t flags_ = 0;
+    // Length of a borrowed string
+    std::uint32_t borrowed_size_ = 0;
 };
 
 bool operator==(const JsonValue& lhs, const JsonValue& rhs);
@@ -72,4 +256,12 @@ bool operator!=(const JsonValue& lhs, const JsonValue& rhs);
 
 std::ostream& operator<<(std::ostream&, const JsonValue&);
 
+namespace std {
+    template <>
+    struct hash<JsonValue>
+    {
+        size_t operator()(const JsonValue& v) const noexcept { return v.hash(); }
+    };
+}
+
 #endif /* jsonvalue_hpp */
@@ -0,0 +1,480 @@
+//
+//  jsonwriter.cpp
+//  JsonLib
+//
+
+#include "jsonwriter.hpp"
+#include "jsonvalue.hpp"
+#include "jsonarray.hpp"
+#include "jsonobject.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+JsonWriter::JsonWriter(std::ostream& os, Style style) :
+    sink_(Stream),
+    style_(style),
+    os_(&os),
+    block_(new char[BlockSize])
+{
+    begin_ = cur_ = block_.get();
+    limit_ = begin_ + BlockSize;
+}
+
+JsonWriter::JsonWriter(std::ostream& os, char* buffer, size_t size, Style style) :
+    sink_(Stream),
+    style_(style),
+    os_(&os),
+    begin_(buffer),
+    cur_(buffer),
+    limit_(buffer + size)
+{}
+
+JsonWriter::JsonWriter(std::string& out, Style style) :
+    sink_(String),
+    style_(style),
+    str_(&out)
+{
+    size_t used = out.size();
+    out.resize(std::max<size_t>(used * 2, used + 256));
+    begin_ = out.data();
+    cur_ = begin_ + used;
+    limit_ = begin_ + out.size();
+}
+
+JsonWriter::JsonWriter(char* buffer, size_t size, Style style) :
+    sink_(Span),
+    style_(style),
+    begin_(buffer),
+    cur_(buffer),
+    limit_(buffer + size)
+{}
+
+JsonWriter::~JsonWriter()
+{
+    flush();
+}
+
+void JsonWriter::write(const JsonValue& value)
+{
+    writeValue(value, 0);
+}
+
+void JsonWriter::write(const JsonArray& array)
+{
+    writeArray(array, 0);
+}
+
+void JsonWriter::write(const JsonObject& object)
+{
+    writeObject(object, 0);
+}
+
+void JsonWriter::writeParallel(const JsonValue& value, unsigned threads)
+{
+    threads_ = threadCount(threads);
+    writeValue(value, 0);
+    threads_ = 0;
+}
+
+void JsonWriter::writeParallel(const JsonArray& array, unsigned threads)
+{
+    threads_ = threadCount(threads);
+    if (threads_ != 0 && array.size() >= ParallelThreshold) {
+        writeSplit(array, 0);
+    }
+    else {
+        writeArray(array, 0);
+    }
+    threads_ = 0;
+}
+
+void JsonWriter::writeParallel(const JsonObject& object, unsigned threads)
+{
+    threads_ = threadCount(threads);
+    if (threads_ != 0 && object.size() >= ParallelThreshold) {
+        writeSplit(object, 0);
+    }
+    else {
+        writeObject(object, 0);
+    }
+    threads_ = 0;
+}
+
+// Splitting with a single thread would only add copying
+unsigned JsonWriter::threadCount(unsigned threads)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return threads > 1 ? threads : 0;
+}
+
+void JsonWriter::writeRaw(std::string_view text)
+{
+    put(text.data(), text.size());
+}
+
+void JsonWriter::flush()
+{
+    switch (sink_) {
+        case Stream:
+            os_->write(begin_, cur_ - begin_);
+            flushed_ += cur_ - begin_;
+            cur_ = begin_;
+            break;
+        case String:
+            // Trim the unused tail; the next write grows the string again
+            str_->resize(cur_ - begin_);
+            begin_ = str_->data();
+            cur_ = limit_ = begin_ + str_->size();
+            break;
+        case Span:
+            break;
+    }
+}
+
+void JsonWriter::put(const char* s, size_t n)
+{
+    if (static_cast<size_t>(limit_ - cur_) < n) {
+        if (sink_ == Stream && n >= static_cast<size_t>(limit_ - begin_)) {
+            // Too big to be worth buffering
+            flush();
+            os_->write(s, n);
+            flushed_ += n;
+            return;
+        }
+        if (!makeRoom(n)) {
+            return;
+        }
+    }
+    std::memcpy(cur_, s, n);
+    cur_ += n;
+}
+
+// Ensures at least n bytes are available at cur_. Returns false, and
+// marks the writer as overflowed, if a fixed span cannot take them.
+bool JsonWriter::makeRoom(size_t n)
+{
+    switch (sink_) {
+        case Stream:
+            flush();
+            return n <= static_cast<size_t>(limit_ - begin_);
+        case String: {
+            size_t used = cur_ - begin_;
+            str_->resize(std::max(str_->size() * 2, used + n));
+            begin_ = str_->data();
+            cur_ = begin_ + used;
+            limit_ = begin_ + str_->size();
+            return true;
+        }
+        case Span:
+            overflowed_ = true;
+            // Nothing more fits after this point
+            limit_ = cur_;
+            return false;
+    }
+    return false;
+}
+
+void JsonWriter::writeIndent(int level)
+{
+    size_t n = level;
+    if (static_cast<size_t>(limit_ - cur_) < n && !makeRoom(n)) {
+        if (sink_ != Stream) {
+            return;
+        }
+        // Deeper than the stream's buffer is long: write a buffer at a time
+        size_t size = limit_ - begin_;
+        for (; n > size; n -= size) {
+            std::memset(begin_, '\t', size);
+            cur_ = limit_;
+            flush();
+        }
+    }
+    std::memset(cur_, '\t', n);
+    cur_ += n;
+}
+
+void JsonWriter::writeValue(const JsonValue& value, int level)
+{
+    switch (value.type()) {
+        case JsonValue::Bool:
+            if (value.to_bool()) {
+                put("true", 4);
+            }
+            else {
+                put("false", 5);
+            }
+            break;
+        case JsonValue::Int:
+        case JsonValue::Double:
+            if (static_cast<size_t>(limit_ - cur_) >= JsonValue::MaxNumberLength) {
+                cur_ = value.format_number(cur_);
+            }
+            else {
+                char buf[JsonValue::MaxNumberLength];
+                put(buf, value.format_number(buf) - buf);
+            }
+            break;
+        case JsonValue::String:
+            writeString(value.to_string_view());
+            break;
+        case JsonValue::Array:
+            if (threads_ != 0 && value.to_array().size() >= ParallelThreshold) {
+                writeSplit(value.to_array(), level);
+            }
+            else {
+                writeArray(value.to_array(), level);
+            }
+            break;
+        case JsonValue::Object:
+            if (threads_ != 0 && value.to_object().size() >= ParallelThreshold) {
+                writeSplit(value.to_object(), level);
+            }
+            else {
+                writeObject(value.to_object(), level);
+            }
+            break;
+        default:
+            put("null", 4);
+            break;
+    }
+}
+
+void JsonWriter::writeArray(const JsonArray& array, int level)
+{
+    if (style_ == Compact) {
+        put('[');
+        writeItems(array, 0, array.size(), level);
+        put(']');
+        return;
+    }
+    
+    put("[\n", 2);
+    writeItems(array, 0, array.size(), level);
+    writeIndent(level);
+    put(']');
+}
+
+void JsonWriter::writeObject(const JsonObject& object, int level)
+{
+    if (style_ == Compact) {
+        put('{');
+        writeItems(object, 0, object.size(), level);
+        put('}');
+        return;
+    }
+    
+    put("{\n", 2);
+    writeItems(object, 0, object.size(), level);
+    writeIndent(level);
+    put('}');
+}
+
+void JsonWriter::writeItems(const JsonArray& array, size_t begin, size_t end, int level)
+{
+    auto it = array.begin() + begin;
+    if (style_ == Compact) {
+        for (size_t i = begin; i < end; ++i, ++it) {
+            if (i > 0) {
+                put(',');
+            }
+            writeValue(*it, level + 1);
+        }
+        return;
+    }
+    
+    size_t sz = array.size();
+    for (size_t i = begin; i < end; ++i, ++it) {
+        writeIndent(level + 1);
+        writeValue(*it, level + 1);
+        if (i + 1 < sz) {
+            put(',');
+        }
+        put('\n');
+    }
+}
+
+void JsonWriter::writeItems(const JsonObject& object, size_t begin, size_t end, int level)
+{
+    auto it = object.begin() + begin;
+    if (style_ == Compact) {
+        for (size_t i = begin; i < end; ++i, ++it) {
+            if (i > 0) {
+                put(',');
+            }
+            writeString(it->first);
+            put(':');
+            writeValue(it->second, level + 1);
+        }
+        return;
+    }
+    
+    size_t sz = object.size();
+    for (size_t i = begin; i < end; ++i, ++it) {
+        writeIndent(level + 1);
+        writeString(it->first);
+        put(": ", 2);
+        writeValue(it->second, level + 1);
+        if (i + 1 < sz) {
+            put(',');
+        }
+        put('\n');
+    }
+}
+
+// Writes a container whose elements are rendered in chunks by threads_
+// worker threads while this thread writes the finished chunks out in order.
+// Workers stay at most two chunks per thread ahead of the writing, so only
+// that much output is ever held in buffers.
+template<class Container>
+void JsonWriter::writeSplit(const Container& container, int level)
+{
+    const bool isArray = std::is_same<Container, JsonArray>::value;
+    if (style_ == Compact) {
+        put(isArray ? '[' : '{');
+    }
+    else {
+        put(isArray ? "[\n" : "{\n", 2);
+    }
+    
+    // Render the first elements here, to learn how many of them make up
+    // about ChunkBytes of output
+    size_t size = container.size();
+    size_t done = std::min(size, ParallelThreshold / 4);
+    std::string sample;
+    {
+        JsonWriter writer(sample, style_);
+        writer.writeItems(container, 0, done, level);
+    }
+    put(sample.data(), sample.size());
+    size_t perChunk = std::max<size_t>(1, done * ChunkBytes / std::max<size_t>(sample.size(), 1));
+    size_t chunks = (size - done + perChunk - 1) / perChunk;
+    
+    struct Slot {
+        std::string text;
+        bool ready = false;
+    };
+    // Chunk i is rendered into slots[i % slots.size()]
+    std::vector<Slot> slots(std::min<size_t>(size_t(threads_) * 2, chunks));
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+    size_t claimed = 0;
+    size_t written = 0;
+    
+    auto work = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            space.wait(lock, [&]() { return claimed == chunks || claimed < written + slots.size(); });
+            if (claimed == chunks) {
+                return;
+            }
+            size_t i = claimed++;
+            Slot& slot = slots[i % slots.size()];
+            lock.unlock();
+            
+            size_t begin = done + i * perChunk;
+            slot.text.clear();
+            {
+                JsonWriter writer(slot.text, style_);
+                writer.writeItems(container, begin, std::min(size, begin + perChunk), level);
+            }
+            
+            lock.lock();
+            slot.ready = true;
+            ready.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < std::min<size_t>(threads_, chunks); ++t) {
+        pool.emplace_back(work);
+    }
+    for (size_t i = 0; i < chunks; ++i) {
+        Slot& slot = slots[i % slots.size()];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&]() { return slot.ready; });
+        }
+        put(slot.text.data(), slot.text.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.ready = false;
+            ++written;
+        }
+        space.notify_all();
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    
+    if (style_ != Compact) {
+        writeIndent(level);
+    }
+    put(isArray ? ']' : '}');
+}
+
+// Characters that cannot appear in a JSON string as they are
+static const bool needsEscape[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // "
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,     // backslash
+};
+
+void JsonWriter::writeString(std::string_view s)
+{
+    put('"');
+    const char* it = s.data();
+    const char* end = it + s.size();
+    while (it != end) {
+        // Copy the longest run that needs no escaping in one go
+        const char* run = it;
+        while (it != end && !needsEscape[static_cast<unsigned char>(*it)]) {
+            ++it;
+        }
+        put(run, it - run);
+        if (it == end) {
+            break;
+        }
+        
+        char c = *it++;
+        switch (c) {
+            case '"':
+                put("\\\"", 2);
+                break;
+            case '\\':
+                put("\\\\", 2);
+                break;
+            case '\b':
+                put("\\b", 2);
+                break;
+            case '\f':
+                put("\\f", 2);
+                break;
+            case '\n':
+                put("\\n", 2);
+                break;
+            case '\r':
+                put("\\r", 2);
+                break;
+            case '\t':
+                put("\\t", 2);
+                break;
+            default: {
+                static const char hex[] = "0123456789abcdef";
+                char esc[6] = { '\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF] };
+                put(esc, 6);
+                break;
+            }
+        }
+    }
+    put('"');
+}
@@ -0,0 +1,128 @@
+//
+//  jsonwriter.hpp
+//  JsonLib
+//
+
+#ifndef jsonwriter_hpp
+#define jsonwriter_hpp
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class JsonValue;
+class JsonArray;
+class JsonObject;
+
+// Serializes JSON into a contiguous buffer with plain pointer arithmetic.
+// The output goes to one of three sinks:
+//  - a std::ostream, written in large blocks as the buffer fills up, or
+//    through a small caller-provided buffer for short output,
+//  - a caller's std::string, appended to and grown as needed,
+//  - a fixed caller-provided span, which stops accepting output once full.
+// Output is complete once flush() has been called or the writer destroyed.
+//
+// writeParallel() renders large arrays and objects on several threads.
+// Their elements are cut into chunks of about ChunkBytes of output, each
+// chunk is rendered into a buffer of its own, and the buffers are written
+// out in order, so the text is exactly what write() would give.
+class JsonWriter
+{
+public:
+    enum Style {
+        Compact,
+        Indented    // one member per line, indented with tabs
+    };
+    
+    explicit JsonWriter(std::ostream& os, Style style = Compact);
+    // Writes to 'os' through 'buffer' rather than a block of its own,
+    // which is cheaper to set up when the output is short. Any size but 0
+    // works; SmallBuffer is what serialize() and operator<< use, for
+    // scalars and for arrays and objects of up to SmallContainer elements.
+    // Larger ones go through a block, as they would overflow it many times.
+    JsonWriter(std::ostream& os, char* buffer, size_t size, Style style = Compact);
+    static constexpr size_t SmallBuffer = 256;
+    static constexpr size_t SmallContainer = 16;
+    explicit JsonWriter(std::string& out, Style style = Compact);
+    JsonWriter(char* buffer, size_t size, Style style = Compact);
+    ~JsonWriter();
+    
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+    
+    void write(const JsonValue&);
+    void write(const JsonArray&);
+    void write(const JsonObject&);
+    // Like write(), but with the elements of arrays and objects of at least
+    // ParallelThreshold elements rendered by 'threads' threads, or one per
+    // core when 0. Only the outermost such containers are split; the values
+    // must not be modified until it returns.
+    void writeParallel(const JsonValue&, unsigned threads = 0);
+    void writeParallel(const JsonArray&, unsigned threads = 0);
+    void writeParallel(const JsonObject&, unsigned threads = 0);
+    // Writes text verbatim
+    void writeRaw(std::string_view);
+    
+    void flush();
+    
+    // True when a fixed span was too small for the output
+    bool overflowed() const noexcept { return overflowed_; }
+    // Bytes of output so far: written to the stream or fixed span, or the
+    // length of the string
+    size_t size() const noexcept { return flushed_ + (cur_ - begin_); }
+
+private:
+    enum Sink {
+        Stream,
+        String,
+        Span
+    };
+    
+    static constexpr size_t BlockSize = 64 * 1024;
+    // Smallest container that writeParallel() splits
+    static constexpr size_t ParallelThreshold = 1024;
+    // Output per chunk that a thread renders at a time
+    static constexpr size_t ChunkBytes = 256 * 1024;
+    
+    static unsigned threadCount(unsigned threads);
+    
+    void writeValue(const JsonValue&, int level);
+    void writeArray(const JsonArray&, int level);
+    void writeObject(const JsonObject&, int level);
+    // Write elements [begin, end) of a container with the separators that
+    // writeArray() and writeObject() put around them, so that rendering
+    // consecutive ranges one after another gives the same text as one call
+    void writeItems(const JsonArray&, size_t begin, size_t end, int level);
+    void writeItems(const JsonObject&, size_t begin, size_t end, int level);
+    template<class Container>
+    void writeSplit(const Container&, int level);
+    void writeString(std::string_view);
+    void writeIndent(int level);
+    
+    void put(char c)
+    {
+        if (cur_ == limit_ && !makeRoom(1)) {
+            return;
+        }
+        *cur_++ = c;
+    }
+    void put(const char* s, size_t n);
+    bool makeRoom(size_t n);
+    
+    Sink sink_;
+    Style style_;
+    // Threads for splitting containers, or 0 when writing serially
+    unsigned threads_ = 0;
+    std::ostream* os_ = nullptr;
+    std::string* str_ = nullptr;
+    std::unique_ptr<char[]> block_;
+    char* begin_ = nullptr;
+    char* cur_ = nullptr;
+    char* limit_ = nullptr;
+    // Bytes already handed to the stream
+    size_t flushed_ = 0;
+    bool overflowed_ = false;
+};
+
+#endif /* jsonwriter_hpp */
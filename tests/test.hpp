@@ -0,0 +1,64 @@
+//
+//  test.hpp
+//  JsonLib
+//
+
+#ifndef test_hpp
+#define test_hpp
+
+#include <cstddef>
+#include <cstdio>
+#include <memory_resource>
+
+// What the tests share: a check that reports and counts failures instead
+// of stopping, and a memory resource that counts what goes through it.
+// Each test is a program of its own, whose main() returns testResult().
+
+inline int testFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++testFailures; \
+        } \
+    } while (0)
+
+inline int testResult()
+{
+    if (testFailures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", testFailures);
+        return 1;
+    }
+    return 0;
+}
+
+// Forwards to new_delete_resource(), keeping count of allocations and of
+// the bytes still allocated
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+    size_t bytes = 0;
+    long long live = 0;
+
+private:
+    void* do_allocate(size_t n, size_t alignment) override
+    {
+        ++allocations;
+        bytes += n;
+        live += static_cast<long long>(n);
+        return std::pmr::new_delete_resource()->allocate(n, alignment);
+    }
+    void do_deallocate(void* p, size_t n, size_t alignment) override
+    {
+        live -= static_cast<long long>(n);
+        std::pmr::new_delete_resource()->deallocate(p, n, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+#endif /* test_hpp */
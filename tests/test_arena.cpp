@@ -0,0 +1,83 @@
+//
+//  test_arena.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <string>
+#include <utility>
+
+// Documents with an arena release their tree along with the arena, but a
+// tree changed through mutable_array() or mutable_object() may hold
+// values from elsewhere, which must still be freed.
+
+static CountingResource counting;
+
+static const char* text = R"({"a":[1,2,3],"b":{"c":"a string long enough to be allocated"}})";
+
+static void testEditedObject()
+{
+    long long before = counting.live;
+    {
+        JsonDocument doc = JsonDocument::from_json(text, JsonDocument::UseArena);
+        CHECK(doc.isValid() && doc.usesArena());
+        doc.mutable_object()["c"] = JsonValue(std::string(100, 'z'));
+        doc.mutable_object()["a"].mutable_array()[0] = JsonValue(JsonArray(10, JsonValue("a string long enough to be allocated")));
+        CHECK(doc.to_object().at("c").to_string_view().size() == 100);
+    }
+    CHECK(counting.live == before);
+}
+
+static void testEditedArray()
+{
+    long long before = counting.live;
+    {
+        JsonDocument doc = JsonDocument::from_json("[1,2,3]", JsonDocument::UseArena);
+        doc.mutable_array()[1] = JsonValue(JsonObject{ { "key", JsonValue(std::string(50, 'k')) } });
+        CHECK(doc.to_array()[1].to_object().size() == 1);
+    }
+    CHECK(counting.live == before);
+}
+
+static void testReplacedTree()
+{
+    long long before = counting.live;
+    {
+        JsonDocument doc = JsonDocument::from_json(text, JsonDocument::UseArena);
+        doc.mutable_object()["c"] = JsonValue(std::string(100, 'z'));
+        // Parsing again, assigning another document and compacting all
+        // drop the edited tree
+        doc = JsonDocument::from_json(text, JsonDocument::UseArena);
+        doc.mutable_object()["c"] = JsonValue(std::string(100, 'y'));
+        doc.compact(true);
+        CHECK(doc.to_object().at("c").to_string_view() == std::string(100, 'y'));
+        doc.mutable_object()["d"] = JsonValue(std::string(100, 'x'));
+        JsonDocument other = JsonDocument::from_json(text, JsonDocument::UseArena);
+        other.mutable_object()["e"] = JsonValue(std::string(100, 'w'));
+        doc = std::move(other);
+        CHECK(doc.to_object().contains("e"));
+    }
+    CHECK(counting.live == before);
+}
+
+static void testUneditedTree()
+{
+    long long before = counting.live;
+    {
+        JsonDocument doc = JsonDocument::from_json(text, JsonDocument::UseArena);
+        JsonDocument copy(doc);
+        CHECK(copy.to_value() == doc.to_value());
+    }
+    CHECK(counting.live == before);
+}
+
+int main()
+{
+    std::pmr::set_default_resource(&counting);
+    testEditedObject();
+    testEditedArray();
+    testReplacedTree();
+    testUneditedTree();
+    return testResult();
+}
@@ -0,0 +1,287 @@
+//
+//  test_binary.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsonbinary.hpp"
+#include "jsondocument.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+// CBOR and MessagePack give back the tree they were given, keeping the
+// types of numbers, and reject every input that is cut short, claims more
+// than it holds or is otherwise malformed.
+
+static std::string bytes(std::initializer_list<int> list)
+{
+    std::string s;
+    for (int b : list) {
+        s += static_cast<char>(b);
+    }
+    return s;
+}
+
+static std::string cbor(const JsonValue& value)
+{
+    std::string out;
+    JsonCbor::encode(value, out);
+    return out;
+}
+
+static std::string msgPack(const JsonValue& value)
+{
+    std::string out;
+    CHECK(JsonMsgPack::encode(value, out));
+    return out;
+}
+
+static bool sameNumber(const JsonValue& a, const JsonValue& b)
+{
+    if (a.type() != b.type() || a.is_uint64() != b.is_uint64()) {
+        return false;
+    }
+    if (a.type() == JsonValue::Double) {
+        double x = a.to_double();
+        double y = b.to_double();
+        return std::memcmp(&x, &y, sizeof(x)) == 0;
+    }
+    return a.to_uint() == b.to_uint();
+}
+
+static void checkRoundTrip(const JsonValue& value)
+{
+    JsonValue fromCbor;
+    CHECK(JsonCbor::decode(cbor(value), fromCbor));
+    CHECK(fromCbor.equals(value));
+    JsonValue fromMsgPack;
+    CHECK(JsonMsgPack::decode(msgPack(value), fromMsgPack));
+    CHECK(fromMsgPack.equals(value));
+    if (value.type() == JsonValue::Int || value.type() == JsonValue::Double) {
+        CHECK(sameNumber(fromCbor, value));
+        CHECK(sameNumber(fromMsgPack, value));
+    }
+}
+
+static void testIntegers()
+{
+    using int64 = std::numeric_limits<std::int64_t>;
+    using int32 = std::numeric_limits<std::int32_t>;
+    for (long long i : { 0LL, 1LL, -1LL, 23LL, 24LL, -24LL, -25LL, -32LL, -33LL, 127LL, 128LL, -128LL, -129LL,
+                         255LL, 256LL, 65535LL, 65536LL, -32768LL, -32769LL, 4294967295LL, 4294967296LL,
+                         static_cast<long long>(int32::min()), static_cast<long long>(int32::min()) - 1,
+                         static_cast<long long>(int64::max()), static_cast<long long>(int64::min()),
+                         static_cast<long long>(int64::min()) + 1 }) {
+        checkRoundTrip(JsonValue(i));
+    }
+    for (unsigned long long u : { static_cast<unsigned long long>(int64::max()) + 1,
+                                  std::numeric_limits<unsigned long long>::max() - 1,
+                                  std::numeric_limits<unsigned long long>::max() }) {
+        JsonValue value(u);
+        CHECK(value.is_uint64());
+        checkRoundTrip(value);
+    }
+    CHECK(cbor(JsonValue(static_cast<long long>(int64::min()))) == bytes({ 0x3b, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }));
+    CHECK(msgPack(JsonValue(std::numeric_limits<unsigned long long>::max())) == bytes({ 0xcf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }));
+
+    // A CBOR negative integer below INT64_MIN has no JsonValue
+    JsonValue value;
+    CHECK(!JsonCbor::decode(bytes({ 0x3b, 0x80, 0, 0, 0, 0, 0, 0, 0 }), value));
+}
+
+static void testFloats()
+{
+    for (double d : { 0.0, -0.0, 0.5, -1.5, 0.1, 1e300, -1e-300, 3.4028234663852886e38, 1.401298464324817e-45,
+                      4.9406564584124654e-324, std::numeric_limits<double>::infinity() }) {
+        checkRoundTrip(JsonValue(d));
+    }
+    // Written as a float only when a float holds the value exactly
+    CHECK(cbor(JsonValue(0.5)).size() == 5);
+    CHECK(cbor(JsonValue(0.1)).size() == 9);
+    CHECK(msgPack(JsonValue(-0.0)) == bytes({ 0xca, 0x80, 0, 0, 0 }));
+
+    struct Case {
+        std::string data;
+        double value;
+    };
+    const Case cases[] = {
+        { bytes({ 0xf9, 0x3c, 0x00 }), 1.0 },
+        { bytes({ 0xf9, 0xc4, 0x00 }), -4.0 },
+        { bytes({ 0xf9, 0x7b, 0xff }), 65504.0 },
+        { bytes({ 0xf9, 0x00, 0x01 }), std::ldexp(1.0, -24) },
+        { bytes({ 0xf9, 0x03, 0xff }), std::ldexp(1023.0, -24) },
+        { bytes({ 0xf9, 0x80, 0x00 }), -0.0 },
+        { bytes({ 0xf9, 0x7c, 0x00 }), std::numeric_limits<double>::infinity() },
+        { bytes({ 0xfa, 0x47, 0xc3, 0x50, 0x00 }), 100000.0 },
+        { bytes({ 0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a }), 1.1 },
+    };
+    for (const Case& c : cases) {
+        JsonValue value;
+        CHECK(JsonCbor::decode(c.data, value));
+        CHECK(sameNumber(value, JsonValue(c.value)));
+    }
+    JsonValue nan;
+    CHECK(JsonCbor::decode(bytes({ 0xf9, 0x7e, 0x00 }), nan));
+    CHECK(nan.type() == JsonValue::Double && std::isnan(nan.to_double()));
+
+    JsonValue value;
+    CHECK(JsonMsgPack::decode(bytes({ 0xca, 0x47, 0xc3, 0x50, 0x00 }), value));
+    CHECK(sameNumber(value, JsonValue(100000.0)));
+    CHECK(JsonMsgPack::decode(bytes({ 0xcb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a }), value));
+    CHECK(sameNumber(value, JsonValue(1.1)));
+}
+
+static JsonValue makeTree()
+{
+    JsonDocument doc = JsonDocument::from_json(R"({
+        "id": 12345678901, "name": "café", "ratio": -0.25, "empty": "", "none": null,
+        "flags": [true, false], "nested": {"a": [[], {}, [1, [2, [3]]]], "b": {"c": {"d": -1}}},
+        "long": "0123456789012345678901234567890123456789"
+    })");
+    CHECK(doc.isValid());
+    return doc.to_value();
+}
+
+static void testTrees()
+{
+    JsonValue tree = makeTree();
+    checkRoundTrip(tree);
+    checkRoundTrip(JsonArray());
+    checkRoundTrip(JsonObject());
+    checkRoundTrip(JsonValue("x"));
+    checkRoundTrip(JsonValue(std::string(300, 'y')));
+    checkRoundTrip(JsonValue(std::string(70000, 'z')));
+
+    JsonArray many;
+    for (int i = 0; i < 70000; ++i) {
+        many.push_back(i);
+    }
+    checkRoundTrip(JsonValue(many));
+
+    // The array and object overloads write what the value would
+    std::string out;
+    JsonCbor::encode(tree.to_object(), out);
+    CHECK(out == cbor(tree));
+    out.clear();
+    CHECK(JsonMsgPack::encode(tree.to_object(), out));
+    CHECK(out == msgPack(tree));
+    out.clear();
+    JsonCbor::encode(many, out);
+    CHECK(out == cbor(JsonValue(many)));
+}
+
+static bool decode(bool isCbor, std::string_view data)
+{
+    JsonValue value;
+    return isCbor ? JsonCbor::decode(data, value) : JsonMsgPack::decode(data, value);
+}
+
+// Every prefix of a valid encoding is cut short, and so is every encoding
+// with a byte more
+static void testTruncated()
+{
+    JsonValue tree = makeTree();
+    for (bool isCbor : { true, false }) {
+        std::string data = isCbor ? cbor(tree) : msgPack(tree);
+        CHECK(decode(isCbor, data));
+        for (size_t size = 0; size < data.size(); ++size) {
+            CHECK(!decode(isCbor, std::string_view(data.data(), size)));
+        }
+        CHECK(!decode(isCbor, data + '\0'));
+    }
+}
+
+// Counts above what the bytes left could hold fail before anything is
+// reserved for them
+static void testCounts()
+{
+    JsonValue value;
+    // Arrays, maps and strings of 255 and 2^64 - 1 items, with few bytes
+    CHECK(!JsonCbor::decode(bytes({ 0x98, 0xff, 0x01, 0x02 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0xbb, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x61, 0x61, 0x01 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0xb8, 0x02, 0x61, 0x61, 0x01 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x7b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x61 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x78, 0x05, 0x61, 0x62 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x7f, 0x7b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }), value));
+    // Reserved additional info
+    CHECK(!JsonCbor::decode(bytes({ 0x9c }), value));
+
+    CHECK(!JsonMsgPack::decode(bytes({ 0x9f, 0x01, 0x02 }), value));
+    CHECK(!JsonMsgPack::decode(bytes({ 0xdd, 0xff, 0xff, 0xff, 0xff, 0x01 }), value));
+    CHECK(!JsonMsgPack::decode(bytes({ 0xdf, 0xff, 0xff, 0xff, 0xff, 0xa1, 0x61, 0x01 }), value));
+    CHECK(!JsonMsgPack::decode(bytes({ 0x82, 0xa1, 0x61, 0x01 }), value));
+    CHECK(!JsonMsgPack::decode(bytes({ 0xdb, 0xff, 0xff, 0xff, 0xff, 0x61 }), value));
+    CHECK(!JsonMsgPack::decode(bytes({ 0xa5, 0x61, 0x62 }), value));
+
+    // The same with the bytes there
+    CHECK(JsonCbor::decode(bytes({ 0x82, 0x01, 0x02 }), value));
+    CHECK(JsonMsgPack::decode(bytes({ 0x81, 0xa1, 0x61, 0x01 }), value));
+    CHECK(value.to_object().size() == 1);
+}
+
+static void testIndefinite()
+{
+    JsonValue value;
+    CHECK(JsonCbor::decode(bytes({ 0x9f, 0x01, 0x9f, 0xff, 0x02, 0xff }), value));
+    CHECK(value.equals(JsonDocument::from_json("[1,[],2]").to_value()));
+    CHECK(JsonCbor::decode(bytes({ 0xbf, 0x61, 0x61, 0x01, 0x61, 0x62, 0xbf, 0xff, 0xff }), value));
+    CHECK(value.equals(JsonDocument::from_json("{\"a\":1,\"b\":{}}").to_value()));
+    CHECK(JsonCbor::decode(bytes({ 0x7f, 0x62, 0x61, 0x62, 0x60, 0x61, 0x63, 0xff }), value));
+    CHECK(value.to_string_view() == "abc");
+
+    // A map that ends after a key, or with no break at all
+    CHECK(!JsonCbor::decode(bytes({ 0xbf, 0x61, 0x61, 0xff }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0xbf, 0x61, 0x61, 0x01, 0x61, 0x62, 0xff }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0xbf, 0x61, 0x61, 0x01 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x9f, 0x01 }), value));
+    // Breaks outside indefinite containers
+    CHECK(!JsonCbor::decode(bytes({ 0xff }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x81, 0xff }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x9f, 0x01, 0xff, 0xff }), value));
+    // Keys that are not text, and string chunks that are not text
+    CHECK(!JsonCbor::decode(bytes({ 0xbf, 0x01, 0x01, 0xff }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0xa1, 0x01, 0x01 }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x7f, 0x41, 0x61, 0xff }), value));
+    CHECK(!JsonCbor::decode(bytes({ 0x7f, 0x61, 0x61 }), value));
+}
+
+// Trees far deeper than the stack would allow to recurse through encode
+// and decode
+static void testDeep()
+{
+    const size_t depth = 200000;
+    JsonArray root;
+    JsonArray* inner = &root;
+    for (size_t i = 0; i < depth; ++i) {
+        inner = &inner->emplace_back(JsonObject()).mutable_object()["k"].mutable_array();
+    }
+    JsonValue tree(std::move(root));
+
+    std::string cborData = cbor(tree);
+    CHECK(cborData.size() == 1 + 4 * depth);
+    JsonValue fromCbor;
+    CHECK(JsonCbor::decode(cborData, fromCbor));
+    CHECK(cbor(fromCbor) == cborData);
+
+    std::string msgPackData = msgPack(tree);
+    CHECK(msgPackData.size() == cborData.size());
+    JsonValue fromMsgPack;
+    CHECK(JsonMsgPack::decode(msgPackData, fromMsgPack));
+    CHECK(msgPack(fromMsgPack) == msgPackData);
+}
+
+int main()
+{
+    testIntegers();
+    testFloats();
+    testTrees();
+    testTruncated();
+    testCounts();
+    testIndefinite();
+    testDeep();
+    return testResult();
+}
@@ -0,0 +1,56 @@
+//
+//  test_deep.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <string>
+
+// Trees far deeper than the stack would allow to recurse through are
+// parsed and dropped without running out of it.
+
+static const size_t Depth = 1000000;
+
+static void testParsed()
+{
+    std::string arrays = std::string(Depth, '[') + std::string(Depth, ']');
+    std::string objects;
+    for (size_t i = 0; i < Depth; ++i) {
+        objects += "{\"a\":";
+    }
+    objects += "0" + std::string(Depth, '}');
+    for (const std::string& text : { arrays, objects }) {
+        for (int flags : { JsonDocument::NoFlags, JsonDocument::UseArena }) {
+            JsonDocument doc = JsonDocument::from_json(text, flags);
+            CHECK(doc.isValid());
+            if (flags == JsonDocument::UseArena) {
+                // Once edited, the tree is dropped value by value
+                doc.mutable_array();
+            }
+        }
+    }
+}
+
+static void testBuilt()
+{
+    JsonArray root;
+    JsonArray* inner = &root;
+    for (size_t i = 0; i < Depth; ++i) {
+        inner = &inner->emplace_back(JsonArray()).mutable_array();
+        inner->push_back(JsonObject());
+    }
+    JsonValue value(std::move(root));
+    // Shared, once what the changed containers hold is worked out
+    JsonValue copy = value;
+    CHECK(&copy.to_array() == &value.to_array());
+    value = JsonValue();
+    CHECK(copy.to_array().size() == 1);
+}
+
+int main()
+{
+    testParsed();
+    testBuilt();
+    return testResult();
+}
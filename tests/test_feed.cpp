@@ -0,0 +1,193 @@
+//
+//  test_feed.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsonparser.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Input fed in chunks gives the same events as the whole of it parsed at
+// once, wherever the chunks are cut: inside escapes, surrogate pairs,
+// numbers and literals as much as between tokens.
+
+// Records the events of a parse as text, to compare two parses by
+class Recorder : public JsonHandler
+{
+public:
+    bool onNull() override { events += "n"; return true; }
+    bool onBool(bool b) override { events += b ? "t" : "f"; return true; }
+    bool onNumber(const JsonValue& v) override
+    {
+        char buffer[64];
+        if (v.is_uint64()) {
+            std::snprintf(buffer, sizeof(buffer), "u%llu;", static_cast<unsigned long long>(v.to_uint()));
+        }
+        else if (v.type() == JsonValue::Int) {
+            std::snprintf(buffer, sizeof(buffer), "i%lld;", static_cast<long long>(v.to_int()));
+        }
+        else {
+            std::snprintf(buffer, sizeof(buffer), "d%a;", v.to_double());
+        }
+        events += buffer;
+        return true;
+    }
+    bool onString(std::string_view s) override { events += "s" + std::to_string(s.size()) + ":"; events += s; return true; }
+    bool onStartObject() override { events += "{"; return true; }
+    bool onKey(std::string_view s) override { events += "k" + std::to_string(s.size()) + ":"; events += s; return true; }
+    bool onEndObject() override { events += "}"; return true; }
+    bool onStartArray() override { events += "["; return true; }
+    bool onEndArray() override { events += "]"; return true; }
+
+    std::string events;
+};
+
+static const char* const Valid[] = {
+    "0",
+    " -0 ",
+    "123456789",
+    "-9223372036854775808",
+    "18446744073709551615",
+    "123456789012345678901234567890",
+    "-12.5e+10",
+    "6.02214076E23",
+    "1e-400",
+    "true",
+    "false",
+    "null",
+    "\"\"",
+    "\"plain text\"",
+    "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"",
+    "\"caf\\u00e9 \\u20AC\"",
+    "\"\\ud83d\\ude00 and \\uD834\\uDD1E\"",
+    "\"caf\xc3\xa9 \xf0\x9f\x98\x80\"",
+    "[]",
+    "{}",
+    "[1,-2.5,true,false,null,\"s\",[],{}]",
+    "{\"a\":1,\"b\\n\":[true,{\"c\\u0041\":null}],\"\":-0.0e0}",
+    " \n\t[ 1 , [ 2 , [ 3 ] ] , { \"k\" : \"v\" } ] \r\n",
+};
+
+static const char* const Malformed[] = {
+    "",
+    "   ",
+    "tru",
+    "truex",
+    "nul",
+    "-",
+    "01",
+    "1.",
+    "1e",
+    "1e+",
+    "\"unterminated",
+    "\"bad \\x escape\"",
+    "\"\\u12\"",
+    "\"\\ud83d alone\"",
+    "\"\\ude00 alone\"",
+    "\"\\ud83d\\u0041\"",
+    "[1,]",
+    "{\"a\" 1}",
+    "{\"a\":1,}",
+    "[1 2]",
+    "[[[",
+    "1 2",
+    "{} x",
+};
+
+static bool parse(const std::string& json, std::string& events)
+{
+    Recorder recorder;
+    JsonParser parser(recorder);
+    bool ok = parser.parse(json);
+    events = std::move(recorder.events);
+    return ok;
+}
+
+// Feeds 'json' cut at each of 'cuts', with one parser reused throughout
+static bool feed(JsonParser& parser, Recorder& recorder, const std::string& json, const std::vector<size_t>& cuts)
+{
+    recorder.events.clear();
+    size_t start = 0;
+    for (size_t cut : cuts) {
+        parser.feed(std::string_view(json).substr(start, cut - start));
+        start = cut;
+    }
+    parser.feed(std::string_view(json).substr(start));
+    return parser.finish();
+}
+
+static void checkSplits(const std::string& json, bool valid)
+{
+    Recorder recorder;
+    JsonParser parser(recorder);
+    std::string expected;
+    bool ok = parse(json, expected);
+    CHECK(ok == valid);
+
+    CHECK(feed(parser, recorder, json, {}) == ok);
+    CHECK(recorder.events == expected);
+    // Every way of cutting it in two and in three
+    for (size_t i = 0; i <= json.size(); ++i) {
+        CHECK(feed(parser, recorder, json, { i }) == ok);
+        CHECK(recorder.events == expected);
+        for (size_t j = i; j <= json.size(); ++j) {
+            CHECK(feed(parser, recorder, json, { i, j }) == ok);
+            CHECK(recorder.events == expected);
+        }
+    }
+    // A byte at a time
+    std::vector<size_t> bytes;
+    for (size_t i = 1; i < json.size(); ++i) {
+        bytes.push_back(i);
+    }
+    CHECK(feed(parser, recorder, json, bytes) == ok);
+    CHECK(recorder.events == expected);
+}
+
+static void testSplits()
+{
+    for (const char* json : Valid) {
+        checkSplits(json, true);
+    }
+    for (const char* json : Malformed) {
+        checkSplits(json, false);
+    }
+}
+
+// A larger document, cut at every offset, so that cuts land in every
+// kind of token at every depth
+static void testLargeDocument()
+{
+    std::string json = "[";
+    for (const char* document : Valid) {
+        json += document;
+        json += ",";
+    }
+    json += "{\"last\":[1e308,-1e-308,9007199254740993]}]";
+    std::string expected;
+    CHECK(parse(json, expected));
+
+    Recorder recorder;
+    JsonParser parser(recorder);
+    for (size_t i = 0; i <= json.size(); ++i) {
+        CHECK(feed(parser, recorder, json, { i }));
+        CHECK(recorder.events == expected);
+    }
+    for (size_t step : { 2, 3, 7, 16 }) {
+        std::vector<size_t> cuts;
+        for (size_t i = step; i < json.size(); i += step) {
+            cuts.push_back(i);
+        }
+        CHECK(feed(parser, recorder, json, cuts));
+        CHECK(recorder.events == expected);
+    }
+}
+
+int main()
+{
+    testSplits();
+    testLargeDocument();
+    return testResult();
+}
@@ -0,0 +1,147 @@
+//
+//  test_hash.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <cstdint>
+#include <limits>
+#include <string>
+
+// Values that are equal hash the same, whatever kind of number they hold,
+// whatever order their members are in, and however they got to be equal:
+// the hash kept with an array or object is dropped when it is changed.
+
+static void checkEqual(const JsonValue& a, const JsonValue& b)
+{
+    CHECK(a.equals(b));
+    CHECK(b.equals(a));
+    CHECK(a.hash() == b.hash());
+    // Again, with the hashes of both known
+    CHECK(a.equals(b));
+}
+
+static void checkDifferent(const JsonValue& a, const JsonValue& b)
+{
+    CHECK(!a.equals(b));
+    CHECK(!b.equals(a));
+    a.hash();
+    b.hash();
+    CHECK(!a.equals(b));
+}
+
+static JsonValue parse(const std::string& json)
+{
+    JsonDocument doc = JsonDocument::from_json(json);
+    CHECK(doc.isValid());
+    return doc.to_value();
+}
+
+static void testNumbers()
+{
+    checkEqual(JsonValue(0.0), JsonValue(-0.0));
+    checkEqual(parse("[0.0,{\"z\":-0.0}]"), parse("[-0.0,{\"z\":0.0}]"));
+    checkEqual(JsonValue(1.5), JsonValue(1.5));
+    checkDifferent(JsonValue(1.5), JsonValue(-1.5));
+
+    // Ints from signed and unsigned types are the same when they fit int64
+    checkEqual(JsonValue(5), JsonValue(5ULL));
+    checkEqual(JsonValue(std::numeric_limits<std::int64_t>::max()),
+               JsonValue(static_cast<unsigned long long>(std::numeric_limits<std::int64_t>::max())));
+    checkEqual(parse("[18446744073709551615]"), JsonValue(JsonArray{ std::numeric_limits<unsigned long long>::max() }));
+    // but not above it, where a uint64 shares its bits with a negative int64
+    const unsigned long long big = static_cast<unsigned long long>(std::numeric_limits<std::int64_t>::max()) + 1;
+    checkDifferent(JsonValue(big), JsonValue(std::numeric_limits<long long>::min()));
+    checkDifferent(JsonValue(std::numeric_limits<unsigned long long>::max()), JsonValue(-1));
+    checkDifferent(JsonValue(JsonArray{ std::numeric_limits<unsigned long long>::max() }), JsonValue(JsonArray{ -1 }));
+
+    // Ints and Doubles keep their types
+    checkDifferent(JsonValue(1), JsonValue(1.0));
+    checkDifferent(parse("[1]"), parse("[1.0]"));
+    checkDifferent(JsonValue(0), JsonValue(false));
+    checkDifferent(JsonValue(), JsonValue(0));
+}
+
+static void testStrings()
+{
+    static const std::string text = "borrowed text, long enough to be on the heap";
+    checkEqual(JsonValue::borrow(text), JsonValue(text));
+    checkEqual(JsonValue(""), JsonValue(std::string()));
+    checkDifferent(JsonValue("a"), JsonValue("b"));
+    checkDifferent(JsonValue("1"), JsonValue(1));
+}
+
+static void testOrder()
+{
+    checkEqual(parse("{\"a\":1,\"b\":[2],\"c\":{\"d\":null,\"e\":true}}"),
+               parse("{\"c\":{\"e\":true,\"d\":null},\"a\":1,\"b\":[2]}"));
+    checkDifferent(parse("{\"a\":1,\"b\":2}"), parse("{\"a\":2,\"b\":1}"));
+    checkDifferent(parse("{\"a\":1}"), parse("{\"a\":1,\"b\":1}"));
+    checkDifferent(parse("{\"a\":1}"), parse("{\"b\":1}"));
+    // Arrays are ordered
+    checkDifferent(parse("[1,2]"), parse("[2,1]"));
+    checkEqual(parse("{}"), JsonValue(JsonObject()));
+    checkDifferent(parse("{}"), parse("[]"));
+
+    // Past the size where objects keep an index
+    JsonObject forward;
+    JsonObject backward;
+    for (int i = 0; i < 100; ++i) {
+        forward.try_emplace("key" + std::to_string(i), i);
+        backward.try_emplace("key" + std::to_string(99 - i), 99 - i);
+    }
+    checkEqual(JsonValue(forward), JsonValue(backward));
+    backward["key50"] = 0;
+    checkDifferent(JsonValue(forward), JsonValue(backward));
+}
+
+static void testEdits()
+{
+    const std::string json = "{\"list\":[1,2,{\"deep\":[3]}],\"name\":\"n\"}";
+    JsonValue value = parse(json);
+    const size_t before = value.hash();
+    JsonValue copy = value;
+    checkEqual(value, copy);
+
+    // A change anywhere drops the hashes kept on the way to it
+    value.mutable_object()["list"].mutable_array()[2].mutable_object()["deep"].mutable_array().push_back(4);
+    const JsonValue edited = parse("{\"list\":[1,2,{\"deep\":[3,4]}],\"name\":\"n\"}");
+    checkEqual(value, edited);
+    checkDifferent(value, copy);
+    CHECK(copy.hash() == before);
+
+    // Back to what it was, it is equal to the copy again
+    value.mutable_object()["list"].mutable_array()[2].mutable_object()["deep"].mutable_array().pop_back();
+    checkEqual(value, copy);
+    CHECK(value.hash() == before);
+
+    // Changes through mutable_array() and mutable_object() directly
+    value.mutable_object().erase("name");
+    checkEqual(value, parse("{\"list\":[1,2,{\"deep\":[3]}]}"));
+    value.mutable_object()["name"] = "n";
+    checkEqual(value, copy);
+    JsonValue array = parse("[1,2,3]");
+    array.hash();
+    array.mutable_array()[1] = 20;
+    checkEqual(array, parse("[1,20,3]"));
+    array.mutable_array().clear();
+    checkEqual(array, parse("[]"));
+
+    // A document's tree, edited through the document
+    JsonDocument doc = JsonDocument::from_json(json);
+    const size_t docHash = doc.to_value().hash();
+    doc.mutable_object()["list"].mutable_array()[0] = -0.0;
+    checkEqual(doc.to_value(), parse("{\"list\":[0.0,2,{\"deep\":[3]}],\"name\":\"n\"}"));
+    doc.mutable_object()["list"].mutable_array()[0] = 1;
+    CHECK(doc.to_value().hash() == docHash);
+}
+
+int main()
+{
+    testNumbers();
+    testStrings();
+    testOrder();
+    testEdits();
+    return testResult();
+}
@@ -0,0 +1,205 @@
+//
+//  test_index.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsonindex.hpp"
+#include "jsonparser.hpp"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every instruction set JsonIndex supports here finds the same tokens as
+// a byte at a time scan, and the parser reports the same events whether
+// or not it goes through the index.
+
+static std::mt19937 rng(20261018);
+
+static size_t randomBelow(size_t n)
+{
+    return std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+}
+
+// Mostly the characters the index looks at, so that quotes, escapes and
+// scalars meet each other and block boundaries in every way
+static char randomChar()
+{
+    static const char chars[] = "\"\"\"\\\\\\{}[]:,  \t\n\rab01-.e";
+    return chars[randomBelow(sizeof(chars) - 1)];
+}
+
+static bool isStructural(char c)
+{
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+static bool isWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// What JsonIndex::build() is documented to find, a byte at a time. As in
+// the index, a backslash escapes the next character outside strings too.
+static std::vector<std::uint32_t> referenceIndex(const std::string& json)
+{
+    std::vector<std::uint32_t> starts;
+    bool inString = false;
+    bool escaped = false;
+    // Whether the previous character belongs to a number or literal
+    bool inScalar = false;
+    for (size_t i = 0; i < json.size(); ++i) {
+        char c = json[i];
+        bool quote = c == '"' && !escaped;
+        bool scalar = !quote && !isStructural(c) && !isWhitespace(c);
+        if (inString) {
+            inString = !quote;
+        }
+        else if (quote) {
+            starts.push_back(static_cast<std::uint32_t>(i));
+            inString = true;
+        }
+        else if (isStructural(c) || (scalar && !inScalar)) {
+            starts.push_back(static_cast<std::uint32_t>(i));
+        }
+        escaped = c == '\\' && !escaped;
+        inScalar = scalar;
+    }
+    return starts;
+}
+
+static std::vector<JsonIndex::Isa> supportedIsas()
+{
+    std::vector<JsonIndex::Isa> isas;
+    for (int isa = JsonIndex::Scalar; isa <= JsonIndex::supportedIsa(); ++isa) {
+        isas.push_back(static_cast<JsonIndex::Isa>(isa));
+    }
+    return isas;
+}
+
+static void checkIndex(const std::string& json)
+{
+    std::vector<std::uint32_t> expected = referenceIndex(json);
+    std::vector<size_t> split = JsonIndex::splitArray(json, 4, JsonIndex::Scalar);
+    for (JsonIndex::Isa isa : supportedIsas()) {
+        JsonIndex index;
+        CHECK(index.build(json, isa));
+        CHECK(std::vector<std::uint32_t>(index.begin(), index.end()) == expected);
+        CHECK(JsonIndex::splitArray(json, 4, isa) == split);
+    }
+}
+
+static void testRandomText()
+{
+    for (int i = 0; i < 20000; ++i) {
+        std::string json(randomBelow(300), ' ');
+        for (char& c : json) {
+            c = randomChar();
+        }
+        checkIndex(json);
+    }
+}
+
+// Records the events of a parse as text, to compare two parses by
+class Recorder : public JsonHandler
+{
+public:
+    bool onNull() override { events += "n"; return true; }
+    bool onBool(bool b) override { events += b ? "t" : "f"; return true; }
+    bool onNumber(const JsonValue& v) override
+    {
+        char buffer[64];
+        if (v.type() == JsonValue::Int) {
+            std::snprintf(buffer, sizeof(buffer), "i%lld;", static_cast<long long>(v.to_int()));
+        }
+        else {
+            std::snprintf(buffer, sizeof(buffer), "d%a;", v.to_double());
+        }
+        events += buffer;
+        return true;
+    }
+    bool onString(std::string_view s) override { events += "s" + std::to_string(s.size()) + ":"; events += s; return true; }
+    bool onStartObject() override { events += "{"; return true; }
+    bool onKey(std::string_view s) override { events += "k" + std::to_string(s.size()) + ":"; events += s; return true; }
+    bool onEndObject() override { events += "}"; return true; }
+    bool onStartArray() override { events += "["; return true; }
+    bool onEndArray() override { events += "]"; return true; }
+
+    std::string events;
+};
+
+// A text past the size the parser starts using an index at, with every
+// kind of token in it
+static std::string makeDocument()
+{
+    std::string json = "[\n";
+    for (int i = 0; json.size() < 96 * 1024; ++i) {
+        json += "  {\"id\": " + std::to_string(i) + ", \"ratio\": -" + std::to_string(i) + ".25e-3, ";
+        json += "\"name\": \"item \\\"" + std::to_string(i) + "\\\" \\\\ \\u00e9\\n\", ";
+        json += "\"tags\": [true, false, null, {}, []], \"\\\\\": \"\"},\n";
+    }
+    json += "  0\n]\n";
+    return json;
+}
+
+static bool parse(const std::string& json, bool indexed, std::string& events, size_t& offset)
+{
+    Recorder recorder;
+    JsonParser parser(recorder);
+    parser.setIndexed(indexed);
+    bool ok = parser.parse(json);
+    events = std::move(recorder.events);
+    offset = parser.offset();
+    return ok;
+}
+
+static void checkCursors(const std::string& json)
+{
+    std::string byteEvents, indexEvents;
+    size_t byteOffset, indexOffset;
+    bool byteOk = parse(json, false, byteEvents, byteOffset);
+    bool indexOk = parse(json, true, indexEvents, indexOffset);
+    CHECK(byteOk == indexOk);
+    CHECK(byteEvents == indexEvents);
+    CHECK(byteOffset == indexOffset);
+}
+
+static void testCursors()
+{
+    const std::string document = makeDocument();
+    std::string byteEvents;
+    size_t offset;
+    CHECK(parse(document, false, byteEvents, offset));
+    checkCursors(document);
+    checkIndex(document);
+
+    // Breaks the text in a few places, mostly near the start so that the
+    // parse gets past the breakage and on to whatever it has become
+    for (int i = 0; i < 300; ++i) {
+        std::string json = document;
+        for (int edits = 1 + randomBelow(3); edits > 0; --edits) {
+            size_t at = randomBelow(i % 2 ? json.size() : 512);
+            switch (randomBelow(3)) {
+                case 0:
+                    json[at] = randomChar();
+                    break;
+                case 1:
+                    json.erase(at, 1);
+                    break;
+                default:
+                    json.insert(at, 1, randomChar());
+                    break;
+            }
+        }
+        checkCursors(json);
+        checkIndex(json);
+    }
+}
+
+int main()
+{
+    testRandomText();
+    testCursors();
+    return testResult();
+}
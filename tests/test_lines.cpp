@@ -0,0 +1,147 @@
+//
+//  test_lines.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsonlines.hpp"
+#include <string>
+#include <vector>
+
+// However many workers parse the lines, and however the text is cut into
+// batches, every document comes back in input order, with the number of
+// its line, and a malformed line gives an invalid document of its own.
+
+struct Line
+{
+    size_t number;
+    bool valid;
+    JsonValue value;
+};
+
+static std::string makeText()
+{
+    std::string text;
+    for (int i = 0; i < 3000; ++i) {
+        switch (i % 10) {
+            case 0:
+                text += "{\"id\":" + std::to_string(i) + ",\"tags\":[\"a\",\"b\\n\"],\"nested\":{\"x\":null}}\n";
+                break;
+            case 1:
+                text += "[" + std::to_string(i) + ",-1.5e3,true,\"\\u00e9\"]\r\n";
+                break;
+            case 2:
+                text += "\n";
+                break;
+            case 3:
+                text += " \t \r\n";
+                break;
+            case 4:
+                // Malformed: cut short, trailing text, and a scalar
+                text += i % 3 == 0 ? "{\"id\":" : i % 3 == 1 ? "[1] [2]\n" : "42\n";
+                if (i % 3 == 0) {
+                    text += "\n";
+                }
+                break;
+            case 5:
+                text += "  {\"long\":\"" + std::string(i, 'x') + "\"}  \n";
+                break;
+            default:
+                text += "{\"id\":" + std::to_string(i) + "}\n";
+                break;
+        }
+    }
+    // The last line has no newline
+    text += "{\"last\":true}";
+    return text;
+}
+
+// What the reader should give, parsed a line at a time
+static std::vector<Line> expectedLines(const std::string& text)
+{
+    std::vector<Line> lines;
+    size_t number = 1;
+    for (size_t start = 0; start <= text.size(); ++number) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string_view line(text.data() + start, end - start);
+        if (line.find_first_not_of(" \t\r") != std::string_view::npos) {
+            JsonDocument doc = JsonDocument::from_json(line);
+            lines.push_back({ number, doc.isValid(), doc.to_value() });
+        }
+        start = end + 1;
+    }
+    return lines;
+}
+
+static void checkReader(JsonLinesReader& reader, const std::string& text, const std::vector<Line>& expected)
+{
+    reader.openText(text);
+    JsonDocument doc;
+    size_t i = 0;
+    while (reader.next(doc)) {
+        CHECK(i < expected.size());
+        if (i < expected.size()) {
+            CHECK(reader.line() == expected[i].number);
+            CHECK(doc.isValid() == expected[i].valid);
+            CHECK(!doc.isValid() || doc.to_value().equals(expected[i].value));
+        }
+        ++i;
+    }
+    CHECK(i == expected.size());
+    CHECK(!reader.next(doc));
+}
+
+static void testThreads()
+{
+    const std::string text = makeText();
+    const std::vector<Line> expected = expectedLines(text);
+    size_t invalid = 0;
+    for (const Line& line : expected) {
+        invalid += !line.valid;
+    }
+    CHECK(invalid == 300);
+
+    for (unsigned threads : { 1u, 2u, 8u, 0u }) {
+        for (size_t batchSize : { 1, 100, 4096, 1 << 20 }) {
+            for (size_t queueDepth : { 0, 1 }) {
+                JsonLinesReader reader(threads);
+                reader.setBatchSize(batchSize);
+                reader.setQueueDepth(queueDepth);
+                checkReader(reader, text, expected);
+            }
+        }
+    }
+}
+
+static void testEdges()
+{
+    JsonLinesReader reader(4);
+    reader.setBatchSize(16);
+    checkReader(reader, "", {});
+    checkReader(reader, "\n\n \r\n", {});
+    checkReader(reader, "[]", expectedLines("[]"));
+    checkReader(reader, "\n\n{}\n\n", expectedLines("\n\n{}\n\n"));
+
+    // Reopened part way through, with batches still being parsed ahead
+    const std::string text = makeText();
+    JsonDocument doc;
+    reader.openText(text);
+    for (int i = 0; i < 10; ++i) {
+        CHECK(reader.next(doc));
+    }
+    checkReader(reader, text, expectedLines(text));
+    reader.openText(text);
+    CHECK(reader.next(doc));
+    reader.close();
+    CHECK(!reader.next(doc));
+}
+
+int main()
+{
+    testThreads();
+    testEdges();
+    return testResult();
+}
@@ -0,0 +1,122 @@
+//
+//  test_moves.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <string>
+#include <utility>
+
+// Containers and values moved into a document or another container are
+// adopted as they are: the only allocation is the node a JsonValue keeps
+// an array or object in, and no element, string or key is copied.
+
+static CountingResource counting;
+
+static JsonArray makeArray()
+{
+    JsonArray array;
+    array.reserve(100);
+    for (int i = 0; i < 100; ++i) {
+        JsonObject& record = array.emplace_back(JsonObject()).mutable_object();
+        record.try_emplace("id", i);
+        record.try_emplace("message", std::string(40, 'a' + i % 26));
+    }
+    return array;
+}
+
+static JsonObject makeObject()
+{
+    JsonObject object;
+    object.reserve(100);
+    for (int i = 0; i < 100; ++i) {
+        object.try_emplace("a key too long to fit in place " + std::to_string(i), std::string(40, 'x'));
+    }
+    return object;
+}
+
+static void testSetArray()
+{
+    JsonArray array = makeArray();
+    const JsonValue* elements = &array[0];
+    JsonDocument doc;
+    size_t before = counting.allocations;
+    doc.setArray(std::move(array));
+    CHECK(counting.allocations - before == 1);
+    CHECK(&doc.to_array()[0] == elements);
+    CHECK(doc.to_array().size() == 100);
+}
+
+static void testSetObject()
+{
+    JsonObject object = makeObject();
+    const JsonValue* members = &object.begin()->second;
+    JsonDocument doc;
+    size_t before = counting.allocations;
+    doc.setObject(std::move(object));
+    CHECK(counting.allocations - before == 1);
+    CHECK(&doc.to_object().begin()->second == members);
+    CHECK(doc.to_object().size() == 100);
+}
+
+static void testConstructors()
+{
+    JsonArray array = makeArray();
+    const JsonValue* elements = &array[0];
+    size_t before = counting.allocations;
+    JsonDocument fromArray(std::move(array));
+    CHECK(counting.allocations - before == 1);
+    CHECK(&fromArray.to_array()[0] == elements);
+    
+    JsonObject object = makeObject();
+    before = counting.allocations;
+    JsonDocument fromObject(std::move(object));
+    CHECK(counting.allocations - before == 1);
+    CHECK(fromObject.to_object().size() == 100);
+}
+
+static void testValues()
+{
+    JsonArray array = makeArray();
+    size_t before = counting.allocations;
+    JsonValue value(std::move(array));
+    CHECK(counting.allocations - before == 1);
+    
+    // Values moved into containers with room for them
+    JsonArray outer;
+    outer.reserve(2);
+    JsonValue text(std::string(100, 'z'));
+    before = counting.allocations;
+    outer.push_back(std::move(value));
+    outer.emplace_back(std::move(text));
+    CHECK(counting.allocations == before);
+    CHECK(outer[0].to_array().size() == 100);
+    CHECK(outer[1].to_string_view().size() == 100);
+    
+    JsonObject object;
+    object.reserve(2);
+    JsonValue nested(makeObject());
+    before = counting.allocations;
+    object.try_emplace("nested", std::move(nested));
+    object.insert({ "array", std::move(outer[0]) });
+    CHECK(counting.allocations == before);
+    CHECK(object.at("nested").to_object().size() == 100);
+    CHECK(object.at("array").to_array().size() == 100);
+    
+    // A value moved onto an allocator for the resource it is already on
+    JsonValue moved(std::move(outer[1]), JsonValue::allocator_type(&counting));
+    CHECK(counting.allocations == before);
+    CHECK(moved.to_string_view() == std::string(100, 'z'));
+}
+
+int main()
+{
+    std::pmr::set_default_resource(&counting);
+    testSetArray();
+    testSetObject();
+    testConstructors();
+    testValues();
+    CHECK(counting.live == 0);
+    return testResult();
+}
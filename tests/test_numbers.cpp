@@ -0,0 +1,230 @@
+//
+//  test_numbers.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+// Numbers parse to the exact Int, or to the correctly rounded Double, on
+// either side of the fast paths, and Doubles are written in the fewest
+// digits that read back as the same Double.
+
+static std::mt19937_64 rng(20261018);
+
+static JsonValue parseNumber(const std::string& text)
+{
+    JsonDocument doc = JsonDocument::from_json("[" + text + "]");
+    CHECK(doc.isValid());
+    return doc.isValid() ? doc.to_array()[0] : JsonValue();
+}
+
+static std::string format(const JsonValue& value)
+{
+    char buffer[JsonValue::MaxNumberLength];
+    return std::string(buffer, value.format_number(buffer));
+}
+
+static bool sameBits(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Parses like strtod(), which rounds correctly, and keeps the Double type
+static void checkDouble(const std::string& text)
+{
+    JsonValue value = parseNumber(text);
+    CHECK(value.type() == JsonValue::Double);
+    CHECK(sameBits(value.to_double(), std::strtod(text.c_str(), nullptr)));
+}
+
+static void testIntegers()
+{
+    struct Case {
+        const char* text;
+        bool isUint64;
+        const char* formatted;
+    };
+    const Case cases[] = {
+        { "0", false, "0" },
+        { "-0", false, "0" },
+        { "-1", false, "-1" },
+        { "9007199254740993", false, "9007199254740993" },
+        { "9223372036854775807", false, "9223372036854775807" },
+        { "-9223372036854775807", false, "-9223372036854775807" },
+        { "-9223372036854775808", false, "-9223372036854775808" },
+        { "9223372036854775808", true, "9223372036854775808" },
+        { "10000000000000000000", true, "10000000000000000000" },
+        { "18446744073709551615", true, "18446744073709551615" },
+    };
+    for (const Case& c : cases) {
+        JsonValue value = parseNumber(c.text);
+        CHECK(value.type() == JsonValue::Int);
+        CHECK(value.is_uint64() == c.isUint64);
+        CHECK(format(value) == c.formatted);
+        CHECK(parseNumber(format(value)).equals(value));
+    }
+    CHECK(parseNumber("-9223372036854775808").to_int() == std::numeric_limits<std::int64_t>::min());
+    CHECK(parseNumber("18446744073709551615").to_uint() == std::numeric_limits<std::uint64_t>::max());
+
+    // Past the 64-bit limits, the nearest Double
+    checkDouble("18446744073709551616");
+    checkDouble("-9223372036854775809");
+    checkDouble("99999999999999999999999");
+    checkDouble("-18446744073709551615");
+}
+
+// Both sides of the exact fast path: a mantissa of at most 2^53 and a
+// power of ten of at most 10^22 either way
+static void testFastPathBoundary()
+{
+    const char* const texts[] = {
+        "9007199254740992e0", "9007199254740993e0", "9007199254740994e0", "9007199254740995e0",
+        "9007199254740992.0", "9007199254740993.0", "900719925474099.3", "900719925474099.35",
+        "1e22", "1e23", "9e22", "9e23", "8388608e22", "9007199254740992e22", "9007199254740993e22",
+        "1e-22", "1e-23", "3e-22", "3e-23", "9007199254740992e-22", "9007199254740993e-22",
+        "123456789012345678e-5", "1234567890123456789e-22", "12345678901234567890e0",
+        "0.1", "0.2", "0.3", "1.7976931348623157e308", "2.2250738585072014e-308",
+        "0.000000000000000000000000000001234", "1234567890123456789012345678901234567890",
+        "7.2057594037927933e16", "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124",
+        "1.00000000000000011102230246251565404236316680908203126",
+    };
+    for (const char* text : texts) {
+        checkDouble(text);
+        checkDouble(std::string("-") + text);
+    }
+}
+
+static void testSpecialDoubles()
+{
+    // -0.0 keeps its sign, and reads back as a Double
+    JsonValue negativeZero = parseNumber("-0.0");
+    CHECK(negativeZero.type() == JsonValue::Double && std::signbit(negativeZero.to_double()));
+    CHECK(format(negativeZero) == "-0.0");
+    CHECK(std::signbit(parseNumber("-0e5").to_double()));
+    CHECK(std::signbit(parseNumber("-1e-400").to_double()));
+
+    // Subnormals, the smallest, the largest, and where they meet the normals
+    for (const char* text : { "5e-324", "4.9406564584124654e-324", "2.4703282292062327e-324",
+                              "2.4703282292062328e-324", "1e-310", "2.2250738585072009e-308",
+                              "2.2250738585072011e-308", "2.2250738585072012e-308" }) {
+        checkDouble(text);
+    }
+    CHECK(parseNumber("2.4703282292062327e-324").to_double() == 0.0);
+    CHECK(parseNumber("2.4703282292062328e-324").to_double() == std::numeric_limits<double>::denorm_min());
+    CHECK(format(JsonValue(std::numeric_limits<double>::denorm_min())) == "5e-324");
+    CHECK(format(JsonValue(std::numeric_limits<double>::min())) == "2.2250738585072014e-308");
+    CHECK(format(JsonValue(std::numeric_limits<double>::max())) == "1.7976931348623157e+308");
+
+    // Out of range: infinity or zero, which are written as null and 0.0
+    CHECK(parseNumber("1e400").to_double() == std::numeric_limits<double>::infinity());
+    CHECK(parseNumber("-1.8e308").to_double() == -std::numeric_limits<double>::infinity());
+    CHECK(parseNumber("1e-400").to_double() == 0.0);
+    CHECK(format(parseNumber("1e400")) == "null");
+    CHECK(format(JsonValue(std::numeric_limits<double>::quiet_NaN())) == "null");
+}
+
+// The shortest form, with ".0" on whatever would otherwise read back as an
+// Int
+static void testShortest()
+{
+    struct Case {
+        double value;
+        const char* formatted;
+    };
+    const Case cases[] = {
+        { 0.0, "0.0" },
+        { 1.0, "1.0" },
+        { -2.0, "-2.0" },
+        { 100.0, "100.0" },
+        { 1e15, "1e+15" },
+        { 123456789.0, "123456789.0" },
+        { 9007199254740992.0, "9007199254740992.0" },
+        { 1e21, "1e+21" },
+        { 1e22, "1e+22" },
+        { 1e23, "1e+23" },
+        { 0.1, "0.1" },
+        { 0.30000000000000004, "0.30000000000000004" },
+        { 1.5e-7, "1.5e-07" },
+        { 123.456, "123.456" },
+    };
+    for (const Case& c : cases) {
+        std::string text = format(JsonValue(c.value));
+        CHECK(text == c.formatted);
+        JsonValue back = parseNumber(text);
+        CHECK(back.type() == JsonValue::Double && sameBits(back.to_double(), c.value));
+    }
+}
+
+static size_t significantDigits(double d)
+{
+    char buffer[64];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), d, std::chars_format::scientific).ptr;
+    size_t digits = 0;
+    for (char* p = buffer; p != end && *p != 'e'; ++p) {
+        digits += (*p >= '0' && *p <= '9');
+    }
+    return digits;
+}
+
+// Random bit patterns are written in as few digits as read back exactly,
+// and random decimals are read as strtod() reads them
+static void testRandom()
+{
+    for (int i = 0; i < 200000; ++i) {
+        std::uint64_t bits = rng();
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        if (!std::isfinite(d)) {
+            continue;
+        }
+        std::string text = format(JsonValue(d));
+        JsonValue back = parseNumber(text);
+        CHECK(back.type() == JsonValue::Double && sameBits(back.to_double(), d));
+        // One digit fewer does not read back
+        size_t digits = significantDigits(d);
+        if (digits > 1) {
+            char shorter[64];
+            char* end = std::to_chars(shorter, shorter + sizeof(shorter), d, std::chars_format::scientific, static_cast<int>(digits) - 2).ptr;
+            *end = '\0';
+            CHECK(std::strtod(shorter, nullptr) != d);
+        }
+    }
+
+    std::uniform_int_distribution<int> digitCount(1, 25);
+    std::uniform_int_distribution<int> exponent(-340, 320);
+    std::uniform_int_distribution<int> digit(0, 9);
+    for (int i = 0; i < 200000; ++i) {
+        std::string text = (rng() & 1) ? "-" : "";
+        int digits = digitCount(rng);
+        int point = std::uniform_int_distribution<int>(1, digits)(rng);
+        for (int j = 0; j < digits; ++j) {
+            char c = static_cast<char>('0' + digit(rng));
+            text += (j == 0 && c == '0' && digits > 1) ? '1' : c;
+            if (j + 1 == point && point < digits) {
+                text += '.';
+            }
+        }
+        text += "e" + std::to_string(exponent(rng));
+        checkDouble(text);
+    }
+}
+
+int main()
+{
+    testIntegers();
+    testFastPathBoundary();
+    testSpecialDoubles();
+    testShortest();
+    testRandom();
+    return testResult();
+}
@@ -0,0 +1,103 @@
+//
+//  test_object.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsonarray.hpp"
+#include "jsonobject.hpp"
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+// Iterators give the members in insertion order and let their values be
+// changed, but not their keys, which the lookup index is built on.
+
+static_assert(std::is_const_v<std::remove_reference_t<decltype(std::declval<JsonObject::iterator>()->first)>>);
+static_assert(!std::is_assignable_v<decltype((std::declval<JsonObject::iterator>()->first)), std::string_view>);
+static_assert(std::is_assignable_v<decltype((std::declval<JsonObject::iterator>()->second)), int>);
+static_assert(!std::is_assignable_v<decltype((std::declval<JsonObject::const_iterator>()->second)), int>);
+static_assert(std::is_convertible_v<JsonObject::iterator, JsonObject::const_iterator>);
+static_assert(!std::is_convertible_v<JsonObject::const_iterator, JsonObject::iterator>);
+
+// Past LinearLimit, so that lookups go through the index
+static JsonObject makeObject()
+{
+    JsonObject object;
+    for (int i = 0; i < 100; ++i) {
+        object.try_emplace("key" + std::to_string(i), i);
+    }
+    return object;
+}
+
+static void testIteration()
+{
+    JsonObject object = makeObject();
+    int i = 0;
+    for (auto member : object) {
+        CHECK(member.key() == "key" + std::to_string(i));
+        CHECK(member.second.to_int() == i);
+        member.second = i * 2;
+        ++i;
+    }
+    CHECK(i == 100);
+    for (auto&& [key, value] : object) {
+        value = value.to_int() + 1;
+    }
+    for (const auto& member : static_cast<const JsonObject&>(object)) {
+        CHECK(object.at(member.first).to_int() % 2 == 1);
+    }
+
+    // Keys convert to std::string explicitly, or through key()
+    std::string first(object.begin()->key());
+    std::string_view last = (object.end() - 1)->key();
+    CHECK(first == "key0" && last == "key99");
+    CHECK(std::string(object.cbegin()->first) == first);
+
+    // Random access, both ways
+    JsonObject::iterator it = object.begin();
+    CHECK(object.end() - it == 100);
+    CHECK((it + 10)->first == "key10");
+    CHECK(it[99].second.to_int() == 199);
+    it += 50;
+    CHECK((--it)->first == "key49");
+    CHECK((it++)->first == "key49");
+    CHECK(it->first == "key50");
+    CHECK(it > object.begin() && it < object.end() && object.begin() <= object.cbegin());
+    CHECK(std::find_if(object.begin(), object.end(), [](auto member) { return member.second.to_int() == 41; }) == object.begin() + 20);
+    CHECK(std::distance(object.cbegin(), object.cend()) == 100);
+}
+
+static void testLookups()
+{
+    JsonObject object = makeObject();
+    auto it = object.find("key7");
+    it->second = "seven";
+    CHECK(object.at("key7").to_string_view() == "seven");
+    CHECK(object.find("missing") == object.end());
+
+    // An iterator erases as a const_iterator, and the index stays whole
+    it = object.erase(it);
+    CHECK(it->first == "key8");
+    CHECK(!object.contains("key7"));
+    object.erase(object.begin(), object.begin() + 5);
+    CHECK(object.size() == 94);
+    for (int i = 8; i < 100; ++i) {
+        CHECK(object.find("key" + std::to_string(i))->second.to_int() == i);
+    }
+
+    auto added = object.try_emplace("key8", 0);
+    CHECK(!added.second && added.first->second.to_int() == 8);
+    added = object.try_emplace("new", JsonArray{ 1, 2 });
+    CHECK(added.second && added.first == object.end() - 1);
+    added.first->second.mutable_array().push_back(3);
+    CHECK(object.at("new").to_array().size() == 3);
+}
+
+int main()
+{
+    testIteration();
+    testLookups();
+    return testResult();
+}
@@ -0,0 +1,123 @@
+//
+//  test_parallel.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <sstream>
+#include <string>
+
+// A top-level array parsed with JsonDocument::Parallel, on as many threads
+// as there are cores, gives the same tree and the same validity as parsed
+// on one, however its elements fall into ranges: strings holding commas
+// and brackets, nested arrays, and ranges with nothing in them.
+
+// Past the size that Parallel applies to
+static const size_t Size = (1 << 20) + (1 << 18);
+
+static std::string text(const JsonDocument& doc)
+{
+    std::ostringstream os;
+    doc.to_json(os);
+    return os.str();
+}
+
+static void check(const std::string& json, bool valid)
+{
+    CHECK(json.size() >= (1 << 20));
+    JsonDocument serial = JsonDocument::from_json(json);
+    CHECK(serial.isValid() == valid);
+    const int flagSets[] = {
+        JsonDocument::NoFlags,
+        JsonDocument::UseArena,
+        JsonDocument::UseIndex,
+        JsonDocument::BorrowStrings,
+        JsonDocument::UseArena | JsonDocument::BorrowStrings,
+    };
+    for (int flags : flagSets) {
+        JsonDocument parallel = JsonDocument::from_json(json, flags | JsonDocument::Parallel);
+        CHECK(parallel.isValid() == valid);
+        if (valid) {
+            CHECK(parallel.to_value().equals(serial.to_value()));
+            CHECK(text(parallel) == text(serial));
+        }
+    }
+    JsonDocument inSitu = JsonDocument::from_json_in_situ(std::string(json), JsonDocument::Parallel);
+    CHECK(inSitu.isValid() == valid);
+    CHECK(!valid || text(inSitu) == text(serial));
+}
+
+// Elements that a scan for top-level commas could be fooled by
+static std::string makeArray(const std::string& separator = ",")
+{
+    static const char* const elements[] = {
+        "\"a,b\"",
+        "\"]\"",
+        "\"[,]\"",
+        "\"\\\",\\\"\"",
+        "\"\\\\\",\"\\\\\"",
+        "[1,[2,[3,\",\"]]]",
+        "{\"k,\":[\",\"],\"]\":{}}",
+        "[]",
+        "{}",
+        "-1.5e-3",
+        "true",
+        "null",
+        "\"caf\\u00e9 \\ud83d\\ude00\"",
+    };
+    std::string json = "[";
+    for (size_t i = 0; json.size() < Size; ++i) {
+        if (i > 0) {
+            json += separator;
+        }
+        json += elements[i % (sizeof(elements) / sizeof(elements[0]))];
+    }
+    json += "]";
+    return json;
+}
+
+static void testValid()
+{
+    check(makeArray(), true);
+    check(makeArray(" , "), true);
+    check(makeArray(",\n\t"), true);
+    check(" \n" + makeArray() + "\n ", true);
+
+    // Nothing between the brackets, so at most one range
+    check("[" + std::string(Size, ' ') + "]", true);
+    // Few elements, most ranges empty, and commas inside the strings
+    std::string strings(Size / 2, ',');
+    check("[\"" + strings + "\",\"" + strings + "\"]", true);
+    check("[\"" + strings + strings + "\"]", true);
+    check("[" + std::string(Size, ' ') + "1]", true);
+    check("[[" + std::string(Size, ' ') + "],[]]", true);
+    // One huge nested array, which is a single element
+    check("[" + makeArray() + "]", true);
+}
+
+static void testInvalid()
+{
+    std::string array = makeArray();
+    std::string body = array.substr(1, array.size() - 2);
+    check("[" + body + ",]", false);
+    check("[," + body + "]", false);
+    check("[" + body + "," + "," + body + "]", false);
+    check("[" + body.substr(0, body.size() / 2) + ",," + body.substr(body.size() / 2) + "]", false);
+    check("[" + body, false);
+    check("[" + body + "]]", false);
+    check("[" + body + "] x", false);
+    check("[" + body + ",\"unterminated]", false);
+    check("[" + body + "}", false);
+    check("[" + std::string(Size, ' ') + ",]", false);
+    check("[" + std::string(Size, ' ') + "1 2]", false);
+    // A bracket that closes the array early, in the middle of a range
+    check("[" + body.substr(0, body.size() / 3) + "]" + body.substr(body.size() / 3) + "]", false);
+}
+
+int main()
+{
+    testValid();
+    testInvalid();
+    return testResult();
+}
@@ -0,0 +1,173 @@
+//
+//  test_path.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include "jsonpath.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+// A path selects the same values from a tree as it does straight from the
+// text the tree was parsed from.
+
+static std::string text(const JsonValue& value)
+{
+    std::ostringstream os;
+    value.serialize(os);
+    return os.str();
+}
+
+static std::vector<std::string> treeMatches(const JsonPath& path, const std::string& json)
+{
+    JsonDocument doc = JsonDocument::from_json(json);
+    CHECK(doc.isValid());
+    std::vector<std::string> matches;
+    for (const JsonValue* match : path.select(doc.to_value())) {
+        matches.push_back(text(*match));
+    }
+    return matches;
+}
+
+static std::vector<std::string> streamMatches(const JsonPath& path, const std::string& json)
+{
+    std::vector<JsonValue> values;
+    CHECK(path.select(json, values));
+    std::vector<std::string> matches;
+    for (const JsonValue& match : values) {
+        matches.push_back(text(match));
+    }
+    return matches;
+}
+
+static void check(const char* path, const std::string& json, const std::vector<std::string>& expected)
+{
+    JsonPath compiled = path[0] == '$' ? JsonPath::compile(path) : JsonPath::pointer(path);
+    CHECK(compiled.isValid());
+    std::vector<std::string> tree = treeMatches(compiled, json);
+    CHECK(tree == expected);
+    CHECK(streamMatches(compiled, json) == tree);
+    JsonDocument doc = JsonDocument::from_json(json);
+    const JsonValue* first = compiled.find(doc.to_value());
+    CHECK(first ? !tree.empty() && text(*first) == tree.front() : tree.empty());
+}
+
+static const std::string Store = R"({
+    "store": {
+        "book": [
+            {"title": "a", "price": 8},
+            {"title": "b", "price": 12},
+            {"title": "c", "price": 9},
+            {"title": "d", "price": 22},
+            {"title": "e", "price": 5}
+        ],
+        "a/b": 1,
+        "m~n": 2,
+        "~1": 3,
+        "": 4
+    }
+})";
+
+static void testPointer()
+{
+    check("", "[1]", {"[1]"});
+    check("/store/book/0/title", Store, {"\"a\""});
+    check("/store/book/4/price", Store, {"5"});
+    check("/store/book/5", Store, {});
+    check("/store/book/-", Store, {});
+    check("/store/a~1b", Store, {"1"});
+    check("/store/m~0n", Store, {"2"});
+    // Escapes are undone in order, so ~01 names "~1" and not "/"
+    check("/store/~01", Store, {"3"});
+    check("/store/", Store, {"4"});
+    check("/store/a/b", Store, {});
+    CHECK(!JsonPath::pointer("store").isValid());
+    CHECK(!JsonPath::pointer("/a~2").isValid());
+    CHECK(!JsonPath::pointer("/a~").isValid());
+    CHECK(JsonPath::pointer("/a/0").isSingular());
+}
+
+static void testSlices()
+{
+    const std::string array = "[0,1,2,3,4,5,6,7,8,9]";
+    check("$[2]", array, {"2"});
+    check("$[-1]", array, {"9"});
+    check("$[-10]", array, {"0"});
+    check("$[-11]", array, {});
+    check("$[10]", array, {});
+    check("$[2:5]", array, {"2", "3", "4"});
+    check("$[:3]", array, {"0", "1", "2"});
+    check("$[7:]", array, {"7", "8", "9"});
+    check("$[-3:]", array, {"7", "8", "9"});
+    check("$[::3]", array, {"0", "3", "6", "9"});
+    check("$[1:8:3]", array, {"1", "4", "7"});
+    check("$[::-1]", array, {"9", "8", "7", "6", "5", "4", "3", "2", "1", "0"});
+    check("$[::-4]", array, {"9", "5", "1"});
+    check("$[7:2:-2]", array, {"7", "5", "3"});
+    check("$[-2:-5:-1]", array, {"8", "7", "6"});
+    check("$[2:7:-1]", array, {});
+    check("$[100:-100:-3]", array, {"9", "6", "3", "0"});
+    check("$[5:5]", array, {});
+    check("$[::-1]", "[]", {});
+    check("$.store.book[-2:].title", Store, {"\"d\"", "\"e\""});
+    check("$.store.book[::-2].price", Store, {"5", "9", "8"});
+    // As in RFC 9535, a step of 0 selects nothing
+    check("$[::0]", array, {});
+    CHECK(!JsonPath::compile("$[1:2").isValid());
+    CHECK(!JsonPath::compile("$[1:2]").isSingular());
+}
+
+static void testWildcards()
+{
+    check("$.*", "{\"a\":1,\"b\":[2],\"c\":{}}", {"1", "[2]", "{}"});
+    check("$[*]", "[1,[2],{}]", {"1", "[2]", "{}"});
+    check("$.*", "[7,[8]]", {"7", "[8]"});
+    check("$.*.*", "{\"a\":7,\"b\":\"s\"}", {});
+    check("$.*", "[]", {});
+    check("$.store.book[*].title", Store, {"\"a\"", "\"b\"", "\"c\"", "\"d\"", "\"e\""});
+    check("$.*.*[0]", "{\"x\":{\"y\":[1,2],\"z\":3},\"w\":[[4]]}", {"1", "4"});
+    check("$['store']['book'][*]['price']", Store, {"8", "12", "9", "22", "5"});
+    CHECK(!JsonPath::compile("$.store.*").isSingular());
+}
+
+// A repeated key keeps the place of its first member and the value of its
+// last, whether the path meets it in a tree or in the text
+static void testRepeatedKeys()
+{
+    check("$.a", "{\"a\":1,\"a\":2}", {"2"});
+    check("$.*", "{\"a\":1,\"a\":2}", {"2"});
+    check("$.*", "{\"a\":1,\"b\":2,\"a\":3}", {"3", "2"});
+    check("$.a.b", "{\"a\":{\"b\":1},\"a\":{\"c\":2}}", {});
+    check("$.a.b", "{\"a\":{\"c\":2},\"a\":{\"b\":1}}", {"1"});
+    check("$.a[*]", "{\"a\":[1,2],\"x\":0,\"a\":[3]}", {"3"});
+    check("$.*[0]", "{\"a\":[1],\"b\":[2],\"a\":[]}", {"2"});
+    check("/a", "{\"a\":true,\"a\":false}", {"false"});
+}
+
+static void testTrailingText()
+{
+    std::vector<JsonValue> matches;
+    JsonPath path = JsonPath::compile("$.x");
+    CHECK(path.select("{\"x\":1}  \n", matches));
+    CHECK(matches.size() == 1);
+    matches.clear();
+    CHECK(!path.select("{\"x\":1} garbage [[[", matches));
+    matches.clear();
+    CHECK(!path.select("{\"x\":1}{}", matches));
+    matches.clear();
+    CHECK(!path.select("{\"x\":1", matches));
+    matches.clear();
+    CHECK(!path.select("", matches));
+}
+
+int main()
+{
+    testPointer();
+    testSlices();
+    testWildcards();
+    testRepeatedKeys();
+    testTrailingText();
+    return testResult();
+}
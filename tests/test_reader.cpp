@@ -0,0 +1,125 @@
+//
+//  test_reader.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsonarray.hpp"
+#include "jsonobject.hpp"
+#include "jsonreader.hpp"
+#include <limits>
+#include <string>
+
+static void testFields()
+{
+    JsonReader reader(R"({"skip": "]}{[\"", "nested": [1, "]", {"a": "}"}], "id": 7, "name": "x\ty", "last": null})");
+    std::string_view key;
+    CHECK(reader.object());
+    CHECK(reader.nextField(key) && key == "skip");
+    // The previous value is skipped when not consumed, brackets in strings
+    // included
+    CHECK(reader.nextField(key) && key == "nested");
+    CHECK(reader.nextField(key) && key == "id");
+    CHECK(reader.get_int64() == 7);
+    CHECK(reader.nextField(key) && key == "name");
+    CHECK(reader.get_string() == "x\ty");
+    CHECK(reader.nextField(key) && key == "last");
+    CHECK(reader.is_null());
+    CHECK(!reader.nextField(key));
+    CHECK(reader.finish());
+}
+
+static void testFindField()
+{
+    const char* json = R"({"a": 1, "b": {"c": [2, 3]}, "d": 4})";
+    JsonReader reader(json);
+    CHECK(reader.object());
+    CHECK(reader.find_field("b"));
+    CHECK(reader.object());
+    CHECK(reader.find_field("c"));
+    CHECK(reader.array());
+    CHECK(reader.nextElement());
+    CHECK(reader.get_int64() == 2);
+    // Leaves the array with 3 unread, and then the object around it
+    reader.leave();
+    reader.leave();
+    CHECK(reader.find_field("d"));
+    CHECK(reader.get_int64() == 4);
+    // Fields are found in document order only: "a" is behind
+    JsonReader again(json);
+    CHECK(again.object());
+    CHECK(again.find_field("d"));
+    CHECK(!again.find_field("a"));
+    CHECK(again.isValid());
+    CHECK(again.finish());
+}
+
+static void testValues()
+{
+    JsonReader reader(R"([18446744073709551615, -9223372036854775808, 1.5e3, true, {"x": [1, {}]}])");
+    CHECK(reader.array());
+    CHECK(reader.nextElement() && reader.type() == JsonValue::Int);
+    CHECK(reader.get_uint64() == std::numeric_limits<std::uint64_t>::max());
+    CHECK(reader.nextElement());
+    CHECK(reader.get_int64() == std::numeric_limits<std::int64_t>::min());
+    CHECK(reader.nextElement() && reader.type() == JsonValue::Double);
+    CHECK(reader.get_double() == 1500.0);
+    CHECK(reader.nextElement() && reader.get_bool());
+    CHECK(reader.nextElement());
+    JsonValue value = reader.get_value();
+    CHECK(value.to_object().at("x").to_array().size() == 2);
+    CHECK(!reader.nextElement());
+    CHECK(reader.finish());
+}
+
+static void testErrors()
+{
+    // Errors are sticky
+    JsonReader reader(R"({"a": "text", "b": 2})");
+    std::string_view key;
+    CHECK(reader.object());
+    CHECK(reader.nextField(key));
+    CHECK(reader.get_int64() == 0);
+    CHECK(!reader.isValid());
+    CHECK(!reader.nextField(key));
+    CHECK(!reader.finish());
+    
+    // Integers have to fit
+    JsonReader big("18446744073709551615");
+    big.get_int64();
+    CHECK(!big.isValid());
+    JsonReader negative("-1");
+    negative.get_uint64();
+    CHECK(!negative.isValid());
+    
+    // What follows the top-level value is only checked by finish()
+    JsonReader garbage("1 garbage");
+    CHECK(garbage.get_int64() == 1);
+    CHECK(garbage.isValid());
+    CHECK(!garbage.finish());
+    CHECK(!garbage.isValid());
+    JsonReader spaces(" [1] \n\t");
+    CHECK(spaces.array());
+    spaces.leave();
+    CHECK(spaces.finish());
+    JsonReader unread("[1]");
+    CHECK(!unread.finish());
+    JsonReader open("[1]");
+    CHECK(open.array());
+    CHECK(!open.finish());
+    
+    for (const char* bad : { "", "[1,]", "{\"a\" 1}", "[1 2]", "\"unterminated", "[\"\\", "{1: 2}" }) {
+        JsonReader r(bad);
+        r.get_value();
+        CHECK(!r.isValid());
+    }
+}
+
+int main()
+{
+    testFields();
+    testFindField();
+    testValues();
+    testErrors();
+    return testResult();
+}
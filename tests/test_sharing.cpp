@@ -0,0 +1,180 @@
+//
+//  test_sharing.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <string>
+
+// Copying an array or object shares it rather than copying its elements,
+// also once it was changed, unless a borrowed string was put in it.
+// Borrowed strings, from a text parsed in place or with BorrowStrings,
+// stay valid for as long as the rules in JsonDocument promise.
+
+static CountingResource counting;
+
+static JsonArray makeTree()
+{
+    JsonArray array;
+    for (int i = 0; i < 100; ++i) {
+        JsonObject& record = array.emplace_back(JsonObject()).mutable_object();
+        record.try_emplace("id", i);
+        record.try_emplace("message", std::string(40, 'a' + i % 26));
+    }
+    return array;
+}
+
+static void testEditedTree()
+{
+    JsonValue tree(makeTree());
+    tree.mutable_array()[3].mutable_object()["id"] = 1000;
+    tree.mutable_array().push_back("appended");
+    size_t before = counting.allocations;
+    JsonValue copy = tree;
+    CHECK(counting.allocations == before);
+    CHECK(&copy.to_array() == &tree.to_array());
+    // Asking again answers from what the first copy worked out
+    JsonValue again = tree;
+    CHECK(counting.allocations == before);
+    CHECK(&again.to_array() == &tree.to_array());
+}
+
+static void testBorrowedString()
+{
+    static const std::string text(40, 'b');
+    JsonValue tree(makeTree());
+    tree.mutable_array()[3].mutable_object()["message"] = JsonValue::borrow(text);
+    JsonValue copy = tree;
+    CHECK(&copy.to_array() != &tree.to_array());
+    CHECK(!copy.to_array()[3].to_object().at("message").is_borrowed());
+    CHECK(copy == tree);
+    
+    // Once the borrowed string is replaced, the tree is shared again
+    tree.mutable_array()[3].mutable_object()["message"] = "owned";
+    JsonValue owned = tree;
+    CHECK(&owned.to_array() == &tree.to_array());
+}
+
+static void testCompacted()
+{
+    JsonDocument doc;
+    doc.setArray(makeTree());
+    doc.compact();
+    JsonValue copy = doc.to_value();
+    CHECK(&copy.to_array() == &doc.to_array());
+    
+    // Pooled strings are borrowed, so the tree is copied instead
+    doc.compact(true);
+    JsonValue pooled = doc.to_value();
+    CHECK(&pooled.to_array() != &doc.to_array());
+    CHECK(pooled == doc.to_value());
+}
+
+// Long enough that moving the std::string keeps its buffer, with every
+// kind of escape in keys and values
+static std::string makeText()
+{
+    std::string text = "{\"plain\":\"" + std::string(40, 'p') + "\",";
+    text += "\"escaped\":\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\\u00e9\\u20ac\\ud83d\\ude00 end\",";
+    text += "\"key\\n\\u0041\":\"x\",";
+    text += "\"list\":[\"\\t\",\"\",\"\\u0000\",\"" + std::string(100, 'l') + "\"]}";
+    return text;
+}
+
+static bool pointsInto(std::string_view s, const char* begin, size_t size)
+{
+    return s.data() >= begin && s.data() + s.size() <= begin + size;
+}
+
+static void testInSitu()
+{
+    std::string text = makeText();
+    const JsonDocument expected = JsonDocument::from_json(text);
+    CHECK(expected.isValid());
+    const char* data = text.data();
+    size_t size = text.size();
+
+    JsonDocument doc = JsonDocument::from_json_in_situ(std::move(text));
+    CHECK(doc.isValid());
+    CHECK(doc.to_value() == expected.to_value());
+    // Escaped strings are decoded over their own text and borrowed too
+    const JsonObject& object = doc.to_object();
+    CHECK(object.at("escaped").to_string_view() == "a\"b\\c/d\b\f\n\r\t\u00e9\u20ac\U0001F600 end");
+    CHECK(object.at("key\nA").to_string_view() == "x");
+    CHECK(object.at("list").to_array()[2].to_string_view() == std::string_view("\0", 1));
+    for (const JsonValue* value : { &object.at("plain"), &object.at("escaped"), &object.at("list").to_array()[0] }) {
+        CHECK(value->is_borrowed());
+        CHECK(pointsInto(value->to_string_view(), data, size));
+    }
+
+    // The text moves with the document
+    JsonDocument moved = std::move(doc);
+    CHECK(pointsInto(moved.to_object().at("escaped").to_string_view(), data, size));
+    CHECK(moved.to_value() == expected.to_value());
+
+    // Copies own their strings, and outlive the document
+    JsonDocument copy = moved;
+    JsonValue value = moved.to_value();
+    JsonValue escaped = moved.to_object().at("escaped");
+    CHECK(!copy.to_object().at("escaped").is_borrowed());
+    CHECK(!value.to_object().at("plain").is_borrowed());
+    CHECK(!escaped.is_borrowed());
+    moved = JsonDocument();
+    CHECK(copy.to_value() == expected.to_value());
+    CHECK(value == expected.to_value());
+    CHECK(escaped == expected.to_object().at("escaped"));
+}
+
+static void testBorrowStrings()
+{
+    std::string text = makeText();
+    const JsonDocument expected = JsonDocument::from_json(text);
+    JsonDocument doc = JsonDocument::from_json(text, JsonDocument::BorrowStrings);
+    CHECK(doc.to_value() == expected.to_value());
+    // Only strings without escapes can refer into the text
+    CHECK(doc.to_object().at("plain").is_borrowed());
+    CHECK(pointsInto(doc.to_object().at("plain").to_string_view(), text.data(), text.size()));
+    CHECK(!doc.to_object().at("escaped").is_borrowed());
+
+    // Edited, the document shares what it can and still borrows the rest
+    doc.mutable_object()["escaped"] = "owned";
+    doc.mutable_object()["added"] = JsonArray{ 1, 2 };
+    CHECK(doc.to_object().at("plain").is_borrowed());
+    JsonDocument copy = doc;
+    JsonValue value = doc.to_value();
+    JsonValue list = doc.to_object().at("list");
+    CHECK(!copy.to_object().at("plain").is_borrowed());
+    CHECK(!value.to_object().at("plain").is_borrowed());
+    CHECK(!list.to_array()[3].is_borrowed());
+    JsonValue copied = doc.to_object().at("plain");
+    CHECK(!copied.is_borrowed());
+    // A value moved out keeps borrowing
+    JsonValue taken = std::move(doc.mutable_object()["plain"]);
+    CHECK(taken.is_borrowed());
+
+    // Copies hold on to nothing of the text once it is gone
+    const std::string plain(40, 'p');
+    doc = JsonDocument();
+    taken = JsonValue();
+    text.assign(text.size(), '#');
+    text = std::string();
+    CHECK(copy.to_object().at("plain").to_string_view() == plain);
+    CHECK(value.to_object().at("plain").to_string_view() == plain);
+    CHECK(copied.to_string_view() == plain);
+    CHECK(list == expected.to_object().at("list"));
+    CHECK(copy.to_object().at("escaped").to_string_view() == "owned");
+    CHECK(copy.to_object().at("added").to_array().size() == 2);
+}
+
+int main()
+{
+    std::pmr::set_default_resource(&counting);
+    testEditedTree();
+    testBorrowedString();
+    testCompacted();
+    testInSitu();
+    testBorrowStrings();
+    CHECK(counting.live == 0);
+    return testResult();
+}
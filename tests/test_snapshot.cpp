@@ -0,0 +1,157 @@
+//
+//  test_snapshot.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include "jsonsnapshot.hpp"
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+// Snapshots give back what was written, look up members of large objects
+// through their table, and read damaged data as null without crashing.
+
+static std::mt19937 rng(20261018);
+
+static JsonValue makeValue()
+{
+    JsonObject large;
+    for (int i = 0; i < 100; ++i) {
+        large.try_emplace("member " + std::to_string(i), i * 3);
+    }
+    JsonObject object;
+    object.try_emplace("null", JsonValue());
+    object.try_emplace("true", true);
+    object.try_emplace("false", false);
+    object.try_emplace("small", -(1LL << 59));
+    object.try_emplace("int", std::numeric_limits<long long>::min());
+    object.try_emplace("uint", std::numeric_limits<unsigned long long>::max());
+    object.try_emplace("double", -1.5e-300);
+    object.try_emplace("string", std::string("with a \0 inside", 15));
+    object.try_emplace("empty", JsonArray());
+    object.try_emplace("array", JsonArray{ 1, "two", JsonObject(), JsonArray{ 3.5 } });
+    object.try_emplace("large", std::move(large));
+    return JsonValue(std::move(object));
+}
+
+static void testRoundTrip()
+{
+    const JsonValue value = makeValue();
+    std::string data = "prefix";
+    CHECK(JsonSnapshot::write(value, data));
+    
+    JsonSnapshot snap;
+    CHECK(!snap.openData(data));
+    CHECK(snap.openData(std::string_view(data).substr(6)));
+    JsonSnapshotValue root = snap.root();
+    CHECK(root.to_value() == value);
+    CHECK(root["int"].to_int() == std::numeric_limits<long long>::min());
+    CHECK(root["uint"].is_uint64());
+    CHECK(root["uint"].to_uint() == std::numeric_limits<unsigned long long>::max());
+    CHECK(root["small"].to_int() == -(1LL << 59));
+    CHECK(root["string"].to_string_view().size() == 15);
+    CHECK(root["array"][1].to_string_view() == "two");
+    CHECK(root["array"][3][0].to_double() == 3.5);
+    CHECK(root["array"][4].type() == JsonValue::Null);
+    CHECK(root["missing"].type() == JsonValue::Null);
+    CHECK(root[0].type() == JsonValue::Null);
+    
+    std::string path = "test_snapshot.snap";
+    CHECK(JsonSnapshot::writeFile(value, path));
+    JsonSnapshot file;
+    CHECK(file.open(path));
+    CHECK(file.root().to_value() == value);
+    file.close();
+    std::remove(path.c_str());
+}
+
+static void testLargeObject()
+{
+    JsonSnapshot snap;
+    std::string data;
+    CHECK(JsonSnapshot::write(makeValue(), data));
+    CHECK(snap.openData(data));
+    JsonSnapshotValue large = snap.root()["large"];
+    CHECK(large.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        std::string key = "member " + std::to_string(i);
+        CHECK(large.indexOf(key) == static_cast<size_t>(i));
+        CHECK(large.key(i) == key);
+        CHECK(large[key].to_int() == i * 3);
+    }
+    CHECK(!large.contains("member 100"));
+    CHECK(!large.contains(""));
+}
+
+// Reads everything reachable, as to_value() does
+static void readAll(const std::string& data)
+{
+    JsonSnapshot snap;
+    if (snap.openData(data)) {
+        snap.root().to_value();
+        snap.root()["large"]["member 7"].to_int();
+        snap.root()["string"].to_string_view();
+    }
+}
+
+static void testDamaged()
+{
+    std::string data;
+    CHECK(JsonSnapshot::write(makeValue(), data));
+    JsonSnapshot snap;
+    
+    // Headers that do not match
+    for (size_t at : { 0, 8, 12, 16 }) {
+        std::string damaged = data;
+        damaged[at] ^= 0x40;
+        CHECK(!snap.openData(damaged));
+    }
+    for (size_t size = 0; size < 32; ++size) {
+        CHECK(!snap.openData(std::string_view(data).substr(0, size)));
+    }
+    
+    // Records cut short, or with bytes changed, read as null where damaged
+    for (size_t size = 32; size < data.size(); ++size) {
+        std::string cut = data.substr(0, size);
+        // Keep the header's size from ruling the data out before it is read
+        std::uint64_t headerSize = size;
+        std::memcpy(&cut[16], &headerSize, sizeof(headerSize));
+        readAll(cut);
+    }
+    for (int i = 0; i < 5000; ++i) {
+        std::string damaged = data;
+        for (int edits = 1 + rng() % 4; edits > 0; --edits) {
+            damaged[32 + rng() % (data.size() - 32)] = static_cast<char>(rng());
+        }
+        readAll(damaged);
+    }
+}
+
+static void testDeep()
+{
+    const size_t depth = 1000000;
+    JsonDocument doc = JsonDocument::from_json(std::string(depth, '[') + std::string(depth, ']'));
+    std::string data;
+    CHECK(JsonSnapshot::write(doc.to_value(), data));
+    JsonSnapshot snap;
+    CHECK(snap.openData(data));
+    JsonValue copy = snap.root().to_value();
+    size_t levels = 0;
+    for (const JsonValue* v = &copy; v->type() == JsonValue::Array && v->to_array().size() == 1; v = &v->to_array()[0]) {
+        ++levels;
+    }
+    CHECK(levels == depth - 1);
+}
+
+int main()
+{
+    testRoundTrip();
+    testLargeObject();
+    testDamaged();
+    testDeep();
+    return testResult();
+}
@@ -0,0 +1,124 @@
+//
+//  test_stats.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include <sstream>
+#include <string>
+
+// Built with JSONLIB_STATS, parsing and writing count what they did into
+// the JsonStats they are given; built without it, they leave it alone.
+// Trees built while counting can be used like any other either way.
+
+static const std::string Text = "{\"a\":[1,2.5,\"xyz\",true,null,[]],\"b\":{\"key that is longest\":\"longer string\"}}";
+
+static void checkParseCounts(const JsonStats& stats, size_t bytes)
+{
+    if (!JsonStats::Enabled) {
+        CHECK(stats.bytesParsed == 0 && stats.parseNs == 0 && stats.nodeCount() == 0);
+        CHECK(stats.allocations == 0 && stats.allocatedBytes == 0);
+        return;
+    }
+    CHECK(stats.bytesParsed == bytes);
+    CHECK(stats.nodes[JsonValue::Null] == 1);
+    CHECK(stats.nodes[JsonValue::Bool] == 1);
+    CHECK(stats.nodes[JsonValue::Int] == 1);
+    CHECK(stats.nodes[JsonValue::Double] == 1);
+    CHECK(stats.nodes[JsonValue::String] == 2);
+    CHECK(stats.nodes[JsonValue::Array] == 2);
+    CHECK(stats.nodes[JsonValue::Object] == 2);
+    CHECK(stats.nodeCount() == 10);
+    CHECK(stats.maxDepth == 3);
+    CHECK(stats.longestString == 19);
+    CHECK(stats.allocations > 0 && stats.allocatedBytes > 0);
+}
+
+static void testParse()
+{
+    for (int flags : { JsonDocument::NoFlags, JsonDocument::UseArena, JsonDocument::UseIndex }) {
+        JsonStats stats;
+        JsonDocument doc = JsonDocument::from_json(Text, flags, &stats);
+        CHECK(doc.isValid());
+        checkParseCounts(stats, Text.size());
+    }
+
+    // Counts add up over calls, and a failed parse still counts its bytes
+    JsonStats stats;
+    JsonDocument::from_json(Text, JsonDocument::NoFlags, &stats);
+    JsonDocument::from_json("[1,", JsonDocument::NoFlags, &stats);
+    CHECK(!JsonStats::Enabled || stats.bytesParsed == Text.size() + 3);
+    stats.reset();
+    CHECK(stats.bytesParsed == 0 && stats.nodeCount() == 0);
+}
+
+static void testParallel()
+{
+    std::string json = "[";
+    for (int i = 0; json.size() < (3 << 19); ++i) {
+        json += "{\"i\":" + std::to_string(i) + ",\"s\":\"text\"},";
+    }
+    json += "[]]";
+    JsonStats serial;
+    JsonStats parallel;
+    JsonDocument a = JsonDocument::from_json(json, JsonDocument::NoFlags, &serial);
+    JsonDocument b = JsonDocument::from_json(json, JsonDocument::Parallel, &parallel);
+    CHECK(a.to_value() == b.to_value());
+    for (size_t type = 0; type <= JsonValue::Object; ++type) {
+        CHECK(serial.nodes[type] == parallel.nodes[type]);
+    }
+    CHECK(serial.maxDepth == parallel.maxDepth);
+    CHECK(serial.bytesParsed == parallel.bytesParsed);
+}
+
+static void testWrite()
+{
+    JsonDocument doc = JsonDocument::from_json(Text);
+    JsonStats stats;
+    std::ostringstream os;
+    doc.to_json(os, 1, &stats);
+    CHECK(os.str() == Text);
+    CHECK(stats.bytesWritten == (JsonStats::Enabled ? Text.size() : 0));
+    CHECK(JsonStats::Enabled || stats.writeNs == 0);
+}
+
+// The tree of a document parsed with stats is on a resource that counts
+// allocations; its values are shared with or moved into containers on the
+// default resource, and copied the other way
+static void testCountedTree()
+{
+    JsonStats stats;
+    JsonDocument doc = JsonDocument::from_json(Text, JsonDocument::NoFlags, &stats);
+    std::pmr::memory_resource* counting = JsonStatsCollector::counted(std::pmr::new_delete_resource());
+    CHECK(counting->is_equal(*std::pmr::new_delete_resource()));
+    CHECK(!std::pmr::new_delete_resource()->is_equal(*counting));
+
+    JsonValue copy = doc.to_value();
+    CHECK(&copy.to_object() == &doc.to_object());
+    JsonArray array;
+    array.push_back(doc.to_object().at("a"));
+    CHECK(&array[0].to_array() == &doc.to_object().at("a").to_array());
+    JsonValue moved = std::move(doc.mutable_object()["b"]);
+    doc = JsonDocument();
+    CHECK(moved.to_object().at("key that is longest").to_string_view() == "longer string");
+    CHECK(copy.to_object().at("a").to_array().size() == 6);
+
+    // Values from the default resource put into the counted tree
+    JsonDocument other = JsonDocument::from_json(Text, JsonDocument::NoFlags, &stats);
+    JsonArray& a = other.mutable_object()["a"].mutable_array();
+    a.push_back(JsonArray{ 1, 2 });
+    a.push_back(copy);
+    JsonValue last = a.back();
+    other = JsonDocument();
+    CHECK(last.to_object().size() == 2);
+}
+
+int main()
+{
+    testParse();
+    testParallel();
+    testWrite();
+    testCountedTree();
+    return testResult();
+}
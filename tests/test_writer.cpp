@@ -0,0 +1,174 @@
+//
+//  test_writer.cpp
+//  JsonLib
+//
+
+#include "test.hpp"
+#include "jsondocument.hpp"
+#include "jsonwriter.hpp"
+#include <sstream>
+#include <string>
+
+// Writing to a stream through a buffer of any size gives the same text as
+// writing to a string, and so does writing on any number of threads.
+
+static JsonValue makeValue()
+{
+    JsonArray deep;
+    JsonArray* inner = &deep;
+    for (int i = 0; i < 300; ++i) {
+        inner = &inner->emplace_back(JsonArray()).mutable_array();
+    }
+    inner->push_back("innermost");
+    
+    JsonObject object;
+    object.try_emplace("deep", std::move(deep));
+    object.try_emplace("long", std::string(1000, 'l') + "\"\n\t" + std::string(1000, 'm'));
+    object.try_emplace("number", -1.25e-300);
+    object.try_emplace("list", JsonArray{ 1, true, JsonValue(), "short" });
+    return JsonValue(std::move(object));
+}
+
+static void testBufferSizes()
+{
+    const JsonValue value = makeValue();
+    for (JsonWriter::Style style : { JsonWriter::Compact, JsonWriter::Indented }) {
+        std::string expected;
+        JsonWriter(expected, style).write(value);
+        for (size_t size : { 1, 2, 7, 64, 256, 4096 }) {
+            std::ostringstream os;
+            std::string buffer(size, '\0');
+            {
+                JsonWriter writer(os, buffer.data(), size, style);
+                writer.write(value);
+                CHECK(writer.size() == expected.size());
+            }
+            CHECK(os.str() == expected);
+        }
+    }
+}
+
+static void testSerialize()
+{
+    const JsonValue value = makeValue();
+    std::string expected;
+    JsonWriter(expected).write(value);
+    std::ostringstream os;
+    os << value << value.to_object() << value.to_object().at("list").to_array();
+    std::string list;
+    JsonWriter(list).write(value.to_object().at("list"));
+    CHECK(os.str() == expected + expected + list);
+
+    // Past SmallContainer elements, through the writer's own block
+    JsonArray array;
+    JsonObject object;
+    for (size_t i = 0; i <= JsonWriter::SmallContainer * 100; ++i) {
+        array.push_back(value);
+        object.try_emplace(std::to_string(i), i);
+    }
+    for (const JsonValue& large : { JsonValue(array), JsonValue(object) }) {
+        std::string text;
+        JsonWriter(text).write(large);
+        std::ostringstream ofValue, ofContainer;
+        ofValue << large;
+        if (large.type() == JsonValue::Array) {
+            ofContainer << large.to_array();
+        }
+        else {
+            ofContainer << large.to_object();
+        }
+        CHECK(ofValue.str() == text);
+        CHECK(ofContainer.str() == text);
+    }
+}
+
+// Large containers at several depths, to be split, with elements of very
+// different sizes so that chunks end all over the place
+static JsonValue makeLargeValue()
+{
+    JsonArray records;
+    for (int i = 0; i < 5000; ++i) {
+        JsonObject& record = records.emplace_back(JsonObject()).mutable_object();
+        record.try_emplace("id", i);
+        record.try_emplace("ratio", i / 7.0);
+        record.try_emplace("text", std::string(i % 97 == 0 ? 20000 : i % 13, 'a' + i % 26) + "\"\n");
+        if (i % 1000 == 0) {
+            JsonArray numbers;
+            for (int j = 0; j < 2000; ++j) {
+                numbers.push_back(j % 3 ? JsonValue(j) : JsonValue());
+            }
+            record.try_emplace("numbers", std::move(numbers));
+        }
+    }
+    JsonObject wide;
+    for (int i = 0; i < 3000; ++i) {
+        wide.try_emplace("key" + std::to_string(i), i % 5 ? JsonValue(i) : JsonValue(JsonArray{ i, "x" }));
+    }
+    JsonObject root;
+    root.try_emplace("records", std::move(records));
+    root.try_emplace("wide", std::move(wide));
+    root.try_emplace("small", JsonArray{ 1, 2, 3 });
+    root.try_emplace("empty", JsonArray());
+    return JsonValue(std::move(root));
+}
+
+static void testThreads()
+{
+    const JsonValue value = makeLargeValue();
+    const JsonValue values[] = { value, value.to_object().at("records"), value.to_object().at("wide"), makeValue(), JsonArray() };
+    for (JsonWriter::Style style : { JsonWriter::Compact, JsonWriter::Indented }) {
+        for (const JsonValue& v : values) {
+            std::string expected;
+            JsonWriter(expected, style).write(v);
+            for (unsigned threads : { 1u, 2u, 3u, 8u, 0u }) {
+                std::string out;
+                {
+                    JsonWriter writer(out, style);
+                    writer.writeParallel(v, threads);
+                    CHECK(writer.size() == expected.size());
+                }
+                CHECK(out == expected);
+
+                std::ostringstream os;
+                char buffer[JsonWriter::SmallBuffer];
+                {
+                    JsonWriter writer(os, buffer, sizeof(buffer), style);
+                    writer.writeParallel(v, threads);
+                }
+                CHECK(os.str() == expected);
+
+                std::string span(expected.size(), '\0');
+                JsonWriter fixed(span.data(), span.size(), style);
+                fixed.writeParallel(v, threads);
+                CHECK(!fixed.overflowed() && span == expected);
+            }
+        }
+    }
+
+    // The container overloads, and JsonDocument
+    const JsonArray& records = value.to_object().at("records").to_array();
+    std::string expected;
+    JsonWriter(expected).write(records);
+    std::string out;
+    JsonWriter(out).writeParallel(records, 4);
+    CHECK(out == expected);
+    expected.clear();
+    out.clear();
+    JsonWriter(expected).write(value.to_object());
+    JsonWriter(out).writeParallel(value.to_object(), 4);
+    CHECK(out == expected);
+
+    JsonDocument doc(value.to_object());
+    std::ostringstream serial, parallel;
+    doc.to_json(serial);
+    doc.to_json(parallel, 4);
+    CHECK(serial.str() == parallel.str());
+}
+
+int main()
+{
+    testBufferSizes();
+    testSerialize();
+    testThreads();
+    return testResult();
+}